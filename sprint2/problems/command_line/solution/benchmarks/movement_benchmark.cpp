@@ -0,0 +1,102 @@
+// Замер пакетного шага движения собак для разных наборов инструкций.
+// Запуск: movement_benchmark [собак] [повторов]
+#include "movement_kernel.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Dogs {
+    std::vector<double> pos_x, pos_y, speed_x, speed_y, bound_min, bound_max;
+};
+
+// Собаки на дорогах длиной до 20 клеток, большинство движется
+Dogs MakeDogs(size_t count) {
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> cell(0, 1000);
+    std::uniform_real_distribution<double> offset(-0.4, 0.4);
+    std::uniform_int_distribution<int> kind(0, 4);
+    std::uniform_int_distribution<int> length(0, 20);
+    Dogs dogs;
+    dogs.pos_x.reserve(count);
+    dogs.pos_y.reserve(count);
+    dogs.speed_x.reserve(count);
+    dogs.speed_y.reserve(count);
+    dogs.bound_min.reserve(count);
+    dogs.bound_max.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const int begin = cell(generator);
+        dogs.bound_min.push_back(-0.4 + begin);
+        dogs.bound_max.push_back(0.4 + begin + length(generator));
+        const double along = begin + offset(generator);
+        const double level = cell(generator);
+        switch (kind(generator)) {
+        case 0: // стоит
+            dogs.pos_x.push_back(along);
+            dogs.pos_y.push_back(level);
+            dogs.speed_x.push_back(0.0);
+            dogs.speed_y.push_back(0.0);
+            break;
+        case 1:
+        case 2: // по горизонтали
+            dogs.pos_x.push_back(along);
+            dogs.pos_y.push_back(level);
+            dogs.speed_x.push_back(kind(generator) % 2 ? 1.0 : -1.0);
+            dogs.speed_y.push_back(0.0);
+            break;
+        default: // по вертикали
+            dogs.pos_x.push_back(level);
+            dogs.pos_y.push_back(along);
+            dogs.speed_x.push_back(0.0);
+            dogs.speed_y.push_back(kind(generator) % 2 ? 1.0 : -1.0);
+        }
+    }
+    return dogs;
+}
+
+const char* GetIsaName(movement::Isa isa) {
+    switch (isa) {
+    case movement::Isa::Scalar:
+        return "scalar";
+    case movement::Isa::Sse2:
+        return "sse2";
+    case movement::Isa::Avx2:
+        return "avx2";
+    }
+    return "?";
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    const size_t count = argc > 1 ? std::stoul(argv[1]) : 1'000'000;
+    const size_t repeats = argc > 2 ? std::stoul(argv[2]) : 50;
+    const Dogs initial = MakeDogs(count);
+
+    std::cout << std::setw(8) << "isa" << std::setw(12) << "dogs" << std::setw(14) << "ms/step"
+              << std::setw(14) << "ns/dog" << std::endl;
+    for (const auto isa : {movement::Isa::Scalar, movement::Isa::Sse2, movement::Isa::Avx2}) {
+        if (!movement::IsSupported(isa)) {
+            continue;
+        }
+        std::chrono::steady_clock::duration total{};
+        for (size_t r = 0; r < repeats; ++r) {
+            // Каждый повтор начинается с одного и того же состояния
+            Dogs dogs = initial;
+            const auto start = std::chrono::steady_clock::now();
+            movement::Integrate({dogs.pos_x.data(), dogs.pos_y.data(), dogs.speed_x.data(), dogs.speed_y.data(),
+                                 dogs.bound_min.data(), dogs.bound_max.data(), count},
+                                0.05, isa);
+            total += std::chrono::steady_clock::now() - start;
+        }
+        const double ms = std::chrono::duration<double, std::milli>(total).count() / repeats;
+        std::cout << std::setw(8) << GetIsaName(isa) << std::setw(12) << count << std::setw(14) << std::fixed
+                  << std::setprecision(3) << ms << std::setw(14) << std::setprecision(2) << ms * 1e6 / count << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Замер предобработки дорожной сети и скорости запросов следующего шага маршрута
+// для иерархии сжатия и таблицы путей.
+// Запуск: route_benchmark [размер решётки] [запросов]
+#include "route_planner.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace std::literals;
+using Clock = std::chrono::steady_clock;
+using NodeId = model::RoadNetwork::NodeId;
+
+// Карта-решётка: size x size кварталов со стороной step. Часть улиц
+// прервана, чтобы кратчайшие пути не совпадали с манхэттенскими
+model::Map MakeGridMap(int size, int step) {
+    model::Map map(model::Map::Id{"map"s}, "Benchmark map"s);
+    const int end = size * step;
+    for (int i = 0; i <= size; ++i) {
+        if (i % 4 == 2) {
+            map.AddRoad(model::Road(model::Road::HORIZONTAL, {0, i * step}, end / 2 - step));
+            map.AddRoad(model::Road(model::Road::HORIZONTAL, {end / 2 + step, i * step}, end));
+        } else {
+            map.AddRoad(model::Road(model::Road::HORIZONTAL, {0, i * step}, end));
+        }
+        map.AddRoad(model::Road(model::Road::VERTICAL, {i * step, 0}, end));
+    }
+    map.BildListOderedPath();
+    return map;
+}
+
+double ElapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Время построения (мс) и одного запроса (нс)
+template <typename Router>
+std::pair<double, double> Measure(const model::RoadNetwork& network, const std::vector<std::pair<NodeId, NodeId>>& pairs) {
+    auto start = Clock::now();
+    const Router router{network};
+    const double build_ms = ElapsedMs(start);
+
+    int64_t checksum = 0; // чтобы компилятор не выбросил запросы
+    start = Clock::now();
+    for (const auto& [from, to] : pairs) {
+        checksum += router.GetNextHop(from, to).value_or(0);
+    }
+    const double query_ns = ElapsedMs(start) * 1e6 / pairs.size();
+    if (checksum < 0) {
+        std::cout << checksum;
+    }
+    return {build_ms, query_ns};
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    const std::vector<int> sizes = argc > 1 ? std::vector<int>{std::stoi(argv[1])} : std::vector<int>{5, 10, 30, 50, 100};
+    const size_t queries = argc > 2 ? std::stoul(argv[2]) : 100'000;
+
+    std::cout << std::setw(6) << "grid" << std::setw(8) << "nodes" << std::setw(12) << "ch build" << std::setw(12) << "ch ns"
+              << std::setw(14) << "table build" << std::setw(12) << "table ns" << std::endl;
+    for (const int size : sizes) {
+        const auto map = MakeGridMap(size, 10);
+        const auto& network = map.GetRoadNetwork();
+
+        std::mt19937 generator(42);
+        std::uniform_int_distribution<NodeId> node(0, network.GetNodeCount() - 1);
+        std::vector<std::pair<NodeId, NodeId>> pairs(queries);
+        for (auto& pair : pairs) {
+            pair = {node(generator), node(generator)};
+        }
+
+        const auto [ch_build_ms, ch_ns] = Measure<routing::ContractionHierarchy>(network, pairs);
+        std::cout << std::setw(6) << size << std::setw(8) << network.GetNodeCount() << std::fixed << std::setprecision(1)
+                  << std::setw(12) << ch_build_ms << std::setw(12) << ch_ns;
+        // Таблица строится только для сетей, которым её выдаст RoutePlanner
+        if (network.GetNodeCount() <= routing::RoutePlanner::DEFAULT_TABLE_MAX_NODES) {
+            const auto [table_build_ms, table_ns] = Measure<routing::DistanceTable>(network, pairs);
+            std::cout << std::setw(14) << table_build_ms << std::setw(12) << table_ns;
+        } else {
+            std::cout << std::setw(14) << "-" << std::setw(12) << "-";
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,151 @@
+// Симуляция игры без сервера: загружает конфигурацию, расставляет по сессиям
+// синтетических собак, которые бродят по дорогам случайным образом, и прогоняет
+// тики Game::ChangeGameSate так быстро, как получится. Печатает тиков в секунду,
+// время тика на одну собаку, число выделений памяти во время тиков и время фаз тика.
+// Запуск: simulation_benchmark <config.json> [собак] [сессий] [тиков] [потоков] [мс на тик]
+#include "json_loader.h"
+#include "../tests/support/counting_allocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace std::literals;
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string config_file;
+    size_t dogs = 10'000;
+    size_t sessions = 10;
+    size_t ticks = 1000;
+    unsigned threads = 1;
+    std::chrono::milliseconds tick_period{50};
+};
+
+// Синтетическая собака: остановившись, выбирает новое направление,
+// а на ходу иногда сворачивает
+struct Walker {
+    std::shared_ptr<model::GameSession> session;
+    model::Dog::Handle dog;
+};
+
+class RandomWalk {
+public:
+    static constexpr double TURN_PROBABILITY = 0.02; // за тик
+
+    explicit RandomWalk(uint64_t seed)
+        : generator_(seed) {
+    }
+
+    void Step(const std::vector<Walker>& walkers) {
+        static constexpr model::Dog::Dir DIRECTIONS[] = {model::Dog::Dir::Left, model::Dog::Dir::Right
+                                                         , model::Dog::Dir::Up, model::Dog::Dir::Down};
+        for (const auto& walker : walkers) {
+            const auto speed = walker.session->GetDog(walker.dog).GetSpeed();
+            const bool stopped = speed.dir_x == 0.0 && speed.dir_y == 0.0;
+            if (stopped || turn_(generator_)) {
+                walker.session->PushCommand({walker.dog, DIRECTIONS[direction_(generator_)]});
+            }
+        }
+    }
+
+private:
+    std::mt19937_64 generator_;
+    std::bernoulli_distribution turn_{TURN_PROBABILITY};
+    std::uniform_int_distribution<size_t> direction_{0, 3};
+};
+
+Options ParseOptions(int argc, const char* argv[]) {
+    if (argc < 2) {
+        throw std::invalid_argument("Usage: simulation_benchmark <config.json> [dogs] [sessions] [ticks] [threads] [tick ms]"s);
+    }
+    Options options;
+    options.config_file = argv[1];
+    if (argc > 2) options.dogs = std::stoul(argv[2]);
+    if (argc > 3) options.sessions = std::max<size_t>(1, std::stoul(argv[3]));
+    if (argc > 4) options.ticks = std::stoul(argv[4]);
+    if (argc > 5) options.threads = static_cast<unsigned>(std::stoul(argv[5]));
+    if (argc > 6) options.tick_period = std::chrono::milliseconds{std::stol(argv[6])};
+    return options;
+}
+
+} // namespace
+
+int main(int argc, const char* argv[]) {
+    try {
+        const auto options = ParseOptions(argc, argv);
+        model::Game game(true);
+        json_loader::LoadGame(game, options.config_file);
+        game.SetTickThreads(options.threads);
+        // Сессии распределяются по картам по очереди и заполняются одна за другой
+        const size_t dogs_per_session = (options.dogs + options.sessions - 1) / options.sessions;
+        game.SetSessionLimit(dogs_per_session, model::SessionPolicy::FillFirst);
+        const auto& maps = game.GetMapHeaders();
+        if (maps.empty()) {
+            throw std::invalid_argument("Config has no maps"s);
+        }
+
+        std::vector<Walker> walkers;
+        walkers.reserve(options.dogs);
+        for (size_t i = 0; i < options.dogs; ++i) {
+            const auto& map = game.GetMap((i / dogs_per_session) % maps.size());
+            auto session = game.GetSession(&map);
+            walkers.push_back({session, session->AddDog(game.NewDogId(), "dog"s + std::to_string(i), false).GetHandle()});
+        }
+
+        RandomWalk policy{42};
+        Clock::duration tick_time{};
+        uint64_t tick_allocations = 0;
+        uint64_t tick_bytes = 0;
+        for (size_t tick = 0; tick < options.ticks; ++tick) {
+            policy.Step(walkers); // ходы собак не входят в замер
+            const auto allocations_before = test_support::GetAllocationCount();
+            const auto bytes_before = test_support::GetAllocatedBytes();
+            const auto start = Clock::now();
+            game.ChangeGameSate(options.tick_period);
+            tick_time += Clock::now() - start;
+            tick_allocations += test_support::GetAllocationCount() - allocations_before;
+            tick_bytes += test_support::GetAllocatedBytes() - bytes_before;
+        }
+
+        const double seconds = std::chrono::duration<double>(tick_time).count();
+        const double ns_per_tick = seconds * 1e9 / std::max<size_t>(1, options.ticks);
+        const auto ticks = static_cast<double>(std::max<size_t>(1, options.ticks));
+        std::cout << std::fixed << std::setprecision(1)
+                  << "maps: " << maps.size() << ", dogs: " << options.dogs << ", sessions: " << options.sessions
+                  << ", threads: " << options.threads << ", ticks: " << options.ticks
+                  << " x " << options.tick_period.count() << " ms" << std::endl
+                  << "ticks/sec:        " << options.ticks / seconds << std::endl
+                  << "ns/tick:          " << ns_per_tick << std::endl
+                  << "ns/dog:           " << ns_per_tick / std::max<size_t>(1, options.dogs) << std::endl
+                  << "allocations/tick: " << tick_allocations / ticks << std::endl
+                  << "bytes/tick:       " << tick_bytes / ticks << std::endl;
+        // Время фаз тика: среднее и оценки 50-го и 99-го процентилей
+        auto us = [](util::Histogram::Duration duration) {
+            return std::chrono::duration<double, std::micro>(duration).count();
+        };
+        std::cout << std::setw(12) << "phase" << std::setw(12) << "mean us" << std::setw(12) << "p50 us"
+                  << std::setw(12) << "p99 us" << std::endl;
+        for (size_t i = 0; i < static_cast<size_t>(model::TickPhase::Count); ++i) {
+            const auto phase = static_cast<model::TickPhase>(i);
+            const auto& histogram = game.GetTickTimings().Get(phase);
+            if (histogram.GetCount() == 0) {
+                continue;
+            }
+            std::cout << std::setw(12) << model::TickTimings::GetName(phase) << std::setw(12) << us(histogram.GetMean())
+                      << std::setw(12) << us(histogram.GetPercentile(0.5))
+                      << std::setw(12) << us(histogram.GetPercentile(0.99)) << std::endl;
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << ex.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
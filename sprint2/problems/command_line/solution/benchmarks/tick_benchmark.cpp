@@ -0,0 +1,99 @@
+// Замер времени тика игры в зависимости от числа сессий, собак и потоков.
+// Запуск: tick_benchmark [сессий] [собак в сессии] [доля активных игроков] [тиков]
+#include "application.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace std::literals;
+
+// Карта-решётка: size x size кварталов со стороной step
+model::Map MakeGridMap(const std::string& id, int size, int step) {
+    model::Map map(model::Map::Id{id}, "Benchmark map "s + id);
+    const int end = size * step;
+    for (int i = 0; i <= size; ++i) {
+        map.AddRoad(model::Road(model::Road::HORIZONTAL, {0, i * step}, end));
+        map.AddRoad(model::Road(model::Road::VERTICAL, {i * step, 0}, end));
+    }
+    map.BildListOderedPath();
+    map.SetDogSpeed(3.0);
+    return map;
+}
+
+struct Scenario {
+    size_t sessions;
+    size_t dogs_per_session;
+    double active_share; // доля игроков, которые управляют собаками, остальные стоят
+    size_t ticks;
+};
+
+// Среднее время одного тика в наносекундах
+double RunScenario(const Scenario& scenario, unsigned threads) {
+    // Все игроки заходят на одну карту, сессии набираются по мере заполнения
+    model::Game game(false);
+    game.AddMap(MakeGridMap("map0"s, 20, 10));
+    game.SetSessionLimit(scenario.dogs_per_session, model::SessionPolicy::FillFirst);
+    game.SetTickThreads(threads);
+    app::Application app(game);
+
+    std::vector<std::string> tokens;
+    tokens.reserve(scenario.sessions * scenario.dogs_per_session);
+    for (size_t d = 0; d < scenario.sessions * scenario.dogs_per_session; ++d) {
+        tokens.push_back(*app.AddPlayer("dog"s + std::to_string(d), "map0"s).token);
+    }
+
+    static constexpr char DIRECTIONS[] = {'L', 'R', 'U', 'D'};
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<size_t> direction(0, std::size(DIRECTIONS) - 1);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t tick = 0; tick < scenario.ticks; ++tick) {
+        // Время от времени собаки меняют направление, как при живой игре
+        if (tick % 10 == 0) {
+            const auto active = static_cast<size_t>(tokens.size() * scenario.active_share);
+            for (size_t i = 0; i < active; ++i) {
+                app.SetDogDirect(tokens[i * tokens.size() / active], DIRECTIONS[direction(generator)]);
+            }
+        }
+        app.ChangeGameSate(50ms);
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / scenario.ticks;
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    const size_t ticks = argc > 4 ? std::stoul(argv[4]) : 200;
+    std::vector<Scenario> scenarios;
+    if (argc > 3) {
+        scenarios.push_back({std::stoul(argv[1]), std::stoul(argv[2]), std::stod(argv[3]), ticks});
+    } else {
+        scenarios = {{1, 10000, 1.0, ticks}, {1, 10000, 0.1, ticks}, {8, 1000, 1.0, ticks},
+                     {64, 500, 1.0, ticks}, {64, 500, 0.1, ticks}, {256, 100, 0.05, ticks}};
+    }
+
+    const unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << std::setw(10) << "sessions" << std::setw(10) << "dogs" << std::setw(10) << "active" << std::setw(10) << "threads"
+              << std::setw(16) << "ns/tick" << std::setw(10) << "speedup" << std::endl;
+    for (const auto& scenario : scenarios) {
+        double single_thread = 0;
+        for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+            const double ns = RunScenario(scenario, threads);
+            if (threads == 1) {
+                single_thread = ns;
+            }
+            std::cout << std::setw(10) << scenario.sessions << std::setw(10) << scenario.dogs_per_session
+                      << std::setw(10) << std::fixed << std::setprecision(2) << scenario.active_share << std::setw(10) << threads << std::setw(16) << std::fixed << std::setprecision(0) << ns
+                      << std::setw(10) << std::setprecision(2) << single_thread / ns << std::endl;
+        }
+    }
+    return 0;
+}
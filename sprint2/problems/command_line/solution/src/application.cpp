@@ -1,44 +1,130 @@
 #include "application.h"
 
+#include <algorithm>
+#include <limits>
+
 using std::literals::string_literals::operator""s;
 using std::literals::string_view_literals::operator""sv;
 
 namespace app {            
     
     
-    Player::Player(Token token, model::Dog* dog, model::GameSession* session) noexcept
+    Player::Player(Token token, Id id, model::Dog::Handle dog, std::shared_ptr<model::GameSession> session, rate_limiter::Config rate_limit) noexcept
         : token_(std::move(token)) 
+        , id_(id)
         , dog_(dog) 
-        , session_(session) 
+        , session_(std::move(session)) 
+        , rate_limit_(rate_limit)
     {}
 
     const Player::Token& Player::GetToken() const noexcept{
         return token_;
     }
 
-    model::Dog& Player::GetDog() const noexcept{
-        return *dog_;
+    Player::Id Player::GetId() const noexcept{
+        return id_;
+    }
+
+    model::Dog Player::GetDog() const noexcept{
+        return session_->GetDog(dog_);
+    }
+
+    model::Dog::Handle Player::GetDogHandle() const noexcept{
+        return dog_;
     }
 
     model::GameSession& Player::GetGameSession() const noexcept{
         return *session_;
     }
 
-    const Player* Players::AddPlayer(model::GameSession* session, model::Dog* dog){
-        Player::Token token = GenerateNewToken();
-        players_.push_back(std::make_unique<Player>(token, dog, session));
-        auto player_ptr = players_.back().get();
-        token_to_player_[token] = player_ptr;
-        return player_ptr;
+    bool Player::TryConsumeRequest(rate_limiter::Clock::time_point now) noexcept {
+        return rate_limit_.TryConsume(now);
+    }
+
+    Players::Players(rate_limiter::Config rate_limit)
+        : rate_limit_(rate_limit)
+    {}
+
+    std::shared_ptr<const Player> Players::AddPlayer(std::shared_ptr<model::GameSession> session, model::Dog::Handle dog){
+        const auto id = session->GetDogs().GetId(dog);
+        std::unique_lock lock{mutex_};
+        auto player = std::make_shared<Player>(GenerateNewToken(), id, dog, std::move(session), rate_limit_);
+        if (free_slots_.empty()) {
+            free_slots_.push_back(static_cast<uint32_t>(slots_.size()));
+            slots_.emplace_back();
+        }
+        const auto slot = free_slots_.back();
+        free_slots_.pop_back();
+        token_to_slot_.emplace(*player->GetToken(), slot);
+        dog_to_slot_.emplace(player->GetId(), slot);
+        slots_[slot] = player;
+        return player;
     }
 
-    Player* Players::FindByToken(const Player::Token& token) const noexcept {
-        if (auto it = token_to_player_.find(token); it != token_to_player_.end()) {
-            return it->second;
+    std::shared_ptr<Player> Players::FindByToken(std::string_view token) const noexcept {
+        std::shared_lock lock{mutex_};
+        if (auto it = token_to_slot_.find(token); it != token_to_slot_.end()) {
+            return slots_[it->second];
         }
         return nullptr;
     }
-    
+
+    bool Players::RemovePlayer(std::string_view token){
+        std::unique_lock lock{mutex_};
+        const auto it = token_to_slot_.find(token);
+        if (it == token_to_slot_.end()) {
+            return false;
+        }
+        FreeSlot(it->second);
+        return true;
+    }
+
+    bool Players::RemovePlayerByDog(model::Dog::Id dog){
+        std::unique_lock lock{mutex_};
+        const auto it = dog_to_slot_.find(dog);
+        if (it == dog_to_slot_.end()) {
+            return false;
+        }
+        FreeSlot(it->second);
+        return true;
+    }
+
+    void Players::FreeSlot(uint32_t slot){
+        auto& player = slots_[slot];
+        // ключ таблицы ссылается на токен игрока, удаляем его до игрока
+        token_to_slot_.erase(*player->GetToken());
+        dog_to_slot_.erase(player->GetId());
+        // Игрок освободится, когда его отпустят запросы, которые его уже нашли
+        player.reset();
+        free_slots_.push_back(slot);
+    }
+
+    size_t Players::GetCount() const noexcept {
+        std::shared_lock lock{mutex_};
+        return token_to_slot_.size();
+    }
+
+    void Players::Compact(){
+        std::unique_lock lock{mutex_};
+        // Таблицы не уменьшают число корзин при удалении, поэтому перестраиваем их
+        auto shrink = [](auto& table) {
+            constexpr size_t MIN_BUCKETS = 64;
+            if (table.bucket_count() > std::max(MIN_BUCKETS, 4 * table.size())) {
+                std::remove_reference_t<decltype(table)> compacted(table.begin(), table.end());
+                table.swap(compacted);
+            }
+        };
+        shrink(token_to_slot_);
+        shrink(dog_to_slot_);
+    }
+
+    void Players::SetRandomSeed(uint64_t seed){
+        std::unique_lock lock{mutex_};
+        util::SplitMix64 seeds{seed};
+        generator1_.seed(seeds());
+        generator2_.seed(seeds());
+    }
+
     Player::Token Players::GenerateNewToken(){
         std::stringstream stream;
         // токен это строка из 32 символов полученная из двух 
@@ -58,14 +144,14 @@ namespace app {
         Result::Result(const model::Map& map)
         : id_map(*map.GetId())
         , name_map(map.GetName()){
-            const auto buildings = map.GetBuildings();
+            const auto& buildings = map.GetBuildings();
             size_t buildings_count = buildings.size();
             buildings_.resize(buildings_count);
             for(size_t i=0; i<buildings_count; ++i){
                 buildings_[i].bounds = buildings[i].GetBounds();
             }
 
-            const auto roads = map.GetRoads();
+            const auto& roads = map.GetRoads();
             size_t roads_count = roads.size();
             roads_.resize(roads_count);
             for(size_t i=0; i<roads_count; ++i){
@@ -73,7 +159,7 @@ namespace app {
                 roads_[i].end = roads[i].GetEnd();
             }
 
-            const auto offices = map.GetOffices();
+            const auto& offices = map.GetOffices();
             size_t offices_count = offices.size();
             offices_.resize(offices_count);
             for(size_t i=0; i<offices_count; ++i){
@@ -121,30 +207,78 @@ namespace app {
             if (!map){
                 throw join_game::Error{join_game::ErrorReason::InvalidMap};
             } 
-            auto dog = game_.AddDog(user_name); // Создаем собаку для игрока
             auto session = game_.GetSession(map); // находим сессию для карты, которую запросил игрок
-            session->AddDog(dog); // добавляем собаку в сессию игры
-            auto new_player = players_.AddPlayer(session, dog); // создаем игрока
+            auto dog = session->AddDog(game_.NewDogId(), user_name); // создаем собаку игрока в сессии игры
+            auto new_player = players_.AddPlayer(session, dog.GetHandle()); // создаем игрока
         
-            return {new_player->GetToken(), new_player->GetDog().GetId()};
+            return {new_player->GetToken(), dog.GetId()};
         }
     
     } // namespace join_game
         
+    std::pair<size_t, size_t> Page::GetRange(size_t count) const noexcept {
+        const size_t first = std::min(start, count);
+        const size_t last = max_items ? first + std::min(*max_items, count - first) : count;
+        return {first, last};
+    }
+
     namespace game_state {
 
         UseCase::UseCase() {}
 
-        const Result UseCase::GetGameSate(const model::GameSession::Dogs& dogs){
-            Result res;
-            res.reserve(dogs.size());
-            for(const auto& dog : dogs){
-                res.push_back({});
-                auto& rec_dog = res.back();
-                rec_dog.id = std::to_string(*dog->GetId());
-                rec_dog.pos = dog->GetPos();
-                rec_dog.speed = dog->GetSpeed();
-                rec_dog.dir = dog->GetDirSymbol();
+        const Result UseCase::GetGameSate(const model::SessionSnapshot& snapshot, Page page, std::pmr::memory_resource* mr){
+            const auto& dogs = snapshot.dogs;
+            const auto [first, last] = page.GetRange(dogs.size());
+            Result res(mr);
+            res.reserve(last - first);
+            for(size_t i = first; i < last; ++i){
+                const auto& dog = dogs[i];
+                res.emplace_back(*dog.id, dog.pos, dog.speed, dog.dir);
+            }
+            return res;
+        }
+
+        bool View::IsUnlimited() const noexcept {
+            return !area && !radius;
+        }
+
+        const Result UseCase::GetGameSate(const model::SessionSnapshot& snapshot, const View& view, size_t center
+                                          , Page page, std::pmr::memory_resource* mr){
+            const auto& dogs = snapshot.dogs;
+            if (view.IsUnlimited() || (view.radius && center >= dogs.size())) {
+                return GetGameSate(snapshot, page, mr);
+            }
+            constexpr auto INF = std::numeric_limits<model::Dog::Coord>::infinity();
+            model::Area area = view.area.value_or(model::Area{-INF, -INF, INF, INF});
+            model::Dog::Pos origin{};
+            if (view.radius) {
+                // Круг ищем по описанному квадрату, лишнее отсекаем по расстоянию
+                origin = dogs[center].pos;
+                const auto r = *view.radius;
+                area.min_x = std::max(area.min_x, origin.x - r);
+                area.min_y = std::max(area.min_y, origin.y - r);
+                area.max_x = std::min(area.max_x, origin.x + r);
+                area.max_y = std::min(area.max_y, origin.y + r);
+            }
+            std::pmr::vector<uint32_t> visible(mr);
+            snapshot.grid.ForEachInArea(area, [&](uint32_t index) {
+                if (view.radius) {
+                    const auto dx = dogs[index].pos.x - origin.x;
+                    const auto dy = dogs[index].pos.y - origin.y;
+                    if (dx * dx + dy * dy > *view.radius * *view.radius) {
+                        return;
+                    }
+                }
+                visible.push_back(index);
+            });
+            // Сетка выдаёт собак по клеткам, а страницы считаются в порядке снимка
+            std::sort(visible.begin(), visible.end());
+            const auto [first, last] = page.GetRange(visible.size());
+            Result res(mr);
+            res.reserve(last - first);
+            for(size_t i = first; i < last; ++i){
+                const auto& dog = dogs[visible[i]];
+                res.emplace_back(*dog.id, dog.pos, dog.speed, dog.dir);
             }
             return res;
         }
@@ -154,26 +288,37 @@ namespace app {
 
         UseCase::UseCase() {}
 
-        const Result UseCase::GetPlayersListForUser(const model::GameSession::Dogs& dogs){
-            Result res;
-            res.reserve(dogs.size());
-            for(const auto& dog : dogs){
-                res.emplace_back(std::to_string(*dog->GetId()), dog->GetName());
+        const Result UseCase::GetPlayersListForUser(const model::SessionRoster& roster, Page page, std::pmr::memory_resource* mr){
+            const auto& dogs = roster.dogs;
+            const auto [first, last] = page.GetRange(dogs.size());
+            Result res(mr);
+            res.reserve(last - first);
+            for(size_t i = first; i < last; ++i){
+                const auto& dog = dogs[i];
+                res.emplace_back(*dog.id, std::pmr::string(dog.name, mr));
             }
             return res;
         }
     }   // namespace players_list 
 
 
-    Application::Application(model::Game& game) 
-    : game_(game)
+    Application::Application(model::Game& game, rate_limiter::Config player_rate_limit) 
+    : players_(player_rate_limit)
+    , game_(game)
     , join_game_(game, players_)
     , list_maps_(game)
-    , map_info_(game){
+    , map_info_(game)
+    , bots_(game){
     }
     
-    Player* Application::FindPlayer(const std::string_view& token) const noexcept {
-        return players_.FindByToken(Player::Token(std::string(token)));
+    std::shared_ptr<Player> Application::FindPlayer(const std::string_view& token) const noexcept {
+        return players_.FindByToken(token);
+    }
+
+    bool Application::TryConsumePlayerRequest(const std::string_view& token, rate_limiter::Clock::time_point now) const noexcept {
+        auto player = FindPlayer(token);
+        // Неизвестный токен отклонит проверка авторизации
+        return !player || player->TryConsumeRequest(now);
     }
 
     const list_maps::Result Application::ListMaps() {
@@ -181,31 +326,124 @@ namespace app {
     }
 
     const join_game::Result Application::AddPlayer(const std::string& user_name, const std::string& map_id) {
-        return join_game_.AddPlayer(user_name, map_id);
+        auto result = join_game_.AddPlayer(user_name, map_id);
+        if (journal_) {
+            journal_->Join(*result.token, map_id, user_name);
+        }
+        return result;
     }
 
     const map_info::Result Application::GetMapInfo(const std::string_view map_name){
         return map_info_.GetMapInfo(map_name);
     }
+
+    bool Application::IsMapLoaded(const std::string_view map_name) const {
+        return game_.IsMapLoaded(model::Map::Id{std::string(map_name)});
+    }
         
-    const game_state::Result Application::GetGameSate(const std::string_view token){
-        return game_state_.GetGameSate(GetDogsGameSessionForToken(token));
+    const game_state::Result Application::GetGameSate(const std::string_view token, Page page, std::pmr::memory_resource* mr
+                                                      , game_state::View view){
+        const auto player = GetPlayer(token);
+        if (view.IsUnlimited() && default_view_radius_ > 0) {
+            view.radius = default_view_radius_;
+        }
+        const auto snapshot = player->GetGameSession().GetSnapshot();
+        const auto center = snapshot->FindDog(player->GetDogHandle());
+        return game_state_.GetGameSate(*snapshot, view, center.value_or(snapshot->dogs.size()), page, mr);
+    }
+
+    void Application::SetDefaultViewRadius(model::Dog::Dimension radius) noexcept {
+        default_view_radius_ = radius;
     }
 
-    players_list::Result Application::GetPlayersListForUser(const std::string_view& token){
-        return players_list_.GetPlayersListForUser(GetDogsGameSessionForToken(token));
+    players_list::Result Application::GetPlayersListForUser(const std::string_view& token, Page page, std::pmr::memory_resource* mr){
+        const auto player = GetPlayer(token);
+        return players_list_.GetPlayersListForUser(*player->GetGameSession().GetRoster(), page, mr);
     }
 
     void Application::SetDogDirect(const std::string_view& token, const char direct){
+        auto player = GetPlayer(token);
+        if (journal_) {
+            std::lock_guard lock{pending_moves_mutex_};
+            pending_moves_.push_back({std::move(player), direct});
+            return;
+        }
+        player->GetGameSession().PushCommand({player->GetDogHandle(), static_cast<model::Dog::Dir>(direct)});
+    }
+
+    bool Application::RemovePlayer(const std::string_view& token){
         const auto player = FindPlayer(token);
-        const auto dog_speed = player->GetGameSession().GetMap().GetDogSpeed();
-        auto dir = static_cast<model::Dog::Dir>(direct);
-        auto& dog = player->GetDog();
-        dog.SetDirSpeed(dir, dog_speed);
+        if (!player) {
+            return false;
+        }
+        if (journal_) {
+            journal_->Leave(token);
+        }
+        player->GetGameSession().RemoveDog(player->GetDogHandle());
+        return players_.RemovePlayer(token);
+    }
+
+    void Application::AddBots(size_t count_per_map){
+        bots_.AddBots(count_per_map);
     }
 
     void Application::ChangeGameSate(std::chrono::milliseconds time_delta){
+        if (journal_) {
+            FlushPendingMoves();
+        }
+        using Clock = std::chrono::steady_clock;
+        auto& timings = game_.GetTickTimings();
+        const auto start = Clock::now();
+        bots_.Update();
+        timings.Record(model::TickPhase::Bots, Clock::now() - start);
         game_.ChangeGameSate(time_delta);
+        const auto players_start = Clock::now();
+        for (const auto dog : game_.GetRetiredDogs()) {
+            players_.RemovePlayerByDog(dog);
+        }
+        if (++tick_count_ % COMPACTION_PERIOD == 0) {
+            players_.Compact();
+            game_.Compact();
+        }
+        timings.Record(model::TickPhase::Players, Clock::now() - players_start);
+        if (journal_) {
+            journal_->Tick(time_delta, game_.GetStateChecksum());
+        }
+    }
+
+    void Application::FlushPendingMoves(){
+        {
+            std::lock_guard lock{pending_moves_mutex_};
+            flushed_moves_.swap(pending_moves_);
+        }
+        for (const auto& [player, dir] : flushed_moves_) {
+            const auto& token = *player->GetToken();
+            // Игрок ушёл из игры после команды - она не выполнится, и в журнале её нет
+            if (players_.FindByToken(token) != player) {
+                continue;
+            }
+            journal_->Move(token, dir);
+            player->GetGameSession().PushCommand({player->GetDogHandle(), static_cast<model::Dog::Dir>(dir)});
+        }
+        flushed_moves_.clear();
+    }
+
+    void Application::SetRandomSeed(uint64_t seed){
+        util::SplitMix64 seeds{seed};
+        game_.SetRandomSeed(seeds());
+        players_.SetRandomSeed(seeds());
+    }
+
+    void Application::SetJournal(std::unique_ptr<journal::Writer> journal){
+        journal_ = std::move(journal);
+    }
+
+    const model::TickTimings& Application::GetTickTimings() const noexcept {
+        return game_.GetTickTimings();
+    }
+
+    uint64_t Application::GetStateChecksum() const {
+        return game_.GetStateChecksum();
     }
 
     char Application::ConvertDogDirect(const std::string direct){
@@ -243,8 +481,13 @@ namespace app {
 
     }
         
-    const model::GameSession::Dogs& Application::GetDogsGameSessionForToken(const std::string_view& token){
-        return FindPlayer(token)->GetGameSession().GetDogs();
+    std::shared_ptr<Player> Application::GetPlayer(const std::string_view& token){
+        auto player = FindPlayer(token);
+        // Токен проверяется до выполнения запроса, но игрок мог успеть выйти из игры
+        if (!player) {
+            throw std::invalid_argument("Player token has not been found");
+        }
+        return player;
     }
     
 } // namespace app 
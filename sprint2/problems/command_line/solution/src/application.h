@@ -1,5 +1,14 @@
 #pragma once
 #include "model.h"
+#include "bots.h"
+#include "journal.h"
+#include "rate_limiter.h"
+
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
 
 
 
@@ -10,34 +19,65 @@ namespace app {
     public:
         using Token = util::Tagged<std::string, Player>;
         using Id = model::Dog::Id;
-        Player(Token token, model::Dog* dog, model::GameSession* session) noexcept;
+        Player(Token token, Id id, model::Dog::Handle dog, std::shared_ptr<model::GameSession> session, rate_limiter::Config rate_limit) noexcept;
         const Token& GetToken() const noexcept;
-        model::Dog& GetDog() const noexcept;
+        // Совпадает с идентификатором собаки игрока
+        Id GetId() const noexcept;
+        model::Dog GetDog() const noexcept;
+        model::Dog::Handle GetDogHandle() const noexcept;
         model::GameSession& GetGameSession() const noexcept;
+        // Ограничение частоты запросов игрока. Безопасно вызывать из любого потока
+        bool TryConsumeRequest(rate_limiter::Clock::time_point now) noexcept;
     private:
         Token token_;
-        model::Dog* dog_;
-        model::GameSession* session_;
+        Id id_;
+        model::Dog::Handle dog_; // собака в хранилище сессии
+        std::shared_ptr<model::GameSession> session_; // сессия живёт, пока на неё ссылается игрок
+        rate_limiter::TokenBucket rate_limit_;
     };
 
 
     class Players {
     public:
-        Players() = default;
+        explicit Players(rate_limiter::Config rate_limit = {});
         // No copy functions.
         Players(const Players&) = delete;
         void operator=(const Players&) = delete;
         
         
-        const Player* AddPlayer(model::GameSession* session, model::Dog* dog);
-        Player* FindByToken(const Player::Token& token) const noexcept;
+        std::shared_ptr<const Player> AddPlayer(std::shared_ptr<model::GameSession> session, model::Dog::Handle dog);
+        // Найденный игрок остаётся доступен по указателю и после выхода из игры
+        std::shared_ptr<Player> FindByToken(std::string_view token) const noexcept;
+        // Удаляет игрока: токен сразу перестаёт находиться, а слот игрока
+        // достанется следующему. Возвращает false, если токен неизвестен
+        bool RemovePlayer(std::string_view token);
+        // Удаляет игрока, управлявшего собакой dog. Возвращает false, если такого нет
+        bool RemovePlayerByDog(model::Dog::Id dog);
+        size_t GetCount() const noexcept;
+        // Возвращает память таблицы токенов, если игроков стало намного меньше
+        void Compact();
+        // Токены новых игроков выводятся из seed: при одинаковом зерне они повторяются
+        void SetRandomSeed(uint64_t seed);
     private:
-        using ArrPlayersUPtr = std::vector<std::unique_ptr<Player>>;
-        using TokenToPlayer = std::unordered_map<Player::Token, Player*, util::TaggedHasher<Player::Token>>;
-        ArrPlayersUPtr players_;
-        TokenToPlayer token_to_player_;
+        // Игроки выдаются по std::shared_ptr: запрос, нашедший игрока в потоке ввода-вывода
+        // до его выхода, работает со своим экземпляром, даже если слот уже занял новый
+        // игрок. Слоты ушедших игроков занимают новые, поэтому слотов не больше, чем
+        // нужно для наибольшего числа игроков одновременно
+        // Ключ ссылается на токен внутри Player, поэтому поиск по токену не выделяет память
+        using TokenToSlot = std::unordered_map<std::string_view, uint32_t>;
+        using DogToSlot = std::unordered_map<Player::Id, uint32_t, util::TaggedHasher<Player::Id>>;
+        std::vector<std::shared_ptr<Player>> slots_;
+        std::vector<uint32_t> free_slots_;
+        TokenToSlot token_to_slot_;
+        DogToSlot dog_to_slot_; // для ухода игроков, чьи собаки простаивали
+        // Поиск игрока по токену выполняется и в потоках ввода-вывода (до постановки
+        // запроса в strand), а добавление игроков - внутри strand
+        mutable std::shared_mutex mutex_;
+        rate_limiter::Config rate_limit_;
     
         Player::Token GenerateNewToken();
+        // Освобождает слот игрока. Вызывается под блокировкой
+        void FreeSlot(uint32_t slot);
     
         static const char ZERO_SYMBOL = '0';
         static const unsigned LENGHT_HEX_NUMBER = 16;
@@ -72,13 +112,14 @@ namespace app {
             : game_(game){
             }
             
+            // Список строится по каталогу карт и не строит сами карты
             const list_maps::Result ListMaps() {
-                auto maps = game_.GetMaps();
+                const auto& maps = game_.GetMapHeaders();
                 list_maps::Result res(maps.size());
                 size_t i = 0;
                 for(const auto& map : maps){
-                    res[i].id = *map.GetId();
-                    res[i].name = map.GetName();
+                    res[i].id = *map.id;
+                    res[i].name = map.name;
                     ++i;
                 };
                 return res;           
@@ -168,21 +209,43 @@ namespace app {
 
     } // namespace join_game
 
+    // Часть списка, запрошенная клиентом параметрами ?start=&maxItems=
+    struct Page {
+        size_t start = 0;
+        std::optional<size_t> max_items;
+        // Возвращает границы [first, last) части списка из count элементов
+        std::pair<size_t, size_t> GetRange(size_t count) const noexcept;
+    };
+
+    // Результаты game_state и players_list размещаются в памяти, переданной вызывающим
+    // (например, в арене запроса), поэтому хранятся в pmr-контейнерах
     namespace game_state {
 
         struct Dog {
-            std::string id;
+            int id;
             model::Dog::Pos pos;
             model::Dog::Speed speed;
-            std::string dir;
+            char dir;
         };
 
-        using Result = std::vector<Dog>;
+        using Result = std::pmr::vector<Dog>;
+
+        // Область интереса игрока: ?radius= вокруг его собаки и/или ?bbox=.
+        // Без ограничений в ответ попадают все собаки сессии
+        struct View {
+            std::optional<model::Area> area;
+            std::optional<model::Dog::Dimension> radius;
+            bool IsUnlimited() const noexcept;
+        };
 
         class UseCase {
         public:
             UseCase();
-            const Result GetGameSate(const model::GameSession::Dogs& dogs);
+            const Result GetGameSate(const model::SessionSnapshot& snapshot, Page page, std::pmr::memory_resource* mr);
+            // Собаки из области интереса игрока, собака которого - center в снимке.
+            // Порядок совпадает с порядком полного списка, поэтому страницы стабильны
+            const Result GetGameSate(const model::SessionSnapshot& snapshot, const View& view, size_t center
+                                     , Page page, std::pmr::memory_resource* mr);
         };
 
     } // namespace game_state
@@ -190,36 +253,62 @@ namespace app {
     namespace players_list {
 
         struct Dog {
-            std::string id;
-            std::string name;
+            int id;
+            std::pmr::string name;
         };
 
-        using Result = std::vector<Dog>;
+        using Result = std::pmr::vector<Dog>;
 
         class UseCase {
         public:
             UseCase();
-            const Result GetPlayersListForUser(const model::GameSession::Dogs& dogs);
+            const Result GetPlayersListForUser(const model::SessionRoster& roster, Page page, std::pmr::memory_resource* mr);
         };
 
     } // namespace players_list
 
     class Application {
     public:
-        Application(model::Game& game);
+        Application(model::Game& game, rate_limiter::Config player_rate_limit = {});
         // No copy functions.
         Application(const Application&) = delete;
         void operator=(const Application&) = delete;
     
-        Player* FindPlayer(const std::string_view& token) const noexcept ;
+        std::shared_ptr<Player> FindPlayer(const std::string_view& token) const noexcept ;
+        // Возвращает false, если игрок с этим токеном превысил допустимую частоту запросов
+        bool TryConsumePlayerRequest(const std::string_view& token, rate_limiter::Clock::time_point now) const noexcept;
         const list_maps::Result ListMaps();
         const join_game::Result AddPlayer(const std::string& user_name, const std::string& map_id);
         const map_info::Result GetMapInfo(const std::string_view map_name);
-        const game_state::Result GetGameSate(const std::string_view map_name);
-        players_list::Result GetPlayersListForUser(const std::string_view& token);
+        // Карта уже построена и GetMapInfo не будет её строить
+        bool IsMapLoaded(const std::string_view map_name) const;
+        const game_state::Result GetGameSate(const std::string_view map_name, Page page = {}
+                                             , std::pmr::memory_resource* mr = std::pmr::get_default_resource()
+                                             , game_state::View view = {});
+        // Радиус области интереса для запросов без radius и bbox, 0 - без ограничения
+        void SetDefaultViewRadius(model::Dog::Dimension radius) noexcept;
+        players_list::Result GetPlayersListForUser(const std::string_view& token, Page page = {}
+                                                   , std::pmr::memory_resource* mr = std::pmr::get_default_resource());
+        // Ставит команду игрока в очередь его сессии. Можно вызывать вне strand.
+        // При записи журнала команда передаётся сессии в начале следующего тика
         void SetDogDirect(const std::string_view& token, const char direct);
+        // Игрок покидает игру, его собака удаляется из сессии. Вызывается в strand.
+        // Возвращает false, если токен неизвестен
+        bool RemovePlayer(const std::string_view& token);
+        // Добавляет count_per_map ботов на каждую карту
+        void AddBots(size_t count_per_map);
+        // Шаг игры: команды ботам, затем тик сессий. Игроки, чьи собаки простаивали
+        // дольше dogRetirementTime, уходят из игры. Раз в COMPACTION_PERIOD
+        // тиков хранилища игроков и собак уплотняются
         void ChangeGameSate(std::chrono::milliseconds time_delta);
+        static constexpr uint64_t COMPACTION_PERIOD = 1024;
         char ConvertDogDirect(const std::string direct);
+        // Зерно всех генераторов игры и токенов. Задаётся до входа игроков и ботов
+        void SetRandomSeed(uint64_t seed);
+        // Начинает запись входов, выходов, команд игроков и тиков в журнал
+        void SetJournal(std::unique_ptr<journal::Writer> journal);
+        uint64_t GetStateChecksum() const;
+        const model::TickTimings& GetTickTimings() const noexcept;
 
     private:
         Players players_;
@@ -229,8 +318,28 @@ namespace app {
         map_info::UseCase map_info_;
         game_state::UseCase game_state_;
         players_list::UseCase players_list_;
-
-        const model::GameSession::Dogs& GetDogsGameSessionForToken(const std::string_view& token);
+        BotController bots_;
+        model::Dog::Dimension default_view_radius_ = 0;
+        uint64_t tick_count_ = 0;
+        // Журнал пишется только в strand: входы и выходы игроков, команды и тики
+        std::unique_ptr<journal::Writer> journal_;
+        // Команда игрока приходит вне strand. При записи журнала она под короткой
+        // блокировкой откладывается сюда, а в начале тика strand пишет отложенные
+        // команды в журнал и передаёт сессиям. Так команда попадает в журнал перед
+        // тем тиком, в котором выполняется, а тик не держит блокировку
+        struct PendingMove {
+            std::shared_ptr<Player> player;
+            char dir;
+        };
+        std::mutex pending_moves_mutex_;
+        std::vector<PendingMove> pending_moves_;
+        std::vector<PendingMove> flushed_moves_; // обрабатываются strand, память переиспользуется
+
+        // Пишет отложенные команды в журнал и ставит их в очереди сессий. Вызывается в strand
+        void FlushPendingMoves();
+        // Игрок с токеном или исключение std::invalid_argument. Указатель держит игрока
+        // и его сессию, пока запрос их использует
+        std::shared_ptr<Player> GetPlayer(const std::string_view& token);
     };
     
 
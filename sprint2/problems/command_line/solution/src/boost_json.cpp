@@ -1,6 +1,7 @@
 // Этот файл служит для подключения реализации библиотеки Boost.Json
 #include "boost_json.h"
 
+#include <charconv>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -9,6 +10,42 @@ using namespace std::literals;
 
 namespace boost_json {
 
+PmrResource::PmrResource(std::pmr::memory_resource* upstream) noexcept
+: upstream_(upstream){
+}
+
+void* PmrResource::do_allocate(std::size_t bytes, std::size_t alignment){
+    return upstream_->allocate(bytes, alignment);
+}
+
+void PmrResource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment){
+    upstream_->deallocate(p, bytes, alignment);
+}
+
+bool PmrResource::do_is_equal(const boost::json::memory_resource& other) const noexcept {
+    const auto other_pmr = dynamic_cast<const PmrResource*>(&other);
+    return other_pmr && upstream_->is_equal(*other_pmr->upstream_);
+}
+
+// Сериализует value в строку, размещенную в ресурсе mr
+std::pmr::string SerializeToResource(const boost::json::value& value, std::pmr::memory_resource* mr){
+    boost::json::serializer sr;
+    sr.reset(&value);
+    std::pmr::string res(mr);
+    char buffer[4096];
+    while (!sr.done()) {
+        auto part = sr.read(buffer, sizeof(buffer));
+        res.append(part.data(), part.size());
+    }
+    return res;
+}
+
+// Ключ объекта JSON из числового id
+boost::json::string_view IdToKey(int id, char (&buffer)[16]){
+    auto [end, ec] = std::to_chars(std::begin(buffer), std::end(buffer), id);
+    return {buffer, static_cast<size_t>(end - buffer)};
+}
+
 std::string GetErrorMes(std::string_view code, std::string_view message){
     boost::json::object obj{
           {"code", code}
@@ -108,29 +145,37 @@ std::string GetPlayerJsonBody(const app::join_game::Result& player_data){
     return serialize(obj);
 }
 
-std::string GetGameSateJsonBody(const app::game_state::Result& dogs){
-    boost::json::object res; 
-    boost::json::object players;
+std::pmr::string GetGameSateJsonBody(const app::game_state::Result& dogs, std::pmr::memory_resource* mr){
+    PmrResource resource{mr};
+    boost::json::storage_ptr sp{&resource};
+    boost::json::object res(sp); 
+    boost::json::object players(sp);
+    players.reserve(dogs.size());
+    char key[16];
 
     for(const auto& dog : dogs){
-        boost::json::object player;
+        boost::json::object player(sp);
         player["pos"] = {dog.pos.x, dog.pos.y};
         player["speed"] = {dog.speed.dir_x, dog.speed.dir_y};
-        player["dir"] = dog.dir ;
-        players[dog.id] = player;
+        player["dir"] = boost::json::string_view(&dog.dir, 1);
+        players[IdToKey(dog.id, key)] = std::move(player);
     }
-    res["players"] = players;
-    return serialize(res);
+    res["players"] = std::move(players);
+    return SerializeToResource(res, mr);
 }
 
-std::string GetPlayersJsonBody(const app::players_list::Result& dogs){
-    boost::json::object obj;
+std::pmr::string GetPlayersJsonBody(const app::players_list::Result& dogs, std::pmr::memory_resource* mr){
+    PmrResource resource{mr};
+    boost::json::storage_ptr sp{&resource};
+    boost::json::object obj(sp);
+    obj.reserve(dogs.size());
+    char key[16];
     for(const auto& dog : dogs){
-        boost::json::object player_obj;
-        player_obj["name"] = dog.name;
-        obj[dog.id] = player_obj;
+        boost::json::object player_obj(sp);
+        player_obj["name"] = boost::json::string_view(dog.name.data(), dog.name.size());
+        obj[IdToKey(dog.id, key)] = std::move(player_obj);
     }
-    return serialize(obj);
+    return SerializeToResource(obj, mr);
 }
 
 std::string SerializeEmptyJsonObject(){
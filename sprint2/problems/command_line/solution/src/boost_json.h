@@ -1,6 +1,7 @@
 #pragma once
 
 #include <filesystem>
+#include <memory_resource>
 #include <string>
 #include <boost/json.hpp>
 #include "application.h"
@@ -16,11 +17,24 @@ struct JoinRequest {
 
 JoinRequest ParseJoinRequest(const std::string& object);
 
+// Адаптер, через который boost::json выделяет память из std::pmr-ресурса (арены запроса)
+class PmrResource final : public boost::json::memory_resource {
+public:
+    explicit PmrResource(std::pmr::memory_resource* upstream) noexcept;
+private:
+    std::pmr::memory_resource* upstream_;
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const boost::json::memory_resource& other) const noexcept override;
+};
+
 std::string GetMapsJson(const app::list_maps::Result& maps);
 std::string GetMapJson(const app::map_info::Result& map);
-std::string GetGameSateJsonBody(const app::game_state::Result& dogs);
+// Дерево JSON и итоговая строка размещаются в ресурсе mr
+std::pmr::string GetGameSateJsonBody(const app::game_state::Result& dogs, std::pmr::memory_resource* mr);
 std::string GetPlayerJsonBody(const app::join_game::Result& player_data);
-std::string GetPlayersJsonBody(const app::players_list::Result& dogs);
+std::pmr::string GetPlayersJsonBody(const app::players_list::Result& dogs, std::pmr::memory_resource* mr);
 std::string SerializeEmptyJsonObject();
 
 
@@ -7,6 +7,7 @@
 #include <boost/log/utility/setup/common_attributes.hpp>
 #include <boost/log/utility/manipulators/add_value.hpp>
 #include <boost/json.hpp>
+#include <sstream>
 
 
 
@@ -80,6 +81,61 @@ void LogServerExited(){
                             << "server exited"sv;
 }
 
+void LogReplayFinished(const journal::Replay::Result& result){
+    std::ostringstream checksum;
+    checksum << std::hex << result.checksum;
+    json::value custom_data{
+          {"ticks"s, result.ticks}
+        , {"joins"s, result.joins}
+        , {"moves"s, result.moves}
+        , {"leaves"s, result.leaves}
+        , {"mismatches"s, result.mismatches}
+        , {"checksum"s, checksum.str()}
+        , {"elapsed_ms"s, std::chrono::duration_cast<std::chrono::milliseconds>(result.elapsed).count()}
+    };
+    if (result.first_mismatch) {
+        custom_data.as_object().emplace("first_mismatch"s, *result.first_mismatch);
+    }
+    BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, custom_data)
+                            << "replay finished"sv;
+}
+
+namespace {
+
+json::value GetHistogramJson(const util::Histogram& histogram) {
+    auto us = [](util::Histogram::Duration duration) {
+        return std::chrono::duration<double, std::micro>(duration).count();
+    };
+    return json::value{
+          {"count"s, histogram.GetCount()}
+        , {"mean_us"s, us(histogram.GetMean())}
+        , {"p50_us"s, us(histogram.GetPercentile(0.5))}
+        , {"p99_us"s, us(histogram.GetPercentile(0.99))}
+        , {"max_us"s, us(histogram.GetMax())}
+    };
+}
 
+} // namespace
+
+void LogTickStats(const tick::Stats& stats, const model::TickTimings& timings){
+    json::object phases;
+    for (size_t i = 0; i < static_cast<size_t>(model::TickPhase::Count); ++i) {
+        const auto phase = static_cast<model::TickPhase>(i);
+        phases.emplace(model::TickTimings::GetName(phase), GetHistogramJson(timings.Get(phase)));
+    }
+    json::value custom_data{
+          {"wakeups"s, stats.wakeups}
+        , {"steps"s, stats.steps}
+        , {"overruns"s, stats.overruns}
+        , {"missed_periods"s, stats.missed_periods}
+        , {"dropped_periods"s, stats.dropped_periods}
+        , {"long_steps"s, stats.long_steps}
+        , {"lateness"s, GetHistogramJson(stats.lateness)}
+        , {"step_time"s, GetHistogramJson(stats.step_time)}
+        , {"phases"s, std::move(phases)}
+    };
+    BOOST_LOG_TRIVIAL(info) << logging::add_value(additional_data, custom_data)
+                            << "tick stats"sv;
+}
 
 } // namespace boost_log
\ No newline at end of file
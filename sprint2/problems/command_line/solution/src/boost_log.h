@@ -1,6 +1,10 @@
 #pragma once
 
 #include <boost/log/trivial.hpp>     // для BOOST_LOG_TRIVIAL
+
+#include "journal.h"
+#include "model.h"
+#include "tick.h"
 // #include <boost/log/core.hpp>        // для logging::core
 // #include <boost/log/expressions.hpp> // для выражения, задающего фильтр
 // #include <boost/date_time.hpp>
@@ -29,6 +33,11 @@ void LogExitFailure(const std::exception& ex);
 
 void LogServerExited();
 
+void LogReplayFinished(const journal::Replay::Result& result);
+
+// Счётчики тикера и время фаз тиков
+void LogTickStats(const tick::Stats& stats, const model::TickTimings& timings);
+
 
 
 } // namespace boost_log
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "bots.h"
+
+#include <cmath>
+
+using namespace std::literals;
+
+namespace app {
+
+namespace {
+
+using NodeId = model::RoadNetwork::NodeId;
+using Location = model::RoadNetwork::Location;
+
+// Собака шириной 0.6 задевает офис шириной 0.5, если их центры ближе полусуммы ширин
+constexpr model::Dog::Dimension OFFICE_REACH = (0.6 + 0.5) / 2;
+
+model::Dog::Pos GetNodePos(const model::RoadNetwork& network, NodeId node) {
+    const auto pos = network.GetNodePos(node);
+    return {static_cast<model::Dog::Coord>(pos.x), static_cast<model::Dog::Coord>(pos.y)};
+}
+
+// Расстояние между точками одной дороги
+double GetLength(model::Dog::Pos from, model::Dog::Pos to) {
+    return std::abs(from.x - to.x) + std::abs(from.y - to.y);
+}
+
+bool IsSamePos(model::Dog::Pos lhs, model::Dog::Pos rhs) {
+    return lhs.x == rhs.x && lhs.y == rhs.y;
+}
+
+bool Contains(Location location, NodeId node) {
+    return location.node1 == node || location.node2 == node;
+}
+
+// Кратчайший путь от вершины до офиса: длина и вершина ребра офиса, через которую он проходит
+struct Approach {
+    double length;
+    NodeId entry;
+};
+
+std::optional<Approach> GetApproach(const routing::RoutePlanner& planner, const model::RoadNetwork& network,
+                                    NodeId node, model::Dog::Pos target_pos, Location target) {
+    std::optional<Approach> best;
+    for (const auto entry : {target.node1, target.node2}) {
+        const auto distance = planner.GetDistance(node, entry);
+        if (!distance) {
+            continue;
+        }
+        const double length = *distance + GetLength(GetNodePos(network, entry), target_pos);
+        if (!best || length < best->length) {
+            best = Approach{length, entry};
+        }
+    }
+    return best;
+}
+
+// Точка, до которой бот дойдёт по прямой следующим шагом маршрута.
+// nullopt, если офис недостижим
+std::optional<model::Dog::Pos> FindWaypoint(const routing::RoutePlanner& planner, const model::RoadNetwork& network,
+                                            model::Dog::Pos pos, Location here, model::Dog::Pos target_pos, Location target) {
+    const bool at_node = here.node1 == here.node2;
+    const bool target_at_node = target.node1 == target.node2;
+    // Бот и офис на одном ребре дорожной сети - идём прямо к офису
+    if ((here.node1 == target.node1 && here.node2 == target.node2)
+        || (at_node && Contains(target, here.node1))
+        || (target_at_node && Contains(here, target.node1))) {
+        return target_pos;
+    }
+    if (at_node) {
+        const auto approach = GetApproach(planner, network, here.node1, target_pos, target);
+        if (!approach) {
+            return std::nullopt;
+        }
+        return GetNodePos(network, *planner.GetNextHop(here.node1, approach->entry));
+    }
+    // Бот между вершинами - идёт к той, через которую путь короче
+    std::optional<std::pair<double, NodeId>> best;
+    for (const auto node : {here.node1, here.node2}) {
+        if (const auto approach = GetApproach(planner, network, node, target_pos, target)) {
+            const double length = GetLength(pos, GetNodePos(network, node)) + approach->length;
+            if (!best || length < best->first) {
+                best = std::pair{length, node};
+            }
+        }
+    }
+    if (!best) {
+        return std::nullopt;
+    }
+    return GetNodePos(network, best->second);
+}
+
+} // namespace
+
+BotController::BotController(model::Game& game)
+    : game_(game) {
+}
+
+void BotController::AddBots(size_t count_per_map) {
+    if (count_per_map == 0) {
+        return;
+    }
+    // Боты нужны на каждой карте, поэтому отложенные карты строятся здесь
+    for (size_t map_index = 0; map_index < game_.GetMapHeaders().size(); ++map_index) {
+        const auto& map = game_.GetMap(map_index);
+        const auto& routes = GetRoutes(map);
+        for (size_t i = 0; i < count_per_map; ++i) {
+            auto session = game_.GetSession(&map);
+            auto dog = session->AddDog(game_.NewDogId(), "bot"s + std::to_string(bots_.size()), false);
+            // Боты одной карты идут к разным офисам
+            const size_t target = routes.targets.empty() ? 0 : i % routes.targets.size();
+            bots_.push_back({session, dog.GetHandle(), &routes, target, dog.GetPos()});
+        }
+    }
+}
+
+size_t BotController::GetBotCount() const noexcept {
+    return bots_.size();
+}
+
+void BotController::Update() {
+    for (auto& bot : bots_) {
+        Steer(bot);
+    }
+}
+
+const BotController::MapRoutes& BotController::GetRoutes(const model::Map& map) {
+    auto [it, inserted] = map_routes_.try_emplace(&map);
+    if (inserted) {
+        const auto& network = map.GetRoadNetwork();
+        it->second.planner = routing::RoutePlanner(network);
+        // Офисы не на дорогах недостижимы, боты к ним не ходят
+        const auto& offices = map.GetOffices();
+        for (size_t office = 0; office < offices.size(); ++office) {
+            const auto pos = offices[office].GetPosition();
+            if (const auto location = network.Locate(pos.x, pos.y)) {
+                it->second.targets.push_back({{static_cast<model::Dog::Coord>(pos.x), static_cast<model::Dog::Coord>(pos.y)}, *location
+                                              , static_cast<model::ItemGrid::ItemId>(office)});
+            }
+        }
+    }
+    return it->second;
+}
+
+void BotController::Steer(Bot& bot) {
+    auto dog = bot.session->GetDog(bot.dog);
+    const auto speed = dog.GetSpeed();
+    const auto& targets = bot.routes->targets;
+    if (speed.dir_x != 0.0 || speed.dir_y != 0.0 || targets.empty()) {
+        return;
+    }
+    const auto& network = bot.session->GetMap().GetRoadNetwork();
+    const auto pos = dog.GetPos();
+    const auto here = network.Locate(pos.x, pos.y);
+    if (!here) {
+        return;
+    }
+    // Путь от прошлой остановки прошёл мимо офиса, к которому шёл бот
+    bool visited = false;
+    bot.session->GetMap().ForEachOfficeNear({bot.last_stop, pos}, OFFICE_REACH, [&](model::ItemGrid::ItemId office) {
+        visited = visited || office == targets[bot.target].office;
+    });
+    bot.last_stop = pos;
+    if (visited) {
+        bot.target = (bot.target + 1) % targets.size();
+    }
+    const auto& target = targets[bot.target];
+    const auto waypoint = FindWaypoint(bot.routes->planner, network, pos, *here, target.pos, target.location);
+    if (!waypoint) {
+        // Офис недостижим, на следующем тике бот пойдёт к следующему
+        bot.target = (bot.target + 1) % targets.size();
+        return;
+    }
+    if (IsSamePos(pos, *waypoint)) {
+        return;
+    }
+    // Бот идёт вдоль дороги и останавливается точно в точке маршрута
+    if (waypoint->x != pos.x) {
+        const auto dir = waypoint->x > pos.x ? model::Dog::Dir::Right : model::Dog::Dir::Left;
+        bot.session->PushCommand({bot.dog, dir, waypoint->x});
+    } else {
+        const auto dir = waypoint->y > pos.y ? model::Dog::Dir::Down : model::Dog::Dir::Up;
+        bot.session->PushCommand({bot.dog, dir, waypoint->y});
+    }
+}
+
+} // namespace app
@@ -0,0 +1,56 @@
+#pragma once
+#include "model.h"
+#include "route_planner.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace app {
+
+// Боты - собаки, которыми управляет сервер. Бот ходит от офиса к офису своей
+// карты по кратчайшим путям. Офис считается посещённым, когда бот прошёл рядом
+// с ним, это проверяется по индексу офисов карты. Маршрут считается только для остановившегося бота:
+// он получает направление и точку остановки в следующей вершине маршрута,
+// поэтому пока бот идёт, он не требует никакой работы
+class BotController {
+public:
+    explicit BotController(model::Game& game);
+    BotController(const BotController&) = delete;
+    BotController& operator=(const BotController&) = delete;
+
+    // Добавляет count ботов на каждую карту. Дорожная сеть карты
+    // предобрабатывается при добавлении первого бота на неё
+    void AddBots(size_t count_per_map);
+    size_t GetBotCount() const noexcept;
+    // Ставит в очереди сессий команды остановившимся ботам. Вызывается в strand перед тиком
+    void Update();
+
+private:
+    // Офис на дороге, к которому бот может прийти
+    struct Target {
+        model::Dog::Pos pos;
+        model::RoadNetwork::Location location;
+        model::ItemGrid::ItemId office; // индекс в Map::GetOffices()
+    };
+    struct MapRoutes {
+        routing::RoutePlanner planner;
+        std::vector<Target> targets;
+    };
+    struct Bot {
+        std::shared_ptr<model::GameSession> session;
+        model::Dog::Handle dog;
+        const MapRoutes* routes;
+        size_t target; // индекс офиса в routes->targets
+        model::Dog::Pos last_stop; // где бот остановился в прошлый раз
+    };
+
+    model::Game& game_;
+    std::unordered_map<const model::Map*, MapRoutes> map_routes_;
+    std::vector<Bot> bots_;
+
+    const MapRoutes& GetRoutes(const model::Map& map);
+    void Steer(Bot& bot);
+};
+
+} // namespace app
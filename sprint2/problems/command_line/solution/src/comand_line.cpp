@@ -17,6 +17,22 @@ using namespace std::literals;
         ("www-root,w", po::value(&args.www_root)->value_name("path"s), "set static files root")
         ("tick-period,t", po::value(&args.tick_period)->value_name("ms"s), "set tick period")
         ("randomize-spawn-points", po::value(&args.randomize_spawn_points), "spawn dogs at random positions")
+        ("player-rate-limit", po::value(&args.player_rate_limit)->value_name("rps"s), "max API requests per second for one player token (0 - no limit)")
+        ("player-rate-burst", po::value(&args.player_rate_burst)->value_name("count"s), "max burst of API requests for one player token")
+        ("ip-rate-limit", po::value(&args.ip_rate_limit)->value_name("rps"s), "max API requests per second from one IP address (0 - no limit)")
+        ("ip-rate-burst", po::value(&args.ip_rate_burst)->value_name("count"s), "max burst of API requests from one IP address")
+        ("tick-threads", po::value(&args.tick_threads)->value_name("count"s), "number of threads stepping game sessions during a tick")
+        ("max-players-per-session", po::value(&args.max_players_per_session)->value_name("count"s), "max players in one game session (0 - no limit)")
+        ("session-policy", po::value(&args.session_policy)->value_name("policy"s), "session for a new player: fill-first or least-loaded")
+        ("bots", po::value(&args.bots)->value_name("count"s), "number of server-driven bots on each map")
+        ("view-radius", po::value(&args.view_radius)->value_name("distance"s), "default area of interest radius for game state (0 - whole session)")
+        ("seed", po::value<uint64_t>()->value_name("number"s), "seed of all random generators, makes the game reproducible")
+        ("journal", po::value(&args.journal_file)->value_name("file"s), "record joins, player actions and ticks to a journal")
+        ("tick-policy", po::value(&args.tick_policy)->value_name("policy"s), "late ticks: catch-up (several fixed steps) or coalesce (one longer step)")
+        ("max-tick-substeps", po::value(&args.max_tick_substeps)->value_name("count"s), "max fixed steps per timer wakeup with catch-up policy, the rest is dropped")
+        ("tick-stats-period", po::value(&args.tick_stats_period)->value_name("seconds"s), "log tick overruns and phase timings with this period (0 - only at exit)")
+        ("lazy-maps", po::bool_switch(&args.lazy_maps), "build each map on first use, at startup read only map ids and names")
+        ("replay", po::value(&args.replay_file)->value_name("file"s), "replay a journal offline at full speed and exit (same config and game options as recorded)")
         ;
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -31,10 +47,23 @@ using namespace std::literals;
         throw std::runtime_error("Config file have not been specified!"s);
     }
 
-    if (!vm.contains("www-root"s)) {
+    if (vm.contains("seed"s)) {
+        args.seed = vm["seed"s].as<uint64_t>();
+    }
+
+    // Повтор журнала не запускает сервер, статические файлы ему не нужны
+    if (!vm.contains("www-root"s) && args.replay_file.empty()) {
         throw std::runtime_error("Static files have not been specified!"s);
     }
 
+    if (args.session_policy != "fill-first"s && args.session_policy != "least-loaded"s) {
+        throw std::runtime_error("Unknown session policy: "s + args.session_policy);
+    }
+
+    if (args.tick_policy != "catch-up"s && args.tick_policy != "coalesce"s) {
+        throw std::runtime_error("Unknown tick policy: "s + args.tick_policy);
+    }
+
     return args;
 }
 
@@ -12,6 +12,22 @@ struct Args {
     std::string config_file{};
     std::string www_root{};
     bool randomize_spawn_points{};
+    double player_rate_limit{};
+    double player_rate_burst{1.0};
+    double ip_rate_limit{};
+    double ip_rate_burst{1.0};
+    unsigned tick_threads{1};
+    size_t max_players_per_session{}; // 0 - без ограничения
+    std::string session_policy{"fill-first"};
+    size_t bots{}; // ботов на каждой карте
+    double view_radius{}; // 0 - без ограничения
+    std::optional<uint64_t> seed{}; // без зерна игра не воспроизводится
+    std::string journal_file{}; // журнал входных событий, пусто - не пишется
+    std::string replay_file{}; // повторить журнал без сервера и завершиться
+    bool lazy_maps{}; // строить карты при первом обращении
+    std::string tick_policy{"catch-up"};
+    unsigned max_tick_substeps{4};
+    double tick_stats_period{}; // секунд, 0 - статистика тиков только при завершении
 }; 
 
 
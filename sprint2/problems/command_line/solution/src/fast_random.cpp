@@ -0,0 +1,53 @@
+#include "fast_random.h"
+
+#include <cmath>
+#include <numeric>
+#include <random>
+
+namespace util {
+
+uint64_t MakeRandomSeed() {
+    std::random_device random_device;
+    return (static_cast<uint64_t>(random_device()) << 32) | random_device();
+}
+
+AliasTable::AliasTable(const std::vector<double>& weights)
+    : probability_(weights.size())
+    , alias_(weights.size()) {
+    const size_t count = weights.size();
+    const double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+    // Веса, нормированные так, что средний вес равен 1
+    std::vector<double> scaled(count);
+    for (size_t i = 0; i < count; ++i) {
+        scaled[i] = total > 0 ? weights[i] * count / total : 1.0;
+    }
+
+    std::vector<uint32_t> small, large;
+    for (size_t i = 0; i < count; ++i) {
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+    // Каждый столбец с весом меньше 1 дополняется до 1 из столбца с большим весом
+    while (!small.empty() && !large.empty()) {
+        const uint32_t less = small.back();
+        small.pop_back();
+        const uint32_t more = large.back();
+        probability_[less] = static_cast<uint64_t>(std::ldexp(scaled[less], 32));
+        alias_[less] = more;
+        scaled[more] -= 1.0 - scaled[less];
+        if (scaled[more] < 1.0) {
+            large.pop_back();
+            small.push_back(more);
+        }
+    }
+    // Оставшиеся столбцы (с точностью до погрешности округления) заполнены целиком
+    for (const auto i : large) {
+        probability_[i] = uint64_t{1} << 32;
+        alias_[i] = i;
+    }
+    for (const auto i : small) {
+        probability_[i] = uint64_t{1} << 32;
+        alias_[i] = i;
+    }
+}
+
+} // namespace util
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace util {
+
+// Быстрый генератор псевдослучайных чисел SplitMix64.
+// Удовлетворяет требованиям UniformRandomBitGenerator
+class SplitMix64 {
+public:
+    using result_type = uint64_t;
+
+    explicit SplitMix64(uint64_t seed) noexcept
+        : state_{seed} {
+    }
+
+    static constexpr result_type min() noexcept {
+        return 0;
+    }
+    static constexpr result_type max() noexcept {
+        return UINT64_MAX;
+    }
+
+    result_type operator()() noexcept {
+        uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // Равномерно распределённое число из [0, 1)
+    double NextDouble() noexcept {
+        return static_cast<double>((*this)() >> 11) * 0x1.0p-53;
+    }
+
+private:
+    uint64_t state_;
+};
+
+// Зерно из std::random_device для генераторов, которым зерно не задано явно
+uint64_t MakeRandomSeed();
+
+// Таблица псевдонимов (метод Уолкера - Воуза): выбор индекса с вероятностью,
+// пропорциональной его весу, за O(1) и без выделения памяти
+class AliasTable {
+public:
+    AliasTable() = default;
+    // Если все веса нулевые, индексы выбираются равновероятно
+    explicit AliasTable(const std::vector<double>& weights);
+
+    size_t Size() const noexcept {
+        return probability_.size();
+    }
+
+    // Таблица не должна быть пустой
+    size_t Sample(SplitMix64& random) const noexcept {
+        const uint64_t bits = random();
+        // Старшие 32 бита выбирают столбец, младшие - сторону столбца
+        const size_t column = static_cast<size_t>(((bits >> 32) * probability_.size()) >> 32);
+        const uint32_t threshold = static_cast<uint32_t>(bits);
+        return threshold < probability_[column] ? column : alias_[column];
+    }
+
+private:
+    // Вероятность остаться в столбце, умноженная на 2^32
+    std::vector<uint64_t> probability_;
+    std::vector<uint32_t> alias_;
+};
+
+} // namespace util
@@ -0,0 +1,46 @@
+#include "histogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace util {
+
+void Histogram::Record(Duration duration) noexcept {
+    const auto ns = static_cast<uint64_t>(std::max<Duration::rep>(duration.count(), 0));
+    const auto bucket = std::min<size_t>(std::bit_width(ns), BUCKETS - 1);
+    ++buckets_[bucket];
+    ++count_;
+    sum_ += duration;
+    max_ = std::max(max_, duration);
+}
+
+uint64_t Histogram::GetCount() const noexcept {
+    return count_;
+}
+
+Histogram::Duration Histogram::GetMax() const noexcept {
+    return max_;
+}
+
+Histogram::Duration Histogram::GetMean() const noexcept {
+    return count_ == 0 ? Duration{} : sum_ / static_cast<Duration::rep>(count_);
+}
+
+Histogram::Duration Histogram::GetPercentile(double quantile) const noexcept {
+    if (count_ == 0) {
+        return {};
+    }
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantile * count_)));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+        seen += buckets_[bucket];
+        if (seen >= rank) {
+            // Верхняя граница корзины, но не больше наибольшей записанной длительности
+            return std::min(Duration{static_cast<Duration::rep>((uint64_t{1} << bucket) - 1)}, max_);
+        }
+    }
+    return max_;
+}
+
+} // namespace util
@@ -0,0 +1,31 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace util {
+
+// Гистограмма длительностей с логарифмическими корзинами: в корзину k попадают
+// длительности из [2^(k-1), 2^k) нс. Запись - O(1) без выделения памяти,
+// процентили оцениваются верхней границей корзины (с точностью до двух раз)
+class Histogram {
+public:
+    using Duration = std::chrono::nanoseconds;
+
+    void Record(Duration duration) noexcept;
+
+    uint64_t GetCount() const noexcept;
+    Duration GetMax() const noexcept;
+    Duration GetMean() const noexcept;
+    // Оценка сверху для доли quantile записанных длительностей, quantile из [0, 1]
+    Duration GetPercentile(double quantile) const noexcept;
+
+private:
+    static constexpr size_t BUCKETS = 48; // до 2^47 нс - больше полутора суток
+    std::array<uint64_t, BUCKETS> buckets_{};
+    uint64_t count_ = 0;
+    Duration sum_{};
+    Duration max_{};
+};
+
+} // namespace util
@@ -0,0 +1,113 @@
+#include "journal.h"
+#include "application.h"
+
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+using namespace std::literals;
+
+namespace journal {
+
+namespace {
+
+constexpr char NO_DIR = '-'; // команда остановки
+
+} // namespace
+
+Writer::Writer(const std::filesystem::path& path, uint64_t seed)
+    : out_(path) {
+    if (!out_) {
+        throw std::runtime_error("Can't open journal "s + path.string());
+    }
+    out_ << "seed "sv << seed << '\n';
+}
+
+void Writer::Join(std::string_view token, std::string_view map_id, std::string_view name) {
+    out_ << "join "sv << token << ' ' << std::quoted(map_id) << ' ' << std::quoted(name) << '\n';
+}
+
+void Writer::Move(std::string_view token, char dir) {
+    out_ << "move "sv << token << ' ' << (dir ? dir : NO_DIR) << '\n';
+}
+
+void Writer::Leave(std::string_view token) {
+    out_ << "leave "sv << token << '\n';
+}
+
+void Writer::Tick(std::chrono::milliseconds time_delta, uint64_t checksum) {
+    out_ << "tick "sv << time_delta.count() << ' ' << std::hex << checksum << std::dec << '\n';
+    // Журнал должен пережить аварийное завершение сервера хотя бы до последнего тика
+    out_.flush();
+}
+
+Replay::Replay(const std::filesystem::path& path)
+    : in_(path) {
+    if (!in_) {
+        throw std::runtime_error("Can't open journal "s + path.string());
+    }
+    std::string command;
+    if (!(in_ >> command >> seed_) || command != "seed"sv) {
+        throw std::runtime_error("Journal "s + path.string() + " has no seed"s);
+    }
+}
+
+uint64_t Replay::GetSeed() const noexcept {
+    return seed_;
+}
+
+Replay::Result Replay::Run(app::Application& application) {
+    Result result;
+    // Записанный токен -> токен игрока при повторе. С тем же зерном они совпадают
+    std::unordered_map<std::string, std::string> tokens;
+    auto get_token = [&tokens](const std::string& recorded) -> const std::string& {
+        const auto it = tokens.find(recorded);
+        if (it == tokens.end()) {
+            throw std::runtime_error("Journal refers to unknown token "s + recorded);
+        }
+        return it->second;
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    std::string command, token, map_id, name;
+    while (in_ >> command) {
+        if (command == "join"sv) {
+            in_ >> token >> std::quoted(map_id) >> std::quoted(name);
+            tokens[token] = *application.AddPlayer(name, map_id).token;
+            ++result.joins;
+        } else if (command == "move"sv) {
+            char dir{};
+            in_ >> token >> dir;
+            application.SetDogDirect(get_token(token), dir == NO_DIR ? 0 : dir);
+            ++result.moves;
+        } else if (command == "leave"sv) {
+            in_ >> token;
+            application.RemovePlayer(get_token(token));
+            tokens.erase(token);
+            ++result.leaves;
+        } else if (command == "tick"sv) {
+            int64_t delta{};
+            uint64_t recorded{};
+            in_ >> delta >> std::hex >> recorded >> std::dec;
+            application.ChangeGameSate(std::chrono::milliseconds{delta});
+            result.checksum = application.GetStateChecksum();
+            ++result.ticks;
+            if (result.checksum != recorded) {
+                ++result.mismatches;
+                if (!result.first_mismatch) {
+                    result.first_mismatch = result.ticks;
+                }
+            }
+        } else {
+            throw std::runtime_error("Unknown journal event "s + command);
+        }
+        if (in_.fail()) {
+            throw std::runtime_error("Malformed journal event "s + command);
+        }
+    }
+    result.elapsed = std::chrono::steady_clock::now() - start;
+    return result;
+}
+
+} // namespace journal
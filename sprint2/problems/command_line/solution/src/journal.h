@@ -0,0 +1,62 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string_view>
+
+namespace app {
+class Application;
+} // namespace app
+
+namespace journal {
+
+// Журнал входных событий игры: зерно генераторов, входы и выходы игроков, их команды
+// и тики с контрольной суммой состояния после тика. Текстовый формат, по событию в строке:
+//   seed <зерно>
+//   join <токен> "<карта>" "<имя>"
+//   move <токен> <направление или ->
+//   leave <токен>
+//   tick <мс> <контрольная сумма>
+// Повтор журнала на той же конфигурации и с теми же параметрами игры воспроизводит
+// игру тик в тик, а расхождение контрольных сумм указывает первый отличающийся тик
+class Writer {
+public:
+    Writer(const std::filesystem::path& path, uint64_t seed);
+
+    void Join(std::string_view token, std::string_view map_id, std::string_view name);
+    void Move(std::string_view token, char dir);
+    void Leave(std::string_view token);
+    void Tick(std::chrono::milliseconds time_delta, uint64_t checksum);
+
+private:
+    std::ofstream out_;
+};
+
+class Replay {
+public:
+    struct Result {
+        size_t ticks = 0;
+        size_t joins = 0;
+        size_t moves = 0;
+        size_t leaves = 0;
+        size_t mismatches = 0; // тики, контрольная сумма которых не совпала с записанной
+        std::optional<size_t> first_mismatch; // номер первого такого тика, с 1
+        uint64_t checksum = 0; // после последнего тика
+        std::chrono::steady_clock::duration elapsed{};
+    };
+
+    // Открывает журнал и читает зерно, которое нужно задать игре до её начала
+    explicit Replay(const std::filesystem::path& path);
+
+    uint64_t GetSeed() const noexcept;
+    // Повторяет события журнала без задержек между тиками
+    Result Run(app::Application& application);
+
+private:
+    std::ifstream in_;
+    uint64_t seed_ = 0;
+};
+
+} // namespace journal
@@ -3,8 +3,12 @@
 #include "boost_json.h"
 
 
+#include <cctype>
 #include <filesystem>
 #include <fstream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
 
 using namespace std;
 using namespace std::literals;
@@ -51,38 +55,243 @@ void AddOffices(model::Map& map, const boost_json::ArrayJsonValue& offices){
     }
 }
 
-void LoadGame(model::Game& game,const std::filesystem::path& json_path) {
-    // Загрузить содержимое файла json_path, например, в виде строки
-    // Распарсить строку как JSON, используя boost::json::parse
-    // Загрузить модель игры из файла
-    using IdMap = util::Tagged<std::string, model::Map>;
+namespace {
 
-    const auto json_obj = boost_json::ParseFile(json_path);
+using IdMap = util::Tagged<std::string, model::Map>;
+
+// Параметры игры из корня конфигурации
+void LoadSettings(model::Game& game, const boost_json::JsonValue& json_obj) {
     // Устанавливаем скорость собак по умолчаниюю для всех карт
     if(json_obj.ContainsParam("defaultDogSpeed"s)){ //если есть
         game.SetDefaultDogSpeed(json_obj.GetParamAsDouble("defaultDogSpeed"s));
     } else { // если нет - записываем скорость по умолчанию 1.0
         game.SetDefaultDogSpeed(1.0);
     };
+    // Время простоя (в секундах), после которого собака уходит из игры. Без параметра собаки не уходят
+    if(json_obj.ContainsParam("dogRetirementTime"s)){
+        const std::chrono::duration<double> retirement_time{json_obj.GetParamAsDouble("dogRetirementTime"s)};
+        game.SetDogRetirementTime(std::chrono::duration_cast<std::chrono::milliseconds>(retirement_time));
+    }
+}
+
+model::Map LoadMap(const boost_json::JsonValue& jmap, model::Dog::Dimension default_dog_speed) {
+    std::string id =  jmap.GetParamAsString("id"s);
+    std::string name =  jmap.GetParamAsString("name"s);
     
-    const auto jmaps = json_obj.GetParamAsArray("maps"s);
-    for(const auto& jmap : jmaps){
-        std::string id =  jmap.GetParamAsString("id"s);
-        std::string name =  jmap.GetParamAsString("name"s);
-        
-        model::Map map(IdMap(id), name);
+    model::Map map(IdMap(id), name);
 
-        AddRoads(map, jmap.GetParamAsArray("roads"s));
-        AddBuildings(map, jmap.GetParamAsArray("buildings"s));
-        AddOffices(map, jmap.GetParamAsArray("offices"s));
-        // Если для карты есть скорость записываем ее в модель
-        if(jmap.ContainsParam("dogSpeed"s)){
-            map.SetDogSpeed(jmap.GetParamAsDouble("dogSpeed"s));
-        } else { // если нет - записываем скорость по умолчанию для всех карт
-            map.SetDogSpeed(game.GetDefaultDogSpeed());
-        };
+    AddRoads(map, jmap.GetParamAsArray("roads"s));
+    AddBuildings(map, jmap.GetParamAsArray("buildings"s));
+    AddOffices(map, jmap.GetParamAsArray("offices"s));
+    // Если для карты есть скорость записываем ее в модель
+    if(jmap.ContainsParam("dogSpeed"s)){
+        map.SetDogSpeed(jmap.GetParamAsDouble("dogSpeed"s));
+    } else { // если нет - записываем скорость по умолчанию для всех карт
+        map.SetDogSpeed(default_dog_speed);
+    };
+    return map;
+}
 
-        game.AddMap(move(map));
+// Границы JSON-значений в тексте конфигурации. Разбор ограничен тем, что нужно
+// для каталога карт: значение пропускается целиком, не строя дерево
+class JsonScanner {
+public:
+    explicit JsonScanner(std::string_view text)
+        : text_(text) {
+    }
+
+    // Позиция первого непробельного символа, начиная с pos
+    size_t SkipSpaces(size_t pos) const {
+        while (pos < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos]))) {
+            ++pos;
+        }
+        return pos;
+    }
+
+    // Позиция сразу за значением, которое начинается в pos
+    size_t SkipValue(size_t pos) const {
+        pos = SkipSpaces(pos);
+        if (pos >= text_.size()) {
+            throw std::runtime_error("Unexpected end of config"s);
+        }
+        if (text_[pos] == '"') {
+            return SkipString(pos);
+        }
+        if (text_[pos] != '{' && text_[pos] != '[') {
+            // число, true, false или null
+            while (pos < text_.size() && text_[pos] != ',' && text_[pos] != '}' && text_[pos] != ']'
+                   && !std::isspace(static_cast<unsigned char>(text_[pos]))) {
+                ++pos;
+            }
+            return pos;
+        }
+        int depth = 0;
+        while (pos < text_.size()) {
+            const char c = text_[pos];
+            if (c == '"') {
+                pos = SkipString(pos);
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                ++depth;
+            } else if ((c == '}' || c == ']') && --depth == 0) {
+                return pos + 1;
+            }
+            ++pos;
+        }
+        throw std::runtime_error("Unexpected end of config"s);
+    }
+
+    // Вызывает f(key, value_begin, value_end) для полей объекта, который начинается в pos.
+    // key - ключ в кавычках, как в тексте
+    template <typename F>
+    void ForEachMember(size_t pos, F&& f) const {
+        pos = Expect(pos, '{');
+        if (Peek(pos) == '}') {
+            return;
+        }
+        while (true) {
+            pos = SkipSpaces(pos);
+            const size_t key_end = SkipString(pos);
+            const auto key = text_.substr(pos, key_end - pos);
+            const size_t value_begin = SkipSpaces(Expect(key_end, ':'));
+            const size_t value_end = SkipValue(value_begin);
+            f(key, value_begin, value_end);
+            pos = SkipSpaces(value_end);
+            if (Peek(pos) == '}') {
+                return;
+            }
+            pos = Expect(pos, ',');
+        }
+    }
+
+    // Вызывает f(begin, end) для элементов массива, который начинается в pos
+    template <typename F>
+    void ForEachElement(size_t pos, F&& f) const {
+        pos = Expect(pos, '[');
+        if (Peek(pos) == ']') {
+            return;
+        }
+        while (true) {
+            const size_t begin = SkipSpaces(pos);
+            const size_t end = SkipValue(begin);
+            f(begin, end);
+            pos = SkipSpaces(end);
+            if (Peek(pos) == ']') {
+                return;
+            }
+            pos = Expect(pos, ',');
+        }
+    }
+
+private:
+    std::string_view text_;
+
+    size_t SkipString(size_t pos) const {
+        if (text_[pos] != '"') {
+            throw std::runtime_error("Expected string in config"s);
+        }
+        for (++pos; pos < text_.size(); ++pos) {
+            if (text_[pos] == '\\') {
+                ++pos;
+            } else if (text_[pos] == '"') {
+                return pos + 1;
+            }
+        }
+        throw std::runtime_error("Unexpected end of config"s);
+    }
+
+    char Peek(size_t pos) const {
+        pos = SkipSpaces(pos);
+        return pos < text_.size() ? text_[pos] : '\0';
+    }
+
+    // Позиция за символом c, который должен стоять в pos после пробелов
+    size_t Expect(size_t pos, char c) const {
+        pos = SkipSpaces(pos);
+        if (pos >= text_.size() || text_[pos] != c) {
+            throw std::runtime_error("Expected '"s + c + "' in config"s);
+        }
+        return pos + 1;
+    }
+};
+
+std::string ReadFile(const std::filesystem::path& path) {
+    std::ifstream in_file(path, std::ios::binary);
+    if (!in_file){
+        throw std::runtime_error("Can't open config file: "s + path.string());
+    };
+    std::ostringstream sstr;
+    sstr << in_file.rdbuf();
+    return sstr.str();
+}
+
+// Часть файла [offset, offset + size)
+std::string ReadFileRange(const std::filesystem::path& path, size_t offset, size_t size) {
+    std::ifstream in_file(path, std::ios::binary);
+    std::string text(size, '\0');
+    if (!in_file || !in_file.seekg(offset) || !in_file.read(text.data(), size)){
+        throw std::runtime_error("Can't read map from config file: "s + path.string());
+    };
+    return text;
+}
+
+// Строковое значение JSON с разбором escape-последовательностей
+std::string ParseString(std::string_view value) {
+    return boost_json::ParseStr("{\"value\":"s + std::string(value) + "}"s).GetParamAsString("value"s);
+}
+
+void LoadGameLazily(model::Game& game, const std::filesystem::path& json_path) {
+    const auto text = ReadFile(json_path);
+    const JsonScanner scanner{text};
+    std::optional<std::pair<size_t, size_t>> maps;
+    scanner.ForEachMember(0, [&](std::string_view key, size_t begin, size_t end) {
+        if (key == "\"maps\""sv) {
+            maps.emplace(begin, end);
+        }
+    });
+    if (!maps) {
+        throw std::runtime_error("Config has no maps"s);
+    }
+    // Параметры игры читаются из конфигурации без карт
+    LoadSettings(game, boost_json::ParseStr(text.substr(0, maps->first) + "[]"s + text.substr(maps->second)));
+
+    const auto default_dog_speed = game.GetDefaultDogSpeed();
+    scanner.ForEachElement(maps->first, [&](size_t begin, size_t end) {
+        std::optional<std::string> id, name;
+        scanner.ForEachMember(begin, [&](std::string_view key, size_t value_begin, size_t value_end) {
+            if (key == "\"id\""sv) {
+                id = ParseString(std::string_view(text).substr(value_begin, value_end - value_begin));
+            } else if (key == "\"name\""sv) {
+                name = ParseString(std::string_view(text).substr(value_begin, value_end - value_begin));
+            }
+        });
+        if (!id || !name) {
+            throw std::runtime_error("Map without id or name in config"s);
+        }
+        // Карта хранится в каталоге только положением в файле
+        game.AddLazyMap(IdMap(*id), std::move(*name), [json_path, begin, size = end - begin, default_dog_speed] {
+            return LoadMap(boost_json::ParseStr(ReadFileRange(json_path, begin, size)), default_dog_speed);
+        });
+    });
+}
+
+} // namespace
+
+void LoadGame(model::Game& game, const std::filesystem::path& json_path, bool lazy_maps) {
+    if (lazy_maps) {
+        LoadGameLazily(game, json_path);
+        return;
+    }
+    // Загрузить содержимое файла json_path, например, в виде строки
+    // Распарсить строку как JSON, используя boost::json::parse
+    // Загрузить модель игры из файла
+    const auto json_obj = boost_json::ParseFile(json_path);
+    LoadSettings(game, json_obj);
+
+    const auto jmaps = json_obj.GetParamAsArray("maps"s);
+    for(const auto& jmap : jmaps){
+        game.AddMap(LoadMap(jmap, game.GetDefaultDogSpeed()));
     }
 }
 
@@ -7,6 +7,8 @@
 
 namespace json_loader {
 
-void LoadGame(model::Game& game,const std::filesystem::path& json_path);
+// lazy_maps - при загрузке читаются только идентификаторы и названия карт и их
+// положение в файле, карта строится из своей части файла при первом обращении
+void LoadGame(model::Game& game,const std::filesystem::path& json_path, bool lazy_maps = false);
 
 }  // namespace json_loader
@@ -48,7 +48,7 @@ public:
         };
 
         // Обработать запрос request и отправить ответ, используя send
-        true_handler_(std::forward<decltype(req)>(req), std::move(sender));
+        true_handler_(end_point, std::forward<decltype(req)>(req), std::move(sender));
     }
 
 
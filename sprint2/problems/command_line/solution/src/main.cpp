@@ -66,7 +66,21 @@ int main(int argc, const char* argv[]) {
 
         // 1. Загружаем карту из файла и строим модель игры
         model::Game game(args->randomize_spawn_points);
-        json_loader::LoadGame(game, config_file);
+        json_loader::LoadGame(game, config_file, args->lazy_maps);
+        game.SetTickThreads(args->tick_threads);
+        game.SetSessionLimit(args->max_players_per_session, args->session_policy == "least-loaded"s
+            ? model::SessionPolicy::LeastLoaded : model::SessionPolicy::FillFirst);
+
+        // Повтор журнала: игра с зерном из журнала проходит записанные события без сервера
+        if (!args->replay_file.empty()) {
+            journal::Replay replay{args->replay_file};
+            app::Application application(game);
+            application.SetRandomSeed(replay.GetSeed());
+            application.AddBots(args->bots);
+            const auto result = replay.Run(application);
+            boost_log::LogReplayFinished(result);
+            return result.mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
 
         // 2. Инициализируем io_context
         const unsigned num_threads = std::thread::hardware_concurrency();
@@ -79,10 +93,24 @@ int main(int argc, const char* argv[]) {
         });
         // 4. Создаём обработчик HTTP-запросов и связываем его с моделью игры через объект с сценариями игры (application)
         // strand для выполнения запросов к API
-        app::Application application(game);
+        app::Application application(game, {args->player_rate_limit, args->player_rate_burst});
+        // Журнал можно повторить только с известным зерном, поэтому без --seed оно выбирается здесь
+        auto seed = args->seed;
+        if (!seed && !args->journal_file.empty()) {
+            seed = util::MakeRandomSeed();
+        }
+        if (seed) {
+            application.SetRandomSeed(*seed);
+        }
+        if (!args->journal_file.empty()) {
+            application.SetJournal(std::make_unique<journal::Writer>(args->journal_file, *seed));
+        }
+        application.AddBots(args->bots);
+        application.SetDefaultViewRadius(args->view_radius);
         auto api_strand = net::make_strand(ioc);
         const bool is_test_tick_mode = args->tick_period == 0; 
-        auto handler = std::make_shared<http_handler::RequestHandler>(application, static_content_path, api_strand, is_test_tick_mode);
+        auto handler = std::make_shared<http_handler::RequestHandler>(application, static_content_path, api_strand
+            , is_test_tick_mode, rate_limiter::Config{args->ip_rate_limit, args->ip_rate_burst});
         // http_handler::RequestHandler handler{game, static_content_path, api_strand};
         log_handler::LoggingRequestHandler logging_handler{*handler};
 
@@ -95,10 +123,16 @@ int main(int argc, const char* argv[]) {
         });
 
         // 6. Настраиваем вызов метода Application::Tick каждые хх миллисекунд внутри strand
+        std::shared_ptr<tick::Ticker> ticker;
         if(!is_test_tick_mode){
-            auto ticker = std::make_shared<tick::Ticker>(api_strand, std::chrono::milliseconds(args->tick_period),
-                [&application](std::chrono::milliseconds delta) { application.ChangeGameSate(delta); }
+            const tick::Policy policy{args->tick_policy == "coalesce"s ? tick::Policy::Mode::Coalesce : tick::Policy::Mode::CatchUp
+                                      , args->max_tick_substeps};
+            ticker = std::make_shared<tick::Ticker>(api_strand, std::chrono::milliseconds(args->tick_period),
+                [&application](std::chrono::milliseconds delta) { application.ChangeGameSate(delta); }, policy
             );
+            const std::chrono::duration<double> stats_period{args->tick_stats_period};
+            ticker->SetStatsReport(std::chrono::duration_cast<std::chrono::milliseconds>(stats_period),
+                [&application](const tick::Stats& stats) { boost_log::LogTickStats(stats, application.GetTickTimings()); });
             ticker->Start();
         }
 
@@ -111,6 +145,10 @@ int main(int argc, const char* argv[]) {
         RunWorkers(std::max(1u, num_threads), [&ioc] {
             ioc.run();
         });
+        // io_context остановлен, статистику тикера можно читать вне strand
+        if (ticker) {
+            boost_log::LogTickStats(ticker->GetStats(), application.GetTickTimings());
+        }
     } catch (const std::exception& ex) {
         // std::cerr << ex.what() << std::endl;
         boost_log::LogExitFailure(ex); 
@@ -1,8 +1,11 @@
 #include "model.h"
+#include "movement_kernel.h"
 
 #include <stdexcept>
+#include <bit>
 #include <algorithm>
 #include <cmath>
+#include <map>
 
 
 namespace model {
@@ -61,6 +64,250 @@ Offset Office::GetOffset() const noexcept {
 }
 
 
+namespace {
+
+// Объединяет касающиеся и перекрывающиеся пути одного уровня
+void MergePaths(std::vector<RoadNetwork::Path>& paths) {
+    auto compare_h = [](const RoadNetwork::Path left, const RoadNetwork::Path right){
+        return left.level < right.level || (left.level == right.level && left.point1 < right.point1);
+    };
+    std::sort(paths.begin(), paths.end(), compare_h);
+    // Дороги одного уровня упорядочены по началу, поэтому каждая следующая
+    // либо продолжает (перекрывает) последний собранный путь, либо начинает новый
+    size_t last = 0;
+    for (size_t i = 1; i < paths.size(); ++i) {
+        auto& path = paths[last];
+        const auto& next = paths[i];
+        if (path.level == next.level && path.point2 >= next.point1) { // Если вторая дорога продолжает первую
+            path.point2 = std::max(path.point2, next.point2); //то первую продолжаем на длину второй
+        } else { // если нет - начинаем следующий путь
+            paths[++last] = next;
+        }
+    }
+    if (!paths.empty()) {
+        paths.resize(last + 1);
+    }
+}
+
+bool PointLess(Point lhs, Point rhs) {
+    return lhs.x < rhs.x || (lhs.x == rhs.x && lhs.y < rhs.y);
+}
+
+// Точка пути: номер пути и координата вдоль него
+struct PathPoint {
+    uint32_t path;
+    Coord point;
+    auto operator<=>(const PathPoint&) const = default;
+};
+
+} // namespace
+
+RoadNetwork RoadNetwork::Compile(const std::vector<Road>& roads) {
+    RoadNetwork network;
+    for (const auto& road : roads) {
+        auto start = road.GetStart();
+        auto end = road.GetEnd();
+        if (road.IsVertical()) {
+            network.v_paths_.push_back({start.x, std::min(start.y, end.y), std::max(start.y, end.y)});
+        } else {
+            network.h_paths_.push_back({start.y, std::min(start.x, end.x), std::max(start.x, end.x)});
+        }
+    }
+    MergePaths(network.h_paths_);
+    MergePaths(network.v_paths_);
+
+    // Вершины на каждом пути: его концы и пересечения с путями другого направления
+    std::vector<PathPoint> h_points, v_points;
+    for (uint32_t i = 0; i < network.h_paths_.size(); ++i) {
+        h_points.push_back({i, network.h_paths_[i].point1});
+        h_points.push_back({i, network.h_paths_[i].point2});
+    }
+    for (uint32_t i = 0; i < network.v_paths_.size(); ++i) {
+        v_points.push_back({i, network.v_paths_[i].point1});
+        v_points.push_back({i, network.v_paths_[i].point2});
+    }
+    // Пересечения ищем заметающей прямой x = const: горизонтальные пути, которые
+    // она пересекает, хранятся по y. На одном y таких путей не больше одного
+    enum EventType {Open, Cross, Close}; // при равных x сначала открываем, потом закрываем пути
+    struct Event {
+        Coord x;
+        EventType type;
+        uint32_t path;
+        bool operator<(const Event& other) const {
+            return x < other.x || (x == other.x && type < other.type);
+        }
+    };
+    std::vector<Event> events;
+    events.reserve(network.h_paths_.size() * 2 + network.v_paths_.size());
+    for (uint32_t i = 0; i < network.h_paths_.size(); ++i) {
+        events.push_back({network.h_paths_[i].point1, Open, i});
+        events.push_back({network.h_paths_[i].point2, Close, i});
+    }
+    for (uint32_t i = 0; i < network.v_paths_.size(); ++i) {
+        events.push_back({network.v_paths_[i].level, Cross, i});
+    }
+    std::sort(events.begin(), events.end());
+    std::map<Coord, uint32_t> open_paths;
+    for (const auto& event : events) {
+        if (event.type == Open) {
+            open_paths.emplace(network.h_paths_[event.path].level, event.path);
+        } else if (event.type == Close) {
+            open_paths.erase(network.h_paths_[event.path].level);
+        } else {
+            const auto& v_path = network.v_paths_[event.path];
+            for (auto it = open_paths.lower_bound(v_path.point1); it != open_paths.end() && it->first <= v_path.point2; ++it) {
+                h_points.push_back({it->second, event.x});
+                v_points.push_back({event.path, it->first});
+            }
+        }
+    }
+    std::sort(h_points.begin(), h_points.end());
+    h_points.erase(std::unique(h_points.begin(), h_points.end()), h_points.end());
+    std::sort(v_points.begin(), v_points.end());
+    v_points.erase(std::unique(v_points.begin(), v_points.end()), v_points.end());
+
+    for (const auto& p : h_points) {
+        network.nodes_.push_back({p.point, network.h_paths_[p.path].level});
+    }
+    for (const auto& p : v_points) {
+        network.nodes_.push_back({network.v_paths_[p.path].level, p.point});
+    }
+    std::sort(network.nodes_.begin(), network.nodes_.end(), PointLess);
+    network.nodes_.erase(std::unique(network.nodes_.begin(), network.nodes_.end(), [](Point lhs, Point rhs) {
+        return lhs.x == rhs.x && lhs.y == rhs.y;
+    }), network.nodes_.end());
+
+    // Рёбра между соседними вершинами каждого пути, в обе стороны
+    struct RawEdge {
+        NodeId from, to;
+        Dimension length;
+    };
+    std::vector<RawEdge> raw_edges;
+    auto add_edges = [&network, &raw_edges](const std::vector<PathPoint>& points, auto to_point) {
+        for (size_t i = 1; i < points.size(); ++i) {
+            if (points[i].path != points[i - 1].path) {
+                continue;
+            }
+            const NodeId from = *network.FindNode(to_point(points[i - 1]));
+            const NodeId to = *network.FindNode(to_point(points[i]));
+            const Dimension length = points[i].point - points[i - 1].point;
+            raw_edges.push_back({from, to, length});
+            raw_edges.push_back({to, from, length});
+        }
+    };
+    add_edges(h_points, [&network](PathPoint p) { return Point{p.point, network.h_paths_[p.path].level}; });
+    add_edges(v_points, [&network](PathPoint p) { return Point{network.v_paths_[p.path].level, p.point}; });
+
+    network.edge_offsets_.assign(network.nodes_.size() + 1, 0);
+    for (const auto& edge : raw_edges) {
+        ++network.edge_offsets_[edge.from + 1];
+    }
+    for (size_t i = 1; i < network.edge_offsets_.size(); ++i) {
+        network.edge_offsets_[i] += network.edge_offsets_[i - 1];
+    }
+    network.edges_.resize(raw_edges.size());
+    std::vector<uint32_t> fill(network.edge_offsets_.begin(), network.edge_offsets_.end() - 1);
+    for (const auto& edge : raw_edges) {
+        network.edges_[fill[edge.from]++] = {edge.to, edge.length};
+    }
+
+    // Точки путей уже упорядочены по номеру пути и координате вдоль него
+    const auto path_count = network.h_paths_.size() + network.v_paths_.size();
+    network.path_node_offsets_.assign(path_count + 1, 0);
+    for (const auto& p : h_points) {
+        ++network.path_node_offsets_[p.path + 1];
+        network.path_nodes_.push_back(*network.FindNode({p.point, network.h_paths_[p.path].level}));
+    }
+    for (const auto& p : v_points) {
+        ++network.path_node_offsets_[network.h_paths_.size() + p.path + 1];
+        network.path_nodes_.push_back(*network.FindNode({network.v_paths_[p.path].level, p.point}));
+    }
+    for (size_t i = 1; i < network.path_node_offsets_.size(); ++i) {
+        network.path_node_offsets_[i] += network.path_node_offsets_[i - 1];
+    }
+    return network;
+}
+
+const std::vector<RoadNetwork::Path>& RoadNetwork::GetHorizontalPaths() const noexcept {
+    return h_paths_;
+}
+
+const std::vector<RoadNetwork::Path>& RoadNetwork::GetVerticalPaths() const noexcept {
+    return v_paths_;
+}
+
+size_t RoadNetwork::GetNodeCount() const noexcept {
+    return nodes_.size();
+}
+
+Point RoadNetwork::GetNodePos(NodeId node) const noexcept {
+    return nodes_[node];
+}
+
+std::span<const RoadNetwork::Edge> RoadNetwork::GetEdges(NodeId node) const noexcept {
+    return {edges_.data() + edge_offsets_[node], edges_.data() + edge_offsets_[node + 1]};
+}
+
+std::optional<RoadNetwork::NodeId> RoadNetwork::FindNode(Point pos) const noexcept {
+    const auto it = std::lower_bound(nodes_.begin(), nodes_.end(), pos, PointLess);
+    if (it == nodes_.end() || it->x != pos.x || it->y != pos.y) {
+        return std::nullopt;
+    }
+    return static_cast<NodeId>(it - nodes_.begin());
+}
+
+std::span<const RoadNetwork::NodeId> RoadNetwork::GetPathNodes(uint32_t path) const noexcept {
+    return {path_nodes_.data() + path_node_offsets_[path], path_nodes_.data() + path_node_offsets_[path + 1]};
+}
+
+std::optional<RoadNetwork::Location> RoadNetwork::Locate(double x, double y) const noexcept {
+    // Ищет путь уровня level, на котором лежит точка point
+    auto find_path = [](const std::vector<Path>& paths, double level, double point) -> std::optional<uint32_t> {
+        if (level != std::floor(level)) {
+            return std::nullopt;
+        }
+        const auto it = std::upper_bound(paths.begin(), paths.end(), std::pair{level, point}, [](const auto& value, const Path& path) {
+            return value.first < path.level || (value.first == path.level && value.second < path.point1);
+        });
+        if (it == paths.begin()) {
+            return std::nullopt;
+        }
+        const auto& path = *std::prev(it);
+        if (path.level != level || point > path.point2) {
+            return std::nullopt;
+        }
+        return static_cast<uint32_t>(std::prev(it) - paths.begin());
+    };
+    if (const auto path = find_path(h_paths_, y, x)) {
+        return LocateOnPath(*path, x);
+    }
+    if (const auto path = find_path(v_paths_, x, y)) {
+        return LocateOnPath(static_cast<uint32_t>(h_paths_.size()) + *path, y);
+    }
+    return std::nullopt;
+}
+
+std::optional<RoadNetwork::Location> RoadNetwork::LocateOnPath(uint32_t path, double point) const noexcept {
+    const bool horizontal = path < h_paths_.size();
+    auto along = [this, horizontal](NodeId node) -> double {
+        return horizontal ? nodes_[node].x : nodes_[node].y;
+    };
+    const auto path_nodes = GetPathNodes(path);
+    const auto it = std::lower_bound(path_nodes.begin(), path_nodes.end(), point, [&along](NodeId node, double value) {
+        return along(node) < value;
+    });
+    if (it == path_nodes.end()) {
+        return std::nullopt;
+    }
+    if (along(*it) == point) {
+        return Location{*it, *it};
+    }
+    if (it == path_nodes.begin()) {
+        return std::nullopt;
+    }
+    return Location{*std::prev(it), *it};
+}
+
 Map::Map(Id id, std::string name) noexcept
 : id_(std::move(id))
 , name_(std::move(name)) {
@@ -87,21 +334,6 @@ const Map::Offices& Map::GetOffices() const noexcept {
 }
 
 void Map::AddRoad(const Road&& road) {
-    bool vertical = road.IsVertical();
-    auto start = road.GetStart();
-    auto end = road.GetEnd();
-    if(vertical){
-        if(start.y > end.y){
-            std::swap(start,end); 
-        }
-        v_paths_.AddPath(start.x, start.y, end.y);
-    } else {
-        if(start.x > end.x){
-            std::swap(start,end); 
-        }
-        h_paths_.AddPath(start.y, start.x, end.x);
-        // h_roads_.push_back(&roads_.back());
-    }
     roads_.emplace_back(road);
 }
 
@@ -124,35 +356,38 @@ void Map::AddOffice(Office office) {
         offices_.pop_back();
         throw;
     }
+    const auto pos = o.GetPosition();
+    try {
+        office_index_.Insert(static_cast<ItemGrid::ItemId>(index), {static_cast<Dog::Coord>(pos.x), static_cast<Dog::Coord>(pos.y)});
+    } catch (...) {
+        warehouse_id_to_index_.erase(offices_.back().GetId());
+        offices_.pop_back();
+        throw;
+    }
 }
 
-Dog::Pos Map::GetRandomPos() const {
-    auto roads = GetRoads();
-    if(roads.empty()){
+Dog::Pos Map::GetRandomPos(util::SplitMix64& random) const {
+    if(roads_.empty()){
         return {0.0, 0.0};
     }
-    std::random_device random_device_;
-    std::uniform_int_distribution<int> dist_roads(0, roads.size()-1);
-    int random_road = dist_roads(random_device_);
-    auto road = roads[random_road];
+    // таблица строится вместе с путями, до этого выбираем дорогу равновероятно
+    const auto& road = road_sampler_.Size() == roads_.size() ? roads_[road_sampler_.Sample(random)]
+                                                             : roads_[random() % roads_.size()];
     auto start = road.GetStart();
     auto end = road.GetEnd();
+    const double along = random.NextDouble();
     if(road.IsHorizontal()){
-        std::uniform_real_distribution<Dog::Coord> dist_x(start.x, end.x);
-        return {dist_x(random_device_), static_cast<Dog::Coord>(start.y)};
+        return {start.x + (end.x - start.x) * along, static_cast<Dog::Coord>(start.y)};
     } else {
-        std::uniform_real_distribution<Dog::Coord> dist_y(start.y, end.y);
-        return {static_cast<Dog::Coord>(start.x), dist_y(random_device_)};
+        return {static_cast<Dog::Coord>(start.x), start.y + (end.y - start.y) * along};
     };
 }
 
 Dog::Pos Map::GetStartPos() const {
-    auto roads = GetRoads();
-    if(roads.empty()){
+    if(roads_.empty()){
         return {0.0, 0.0};
     }
-    auto road = roads[0];
-    auto start = road.GetStart();
+    auto start = roads_.front().GetStart();
     return {static_cast<Dog::Coord>(start.x), static_cast<Dog::Coord>(start.y)};
 }
 
@@ -164,29 +399,64 @@ Dog::Dimension Map::GetDogSpeed() const {
     return dog_speed_;
 }
 
-void Map::OrderedListPaths::BildListOderedPath(){ 
-    auto compare_h = [](const Path left, const Path right){
-        return left.level < right.level;
-    };
-    std::sort(paths_.begin(), paths_.end(), compare_h);
-    auto it1 = paths_.begin();
-    auto it2 = it1+1;
-    while (it2 != paths_.end()) {
-        // Если второя дорога продолжает первую
-        if ((*it1).level==(*it2).level && (*it1).point2>=(*it2).point1) {
-            (*it1).point2 = (*it2).point2; //то первую продолжаем на длину второй
-            paths_.erase(it2); // вторую удаляем
-            it2 = it1+1;
-        } else { // если нет - переходим  к сравнению следующей пары
-            it1 += 1;
-            it2 += 1;
+void Map::OrderedListPaths::Build(std::vector<Path> paths){
+    paths_ = std::move(paths);
+    BuildLines();
+}
+
+void Map::OrderedListPaths::BuildLines(){
+    lines_.clear();
+    if (paths_.empty()) {
+        return;
+    }
+    first_level_ = paths_.front().level;
+    lines_.resize(paths_.back().level - first_level_ + 1);
+    for (size_t first = 0; first < paths_.size(); ) {
+        // пути одного уровня идут подряд, по возрастанию и без перекрытий
+        size_t end = first;
+        while (end < paths_.size() && paths_[end].level == paths_[first].level) {
+            ++end;
+        }
+        auto& line = lines_[paths_[first].level - first_level_];
+        line.first_point = paths_[first].point1;
+        line.cell_paths.assign(paths_[end - 1].point2 - line.first_point + 1, NO_PATH);
+        for (size_t i = first; i < end; ++i) {
+            const auto from = line.cell_paths.begin() + (paths_[i].point1 - line.first_point);
+            const auto to = line.cell_paths.begin() + (paths_[i].point2 - line.first_point) + 1;
+            std::fill(from, to, static_cast<uint32_t>(i));
         }
+        first = end;
     }
 }
 
 void Map::BildListOderedPath(){ 
-    h_paths_.BildListOderedPath();
-    v_paths_.BildListOderedPath();
+    road_network_ = RoadNetwork::Compile(roads_);
+    h_paths_.Build(road_network_.GetHorizontalPaths());
+    v_paths_.Build(road_network_.GetVerticalPaths());
+    std::vector<double> lengths;
+    lengths.reserve(roads_.size());
+    for (const auto& road : roads_) {
+        const auto start = road.GetStart();
+        const auto end = road.GetEnd();
+        lengths.push_back(std::abs(end.x - start.x) + std::abs(end.y - start.y));
+    }
+    road_sampler_ = util::AliasTable(lengths);
+}
+
+const RoadNetwork& Map::GetRoadNetwork() const noexcept {
+    return road_network_;
+}
+
+Map::Segment Map::GetSegment(bool IsHorizontal, Dimension level, Dimension point) const {
+    const auto& paths = IsHorizontal ? h_paths_ : v_paths_;
+    const auto index = paths.FindPath(level, point);
+    if (index == OrderedListPaths::NO_PATH) {
+        return {NO_SEGMENT, point, point};
+    }
+    const auto& path = paths.GetPath(index);
+    // номера вертикальных путей идут после горизонтальных
+    const auto id = IsHorizontal ? index : static_cast<uint32_t>(h_paths_.Size()) + index;
+    return {id, path.point1, path.point2};
 }
 
 Dimension Map::GetEndOfPath(bool IsHorizontal, bool to_right, Dimension level_dog, Dimension point_dog) const {
@@ -202,20 +472,33 @@ Dimension Map::GetEndOfPathV(Dimension level_dog, Dimension point_dog, bool to_u
 
 
 Dimension Map::OrderedListPaths::GetEndOfPath(Dimension level_dog, Dimension point_dog, bool to_upward_direct) const{
-    auto compare_coord = [](Path road, Dimension coord_find){ return road.level < coord_find; };
-    auto it = std::lower_bound(paths_.begin(), paths_.end(), level_dog, compare_coord);
-    Dimension res = point_dog; // если не найдем дорогу в нужном направлении, то передадим точку собаки
-
-    while (it!=paths_.end() && (*it).level==level_dog) { //Если нашли дорогу с нужным уровнем
-        auto path = *it;
-        if (point_dog>=path.point1 && point_dog<=path.point2) { // если собака на этой дороге
-            res =  to_upward_direct ? path.point2 : path.point1; // передаем предел в нужном направлении
-            break;
-        }
-        it+=1;  // переходим на следующую (список отсортирован по возрастаню уровня
-                // дороги стоящие "паровозиком" объеденены в один путь)
+    const auto index = FindPath(level_dog, point_dog);
+    if (index == NO_PATH) {
+        return point_dog; // если не найдем дорогу в нужном направлении, то передадим точку собаки
+    }
+    const auto& path = paths_[index]; // путь, на котором стоит собака
+    return to_upward_direct ? path.point2 : path.point1; // передаем предел в нужном направлении
+}
+
+uint32_t Map::OrderedListPaths::FindPath(Dimension level, Dimension point) const{
+    const auto line_index = static_cast<int64_t>(level) - first_level_;
+    if (line_index < 0 || line_index >= static_cast<int64_t>(lines_.size())) {
+        return NO_PATH;
+    }
+    const auto& line = lines_[line_index];
+    const auto cell = static_cast<int64_t>(point) - line.first_point;
+    if (cell < 0 || cell >= static_cast<int64_t>(line.cell_paths.size())) {
+        return NO_PATH;
     }
-    return res;
+    return line.cell_paths[cell];
+}
+
+const Map::Path& Map::OrderedListPaths::GetPath(uint32_t index) const{
+    return paths_[index];
+}
+
+size_t Map::OrderedListPaths::Size() const noexcept{
+    return paths_.size();
 }
 
 // Dimension Map::OrderedListPaths::GetEndOfPath(Dimension level_dog, Dimension point_dog, bool to_upward_direct) const{
@@ -237,62 +520,43 @@ Dimension Map::OrderedListPaths::GetEndOfPath(Dimension level_dog, Dimension poi
 //     return res;
 // }
 
-void Map::OrderedListPaths::AddPath(Coord coord, Coord mark1, Coord mark2){
-    paths_.emplace_back(coord, mark1, mark2);
-}
 
 
-Dog::Dog(std::string user_name, Id id) noexcept
-: name_{std::move(user_name)} 
-    , id_{std::move(id)} {
+Dog::Dog(DogStore& store, Handle handle) noexcept
+: store_{&store} 
+    , handle_{handle} {
 }
 
 const Dog::Id& Dog::GetId() const noexcept {
-    return id_;
+    return store_->GetId(handle_);
 }
 
 const std::string& Dog::GetName() const noexcept {
-    return name_;
+    return store_->GetName(handle_);
 }
 
-void Dog::SetPos(Pos pos){
-    pos_ = pos;
-}  
+Dog::Handle Dog::GetHandle() const noexcept {
+    return handle_;
+}
 
-void Dog::SetPos(bool IsHorizontal, Pos pos){
-    if (IsHorizontal) {
-        pos_ = pos;
-    } else {
-        pos_ = {pos.y, pos.x};
-    }
+void Dog::SetPos(Pos pos){
+    store_->SetPos(handle_, pos);
 }  
 
 Dog::Pos Dog::GetPos() const {
-    return pos_;
+    return store_->GetPos(handle_);
 }  
 
 Dog::Speed Dog::GetSpeed() const {
-    return speed_;
+    return store_->GetSpeed(handle_);
 }  
 
-void Dog::SetSpeed(Speed speed){
-    speed_ = speed;
-}
-
 void Dog::Stop(){
-    speed_ = {};
-}
-
-void Dog::SetSpeed(Dir dir, Dimension dog_speed){
-    dog_speed *= dir==Dir::Left || dir==Dir::Down ? -1.0 : 1.0;
-    speed_ = dir==Dir::Left || dir==Dir::Right ? Speed{dog_speed, 0.0} : Speed{0.0, dog_speed};
+    store_->SetSpeed(handle_, {});
 }
 
-
-
-
 char Dog::GetDirSymbol() const {
-    switch (dir_)
+    switch (store_->GetDir(handle_))
     {
     case Dir::Left:
                     return 'L';
@@ -308,19 +572,9 @@ char Dog::GetDirSymbol() const {
 }  
 
 void Dog::SetDirSpeed(Dir dir, Dimension dog_speed){
-    dir_ = dir;
+    store_->SetDir(handle_, dir);
     dog_speed *= dir==Dir::Left || dir==Dir::Up ? -1.0 : 1.0;
-    speed_ = dir==Dir::Left || dir==Dir::Right ? Speed{dog_speed, 0.0} : Speed{0.0, dog_speed};
-    // if(dir == dir_){
-    //     return;
-    // }
-
-    // if(dir==Dir::None){
-    //     SetSpeed(Speed{0.0f, 0.0f});
-    // } else {
-    //     dir_ = dir;
-    //     SetSpeed(dir, dog_speed);
-    // }
+    store_->SetSpeed(handle_, dir==Dir::Left || dir==Dir::Right ? Speed{dog_speed, 0.0} : Speed{0.0, dog_speed});
 }
 
 char Dog::CheckDirSymbol(char dir){
@@ -333,45 +587,307 @@ char Dog::CheckDirSymbol(char dir){
     return dir;
 }
 
-void Dog::CalcNewPosOnRoad(const Map& map, const std::chrono::milliseconds time_delta){
-    auto speed_dir = GetSpeed();  
-    if (speed_dir.dir_x==0.0 && speed_dir.dir_y==0.0 ) { // Если собака стоит
-        return; // то мы ее не трогаем)
+DogStore::Handle DogStore::Add(Dog::Id id, std::string name, Dog::Pos pos){
+    uint32_t slot = 0;
+    if (free_slots_.empty()) {
+        slot = static_cast<uint32_t>(slot_to_index_.size());
+        slot_to_index_.push_back(NO_INDEX);
+        generations_.push_back(next_generation_);
+        dir_.emplace_back();
+        segment_.emplace_back();
+        stop_at_.emplace_back();
+        ids_.push_back(id);
+        names_.emplace_back();
+    } else {
+        std::pop_heap(free_slots_.begin(), free_slots_.end(), std::greater<>{});
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+    // новая собака стоит, поэтому попадает в конец горячих массивов
+    pos_x_.push_back(pos.x);
+    pos_y_.push_back(pos.y);
+    speed_x_.push_back(0.0);
+    speed_y_.push_back(0.0);
+    bound_min_.push_back(pos.x);
+    bound_max_.push_back(pos.x);
+    index_to_slot_.push_back(slot);
+    slot_to_index_[slot] = static_cast<uint32_t>(pos_x_.size() - 1);
+    dir_[slot] = Dog::Dir::Up;
+    segment_[slot] = Map::NO_SEGMENT;
+    stop_at_[slot].reset();
+    ids_[slot] = id;
+    names_[slot] = std::move(name);
+    return MakeHandle(slot, generations_[slot]);
+}
+
+void DogStore::Remove(Handle handle) noexcept {
+    if (!Contains(handle)) {
+        return;
+    }
+    const auto slot = GetSlot(handle);
+    // Собака переходит к стоящим, затем в конец горячих массивов
+    SetMoving(slot_to_index_[slot], false);
+    SwapDogs(slot_to_index_[slot], pos_x_.size() - 1);
+    pos_x_.pop_back();
+    pos_y_.pop_back();
+    speed_x_.pop_back();
+    speed_y_.pop_back();
+    bound_min_.pop_back();
+    bound_max_.pop_back();
+    index_to_slot_.pop_back();
+    slot_to_index_[slot] = NO_INDEX;
+    ++generations_[slot];
+    names_[slot] = std::string{}; // освобождаем память имени
+    free_slots_.push_back(slot);
+    std::push_heap(free_slots_.begin(), free_slots_.end(), std::greater<>{});
+}
+
+bool DogStore::Contains(Handle handle) const noexcept {
+    const auto slot = GetSlot(handle);
+    return slot < slot_to_index_.size() && slot_to_index_[slot] != NO_INDEX
+        && generations_[slot] == GetGeneration(handle);
+}
+
+size_t DogStore::Size() const noexcept {
+    return pos_x_.size();
+}
+
+size_t DogStore::GetSlotCount() const noexcept {
+    return slot_to_index_.size();
+}
+
+std::optional<DogStore::Handle> DogStore::GetHandle(uint32_t slot) const noexcept {
+    if (slot >= slot_to_index_.size() || slot_to_index_[slot] == NO_INDEX) {
+        return std::nullopt;
+    }
+    return MakeHandle(slot, generations_[slot]);
+}
+
+void DogStore::Compact(){
+    // Свободные слоты в конце отбрасываем. Их поколения учитываем в next_generation_
+    size_t slot_count = slot_to_index_.size();
+    while (slot_count > 0 && slot_to_index_[slot_count - 1] == NO_INDEX) {
+        --slot_count;
+        next_generation_ = std::max(next_generation_, generations_[slot_count] + 1);
+    }
+    if (slot_count < slot_to_index_.size()) {
+        std::erase_if(free_slots_, [slot_count](uint32_t slot) {
+            return slot >= slot_count;
+        });
+        std::make_heap(free_slots_.begin(), free_slots_.end(), std::greater<>{});
+        slot_to_index_.resize(slot_count);
+        generations_.resize(slot_count);
+        dir_.resize(slot_count);
+        segment_.resize(slot_count);
+        stop_at_.resize(slot_count);
+        ids_.resize(slot_count, Dog::Id{0});
+        names_.resize(slot_count);
+    }
+    // Выход собак и переходы между движущимися и стоящими перемешивают горячие
+    // массивы. Внутри каждой группы возвращаем собакам порядок слотов
+    std::vector<uint32_t> order(pos_x_.size());
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    auto by_slot = [this](uint32_t lhs, uint32_t rhs) {
+        return index_to_slot_[lhs] < index_to_slot_[rhs];
     };
-    const Dog::Coord HalfWideRoad = 0.4;
-    auto pos_1 = GetPos();
-    auto speed = speed_dir.dir_x;
-    bool IsHorizontal = speed != 0.e0;
-    Dog::Coord level, point1, point2;
-    if (IsHorizontal) { // собака движется горизонтально
-        level = pos_1.y;
-        point1 = pos_1.x;
-    } else {  // вертикально)
-        speed = speed_dir.dir_y;
-        level = pos_1.x;
-        point1 = pos_1.y;
-    }
-    std::chrono::duration<float> time_delta_in_seconds = time_delta;
-    point2 = point1 + speed * time_delta_in_seconds.count();  
+    std::sort(order.begin(), order.begin() + active_count_, by_slot);
+    std::sort(order.begin() + active_count_, order.end(), by_slot);
+    Reorder(order);
+
+    auto shrink = [](auto& vector) {
+        // Память возвращаем, только если занято меньше половины
+        if (vector.capacity() > 2 * vector.size()) {
+            vector.shrink_to_fit();
+        }
+    };
+    shrink(pos_x_);
+    shrink(pos_y_);
+    shrink(speed_x_);
+    shrink(speed_y_);
+    shrink(bound_min_);
+    shrink(bound_max_);
+    shrink(index_to_slot_);
+    shrink(slot_to_index_);
+    shrink(generations_);
+    shrink(dir_);
+    shrink(segment_);
+    shrink(stop_at_);
+    shrink(ids_);
+    shrink(names_);
+    shrink(free_slots_);
+}
+
+void DogStore::Reorder(const std::vector<uint32_t>& order){
+    auto apply = [&order](auto& values) {
+        std::remove_reference_t<decltype(values)> reordered(values.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            reordered[i] = values[order[i]];
+        }
+        values.swap(reordered);
+    };
+    apply(pos_x_);
+    apply(pos_y_);
+    apply(speed_x_);
+    apply(speed_y_);
+    apply(bound_min_);
+    apply(bound_max_);
+    apply(index_to_slot_);
+    for (uint32_t i = 0; i < index_to_slot_.size(); ++i) {
+        slot_to_index_[index_to_slot_[i]] = i;
+    }
+}
+
+DogStore::Handle DogStore::MakeHandle(uint32_t slot, uint32_t generation) noexcept {
+    return Handle{(uint64_t{generation} << 32) | slot};
+}
+
+uint32_t DogStore::GetSlot(Handle handle) noexcept {
+    return static_cast<uint32_t>(*handle);
+}
+
+uint32_t DogStore::GetGeneration(Handle handle) noexcept {
+    return static_cast<uint32_t>(*handle >> 32);
+}
+
+size_t DogStore::GetActiveCount() const noexcept {
+    return active_count_;
+}
+
+Dog DogStore::operator[](Handle handle) noexcept {
+    return Dog(*this, handle);
+}
+
+const Dog::Id& DogStore::GetId(Handle handle) const noexcept {
+    return ids_[GetSlot(handle)];
+}
+
+const std::string& DogStore::GetName(Handle handle) const noexcept {
+    return names_[GetSlot(handle)];
+}
+
+Dog::Pos DogStore::GetPos(Handle handle) const noexcept {
+    const auto i = slot_to_index_[GetSlot(handle)];
+    return {pos_x_[i], pos_y_[i]};
+}
+
+void DogStore::SetPos(Handle handle, Dog::Pos pos) noexcept {
+    const auto i = slot_to_index_[GetSlot(handle)];
+    pos_x_[i] = pos.x;
+    pos_y_[i] = pos.y;
+    stale_segments_.push_back(handle);
+}
+
+Dog::Speed DogStore::GetSpeed(Handle handle) const noexcept {
+    const auto i = slot_to_index_[GetSlot(handle)];
+    return {speed_x_[i], speed_y_[i]};
+}
+
+void DogStore::SetSpeed(Handle handle, Dog::Speed speed) noexcept {
+    const auto i = slot_to_index_[GetSlot(handle)];
+    speed_x_[i] = speed.dir_x;
+    speed_y_[i] = speed.dir_y;
+    SetMoving(i, speed.dir_x != 0.0 || speed.dir_y != 0.0);
+}
+
+Dog::Dir DogStore::GetDir(Handle handle) const noexcept {
+    return dir_[GetSlot(handle)];
+}
+
+void DogStore::SetDir(Handle handle, Dog::Dir dir) noexcept {
+    dir_[GetSlot(handle)] = dir;
+    stop_at_[GetSlot(handle)].reset();
+    stale_segments_.push_back(handle);
+}
+
+void DogStore::SetStopPoint(Handle handle, Dog::Coord stop_at) noexcept {
+    stop_at_[GetSlot(handle)] = stop_at;
+    stale_segments_.push_back(handle);
+}
+
+uint32_t DogStore::GetSegment(Handle handle) const noexcept {
+    return segment_[GetSlot(handle)];
+}
+
+void DogStore::SetMoving(size_t index, bool moving) noexcept {
+    if (moving && index >= active_count_) {
+        SwapDogs(index, active_count_++);
+    } else if (!moving && index < active_count_) {
+        SwapDogs(index, --active_count_);
+    }
+}
+
+void DogStore::SwapDogs(size_t lhs, size_t rhs) noexcept {
+    if (lhs == rhs) {
+        return;
+    }
+    std::swap(pos_x_[lhs], pos_x_[rhs]);
+    std::swap(pos_y_[lhs], pos_y_[rhs]);
+    std::swap(speed_x_[lhs], speed_x_[rhs]);
+    std::swap(speed_y_[lhs], speed_y_[rhs]);
+    std::swap(bound_min_[lhs], bound_min_[rhs]);
+    std::swap(bound_max_[lhs], bound_max_[rhs]);
+    std::swap(index_to_slot_[lhs], index_to_slot_[rhs]);
+    slot_to_index_[index_to_slot_[lhs]] = static_cast<uint32_t>(lhs);
+    slot_to_index_[index_to_slot_[rhs]] = static_cast<uint32_t>(rhs);
+}
+
+void DogStore::Move(const Map& map, const std::chrono::milliseconds time_delta){
+    for (const auto handle : stale_segments_) {
+        // собака могла уйти из сессии после смены направления
+        if (Contains(handle)) {
+            UpdateSegment(map, handle);
+        }
+    }
+    stale_segments_.clear();
+    stopped_.clear();
+    const std::chrono::duration<float> time_delta_in_seconds = time_delta;
+    // Пакетно сдвигаем движущихся собак, останавливая дошедших до края своего пути
+    movement::Integrate({pos_x_.data(), pos_y_.data(), speed_x_.data(), speed_y_.data(),
+                         bound_min_.data(), bound_max_.data(), active_count_},
+                        time_delta_in_seconds.count());
+    // Остановившихся собак переносим к стоящим
+    for (size_t i = 0; i < active_count_; ) {
+        if (speed_x_[i] == 0.0 && speed_y_[i] == 0.0) {
+            const auto slot = index_to_slot_[i];
+            stopped_.push_back(MakeHandle(slot, generations_[slot]));
+            SetMoving(i, false); // на место i встаёт последняя движущаяся собака
+        } else {
+            ++i;
+        }
+    }
+}
 
+const std::vector<DogStore::Handle>& DogStore::GetStoppedDogs() const noexcept {
+    return stopped_;
+}
+
+void DogStore::UpdateSegment(const Map& map, Handle handle){
+    const Dog::Coord HalfWideRoad = 0.4;
+    const auto i = slot_to_index_[GetSlot(handle)];
+    bool IsHorizontal = speed_x_[i] != 0.e0;
+    if (!IsHorizontal && speed_y_[i] == 0.0) { // стоящей собаке путь не нужен
+        return;
+    }
+    // собака движется горизонтально - по оси x, вертикально - по оси y
+    const Dog::Coord level = IsHorizontal ? pos_y_[i] : pos_x_[i];
+    const Dog::Coord point = IsHorizontal ? pos_x_[i] : pos_y_[i];
     int level_int = round(level); 
-    int point1_int = round(point1);               
-    int point2_int = round(point2); 
-    bool to_right = speed>0;
-    // Проверка наличия препятствий на пути собаки
-    if ((point1_int != point2_int) || (std::abs(point2-point2_int)>=HalfWideRoad)){
-        // Если собака вышла из начаьного кадрата дороги
-        // Проверим - есть дальше дорога?)
-        auto point_end = map.GetEndOfPath(IsHorizontal, to_right, level_int, point1_int);
-
-        if ((to_right && point2 >= HalfWideRoad + point_end) //если прошли край дороги
-        ||   (!to_right && point2 <= -HalfWideRoad + point_end)) {
-            Dog::Coord minus = to_right ? 1.0 : -1.0;
-            point2 = HalfWideRoad*minus+point_end; 
-            Stop();  // Останавливаем собаку на краю дороги
+    int point_int = round(point);
+    const auto segment = map.GetSegment(IsHorizontal, level_int, point_int);
+    segment_[GetSlot(handle)] = segment.id;
+    // Собака может отойти от крайней клетки пути на половину ширины дороги
+    bound_min_[i] = -HalfWideRoad + segment.begin;
+    bound_max_[i] = HalfWideRoad + segment.end;
+    if (const auto stop_at = stop_at_[GetSlot(handle)]) {
+        // Точка остановки лежит впереди по ходу движения
+        if (speed_x_[i] + speed_y_[i] > 0) {
+            bound_max_[i] = std::min(bound_max_[i], *stop_at);
+        } else {
+            bound_min_[i] = std::max(bound_min_[i], *stop_at);
         }
-    }    
-    SetPos(IsHorizontal, {point2, level});
+    }
 }
 
 // if (!((point1_int == point2_int) && (abs(point2-point2_int)<HalfWideRoad))){
@@ -468,24 +984,216 @@ void Dog::CalcNewPosOnRoad(const Map& map, const std::chrono::milliseconds time_
 //     }
 // }
 
-GameSession::GameSession(const Map* map, bool randomize_spawn_points) noexcept
+ItemGrid::ItemGrid(Dog::Dimension cell_size)
+    : cell_size_(cell_size) {
+    if (!(cell_size > 0)) {
+        throw std::invalid_argument("Cell size must be positive");
+    }
+}
+
+void ItemGrid::Insert(ItemId id, Dog::Pos pos){
+    if (id >= items_.size()) {
+        items_.resize(id + 1);
+    }
+    Remove(id);
+    auto& item = items_[id];
+    item.pos = pos;
+    item.cell = GetKey(GetCell(pos.y), GetCell(pos.x));
+    auto& ids = cells_[item.cell];
+    item.index = static_cast<uint32_t>(ids.size());
+    ids.push_back(id);
+    ++size_;
+}
+
+void ItemGrid::Remove(ItemId id) noexcept {
+    if (!Contains(id)) {
+        return;
+    }
+    auto& item = items_[id];
+    const auto it = cells_.find(item.cell);
+    auto& ids = it->second;
+    // На место предмета встаёт последний предмет клетки
+    ids[item.index] = ids.back();
+    items_[ids[item.index]].index = item.index;
+    ids.pop_back();
+    if (ids.empty()) {
+        cells_.erase(it);
+    }
+    item.index = NO_INDEX;
+    --size_;
+}
+
+bool ItemGrid::Contains(ItemId id) const noexcept {
+    return id < items_.size() && items_[id].index != NO_INDEX;
+}
+
+size_t ItemGrid::Size() const noexcept {
+    return size_;
+}
+
+Dog::Pos ItemGrid::GetPos(ItemId id) const noexcept {
+    return items_[id].pos;
+}
+
+int32_t ItemGrid::GetCell(Dog::Coord coord) const noexcept {
+    // Клетка дороги с центром в целой точке при cell_size_ = 1. Ограничение
+    // исключает переполнение при огромных координатах
+    constexpr double LIMIT = 1 << 30;
+    return static_cast<int32_t>(std::clamp(std::floor(coord / cell_size_ + 0.5), -LIMIT, LIMIT));
+}
+
+uint64_t ItemGrid::GetKey(int32_t row, int32_t column) noexcept {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(row)) << 32) | static_cast<uint32_t>(column);
+}
+
+bool ItemGrid::IsNear(const Segment& segment, Dog::Pos pos, Dog::Dimension radius) noexcept {
+    // Расстояние от точки до ближайшей точки отрезка
+    const auto dx = segment.to.x - segment.from.x;
+    const auto dy = segment.to.y - segment.from.y;
+    const auto length2 = dx * dx + dy * dy;
+    double t = 0;
+    if (length2 > 0) {
+        t = std::clamp(((pos.x - segment.from.x) * dx + (pos.y - segment.from.y) * dy) / length2, 0.0, 1.0);
+    }
+    const auto nx = segment.from.x + t * dx - pos.x;
+    const auto ny = segment.from.y + t * dy - pos.y;
+    return nx * nx + ny * ny <= radius * radius;
+}
+
+int32_t DogGrid::GetCell(Dog::Coord coord) noexcept {
+    // Ограничение исключает переполнение при огромных координатах области запроса
+    constexpr double LIMIT = 1 << 30;
+    return static_cast<int32_t>(std::clamp(std::floor(coord / CELL_SIZE), -LIMIT, LIMIT));
+}
+
+uint64_t DogGrid::GetKey(int32_t row, int32_t column) noexcept {
+    // Смещение 2^31 упорядочивает отрицательные номера клеток перед положительными
+    const auto biased_row = static_cast<uint64_t>(static_cast<int64_t>(row) + (int64_t{1} << 31));
+    const auto biased_column = static_cast<uint64_t>(static_cast<int64_t>(column) + (int64_t{1} << 31));
+    return (biased_row << 32) | biased_column;
+}
+
+int32_t DogGrid::GetRow(uint64_t key) noexcept {
+    return static_cast<int32_t>(static_cast<int64_t>(key >> 32) - (int64_t{1} << 31));
+}
+
+void DogGrid::Sort() {
+    auto less = [](const Entry& lhs, const Entry& rhs) {
+        return lhs.key < rhs.key;
+    };
+    // Если порядок сильно нарушен (первое построение), вставки слишком дороги
+    size_t inversions = 0;
+    for (size_t i = 1; i < entries_.size(); ++i) {
+        inversions += less(entries_[i], entries_[i - 1]);
+    }
+    if (inversions > entries_.size() / 8) {
+        std::sort(entries_.begin(), entries_.end(), less);
+        return;
+    }
+    for (size_t i = 1; i < entries_.size(); ++i) {
+        const auto entry = entries_[i];
+        size_t j = i;
+        for (; j > 0 && less(entry, entries_[j - 1]); --j) {
+            entries_[j] = entries_[j - 1];
+        }
+        entries_[j] = entry;
+    }
+}
+
+GameSession::GameSession(const Map* map, bool randomize_spawn_points, uint64_t seed) noexcept
 : map_(map) 
-, randomize_spawn_points_(randomize_spawn_points){
+, randomize_spawn_points_(randomize_spawn_points)
+, random_(seed){
 }
 
-void GameSession::AddDog(Dog* dog){
-    dogs_.push_back(dog);
-    if (randomize_spawn_points_) {
-        dog->SetPos(map_->GetRandomPos());
-    } else {
-        dog->SetPos(map_->GetStartPos());
+Dog GameSession::AddDog(Dog::Id id, std::string name, bool retire_when_idle){
+    const auto pos = randomize_spawn_points_ ? map_->GetRandomPos(random_) : map_->GetStartPos();
+    Dog dog = dogs_[dogs_.Add(id, std::move(name), pos)];
+    const auto slot = DogStore::GetSlot(dog.GetHandle());
+    if (slot >= retire_when_idle_.size()) {
+        retire_when_idle_.resize(slot + 1);
     }
-    // dog->SetSpeed({0.0, 0.0});
-    dog->SetDirSpeed(Dog::Dir::Up, 0.0);
+    retire_when_idle_[slot] = retire_when_idle;
+    ScheduleRetirement(dog.GetHandle()); // новая собака стоит
+
+    auto roster = std::make_shared<SessionRoster>(*GetRoster());
+    roster->dogs.emplace_back(dog.GetId(), dog.GetName());
+    std::atomic_store(&roster_, std::shared_ptr<const SessionRoster>(std::move(roster)));
+    PublishSnapshot();
+    return dog;
+}
+
+void GameSession::RemoveDog(Dog::Handle handle){
+    RemoveDogs({&handle, 1});
+}
+
+void GameSession::RemoveDogs(std::span<const Dog::Handle> handles){
+    std::vector<Dog::Id> ids;
+    for (const auto handle : handles) {
+        if (dogs_.Contains(handle)) {
+            ids.push_back(dogs_.GetId(handle));
+            idle_deadlines_.Cancel(DogStore::GetSlot(handle));
+            dogs_.Remove(handle);
+        }
+    }
+    if (ids.empty()) {
+        return;
+    }
+    std::sort(ids.begin(), ids.end());
+    auto roster = std::make_shared<SessionRoster>(*GetRoster());
+    std::erase_if(roster->dogs, [&ids](const SessionRoster::Member& member) {
+        return std::binary_search(ids.begin(), ids.end(), member.id);
+    });
+    std::atomic_store(&roster_, std::shared_ptr<const SessionRoster>(std::move(roster)));
+    PublishSnapshot();
+}
+
+void GameSession::SetRetirementTime(std::chrono::milliseconds retirement_time, std::chrono::milliseconds now){
+    retirement_time_ = retirement_time;
+    idle_deadlines_ = util::TimingWheel(now.count());
+}
+
+void GameSession::ScheduleRetirement(Dog::Handle handle){
+    const auto slot = DogStore::GetSlot(handle);
+    if (retirement_time_.count() > 0 && retire_when_idle_[slot]) {
+        idle_deadlines_.Schedule(slot, idle_deadlines_.GetTime() + retirement_time_.count());
+    }
+}
+
+void GameSession::RetireIdleDogs(std::chrono::milliseconds now, std::vector<Dog::Id>& retired){
+    expired_.clear();
+    idle_deadlines_.Advance(now.count(), expired_);
+    if (expired_.empty()) {
+        return;
+    }
+    // Срок истекает только у стоящих собак: начав движение, собака снимает свой таймер
+    retiring_.clear();
+    for (const auto slot : expired_) {
+        if (const auto handle = dogs_.GetHandle(slot)) {
+            retired.push_back(dogs_.GetId(*handle));
+            retiring_.push_back(*handle);
+        }
+    }
+    RemoveDogs(retiring_);
+}
+
+bool GameSession::HasDog(Dog::Handle handle) const noexcept {
+    return dogs_.Contains(handle);
+}
 
+Dog GameSession::GetDog(Dog::Handle handle){
+    return dogs_[handle];
 }
 
-const GameSession::Dogs& GameSession::GetDogs() const {
+size_t GameSession::GetDogCount() const noexcept {
+    return dogs_.Size();
+}
+
+bool GameSession::IsIdle() const noexcept {
+    return dogs_.GetActiveCount() == 0 && commands_.Empty();
+}
+
+const DogStore& GameSession::GetDogs() const {
     return dogs_;
 }
 
@@ -493,31 +1201,159 @@ const Map& GameSession::GetMap() const{
     return *map_;
 }
 
+std::shared_ptr<const SessionSnapshot> GameSession::GetSnapshot() const {
+    return std::atomic_load(&snapshot_);
+}
+
+std::shared_ptr<const SessionRoster> GameSession::GetRoster() const {
+    return std::atomic_load(&roster_);
+}
+
+void GameSession::PublishSnapshot(){
+    if (!back_snapshot_) {
+        back_snapshot_ = std::make_shared<SessionSnapshot>();
+    }
+    auto& states = back_snapshot_->dogs;
+    auto& handles = back_snapshot_->handles;
+    auto& slot_to_dog = back_snapshot_->slot_to_dog;
+    states.clear();
+    states.reserve(dogs_.Size());
+    handles.clear();
+    slot_to_dog.assign(dogs_.GetSlotCount(), SessionSnapshot::NO_DOG);
+    for (uint32_t slot = 0; slot < dogs_.GetSlotCount(); ++slot) {
+        const auto handle = dogs_.GetHandle(slot);
+        if (!handle) {
+            continue;
+        }
+        const Dog dog = dogs_[*handle];
+        slot_to_dog[slot] = static_cast<uint32_t>(states.size());
+        states.emplace_back(dog.GetId(), dog.GetPos(), dog.GetSpeed(), dog.GetDirSymbol());
+        handles.push_back(*handle);
+    }
+    back_snapshot_->grid.Update(states.size(), [&states](uint32_t index) {
+        return states[index].pos;
+    });
+    auto prev = std::atomic_exchange(&snapshot_, std::shared_ptr<const SessionSnapshot>(std::move(back_snapshot_)));
+    // Снятый с публикации снимок новые читатели получить уже не могут. Если и старых
+    // читателей не осталось, его память используем для следующего снимка.
+    // use_count() читает счётчик без упорядочивания, поэтому барьер acquire нужен,
+    // чтобы чтения снимка последним читателем завершились до нашей записи в него
+    if (prev.use_count() == 1) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        back_snapshot_ = std::const_pointer_cast<SessionSnapshot>(std::move(prev));
+    }
+}
+
+std::optional<size_t> SessionSnapshot::FindDog(Dog::Handle handle) const noexcept {
+    const auto slot = DogStore::GetSlot(handle);
+    if (slot >= slot_to_dog.size() || slot_to_dog[slot] == NO_DOG || handles[slot_to_dog[slot]] != handle) {
+        return std::nullopt;
+    }
+    return slot_to_dog[slot];
+}
+
+void GameSession::Compact(){
+    dogs_.Compact();
+}
+
+void GameSession::Tick(std::chrono::milliseconds time_delta){
+    ApplyCommands(); // сначала выполняем команды игроков, пришедшие с прошлого тика
+    dogs_.Move(*map_, time_delta);
+    for (const auto handle : dogs_.GetStoppedDogs()) {
+        ScheduleRetirement(handle);
+    }
+}
+
+void GameSession::PushCommand(DogCommand command){
+    commands_.Push(command);
+}
+
+void GameSession::ApplyCommands(){
+    const auto dog_speed = map_->GetDogSpeed();
+    commands_.Drain([this, dog_speed](DogCommand&& command) {
+        if (!dogs_.Contains(command.dog)) {
+            return; // собака ушла из сессии после отправки команды
+        }
+        Dog dog = dogs_[command.dog];
+        if (command.dir == Dog::Dir::None) {
+            const auto speed = dog.GetSpeed();
+            dog.Stop();
+            if (speed.dir_x != 0.0 || speed.dir_y != 0.0) {
+                ScheduleRetirement(command.dog);
+            }
+        } else {
+            idle_deadlines_.Cancel(DogStore::GetSlot(command.dog));
+            dog.SetDirSpeed(command.dir, dog_speed);
+            if (command.stop_at) {
+                dogs_.SetStopPoint(command.dog, *command.stop_at);
+            }
+        }
+    });
+}
+
 Game::Game(bool randomize_spawn_points)
 : randomize_spawn_points_(randomize_spawn_points)
 {}
 
 
 void Game::AddMap(Map map) {
+    auto id = map.GetId();
+    auto name = map.GetName();
+    AddLazyMap(std::move(id), std::move(name), {});
+    auto& slot = *maps_.back();
+    slot.storage = std::make_unique<Map>(std::move(map));
+    slot.map.store(slot.storage.get(), std::memory_order_release);
+}
+
+void Game::AddLazyMap(Map::Id id, std::string name, MapLoader loader) {
     const size_t index = maps_.size();
-    if (auto [it, inserted] = map_id_to_index_.emplace(map.GetId(), index); !inserted) {
-        throw std::invalid_argument("Map with id "s + *map.GetId() + " already exists"s);
+    if (auto [it, inserted] = map_id_to_index_.emplace(id, index); !inserted) {
+        throw std::invalid_argument("Map with id "s + *id + " already exists"s);
     } else {
         try {
-            maps_.emplace_back(std::move(map));
+            map_headers_.push_back({std::move(id), std::move(name)});
+            maps_.push_back(std::make_unique<MapSlot>());
+            maps_.back()->loader = std::move(loader);
         } catch (...) {
+            if (map_headers_.size() > index) {
+                map_headers_.pop_back();
+            }
+            if (maps_.size() > index) {
+                maps_.pop_back();
+            }
             map_id_to_index_.erase(it);
             throw;
         }
     }
 }
 
-GameSession* Game::GetSession(const Map* map){
-    auto sessions_for_map = &sessions_[map];
-    if(sessions_for_map->empty()){ // если пока нет сессий для этой карты
-        sessions_for_map->emplace_back(map, randomize_spawn_points_); // добавляем сессию для этой карты
+std::shared_ptr<GameSession> Game::GetSession(const Map* map){
+    auto& sessions_for_map = sessions_[map];
+    auto has_place = [this](const std::shared_ptr<GameSession>& session) {
+        return max_players_per_session_ == 0 || session->GetDogCount() < max_players_per_session_;
+    };
+    auto it = sessions_for_map.end();
+    if (session_policy_ == SessionPolicy::FillFirst) {
+        it = std::find_if(sessions_for_map.begin(), sessions_for_map.end(), has_place);
+    } else {
+        it = std::min_element(sessions_for_map.begin(), sessions_for_map.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs->GetDogCount() < rhs->GetDogCount();
+        });
+        if (it != sessions_for_map.end() && !has_place(*it)) {
+            it = sessions_for_map.end();
+        }
+    }
+    if (it == sessions_for_map.end()) { // если на карте нет сессии со свободным местом
+        sessions_for_map.push_back(std::make_shared<GameSession>(map, randomize_spawn_points_, random_())); // добавляем сессию для этой карты
+        sessions_for_map.back()->SetRetirementTime(dog_retirement_time_, game_time_);
+        return sessions_for_map.back();
     }
-    return &(*sessions_for_map)[0]; // на данном этапе возвращаем "первую"(и пока единственную) сессию для карты 
+    return *it;
+}
+
+void Game::SetSessionLimit(size_t max_players, SessionPolicy policy){
+    max_players_per_session_ = max_players;
+    session_policy_ = policy;
 }
 
 void Game::SetDefaultDogSpeed(Dog::Dimension dog_speed) {
@@ -528,17 +1364,71 @@ Dog::Dimension Game::GetDefaultDogSpeed() const {
     return default_dog_speed_;
 }
 
+void Game::SetDogRetirementTime(std::chrono::milliseconds retirement_time){
+    dog_retirement_time_ = retirement_time;
+}
+
+const std::vector<Dog::Id>& Game::GetRetiredDogs() const noexcept {
+    return retired_dogs_;
+}
+
+void Game::SetTickThreads(unsigned threads){
+    if (threads > 1) {
+        tick_pool_ = std::make_unique<util::WorkStealingPool>(threads);
+    } else {
+        tick_pool_.reset();
+    }
+}
+
 void Game::ChangeGameSate(std::chrono::milliseconds time_delta){
     // у всех собак изменить координаты и скорость в соответствии с движением во времени
     // поменять время игры на time_delta
+    using Clock = std::chrono::steady_clock;
+    auto phase_start = Clock::now();
+    // Время фазы от конца предыдущей
+    auto finish_phase = [this, &phase_start](TickPhase phase) {
+        const auto now = Clock::now();
+        tick_timings_.Record(phase, now - phase_start);
+        phase_start = now;
+    };
+    tick_sessions_.clear();
+    retired_dogs_.clear();
+    game_time_ += time_delta;
     for (auto & [ map, sessions ] : sessions_) { // цикл по списку наборов сессий для конкретных карт
         for (auto & session : sessions) {  // цикл по списку сессий для карты
-            auto& dogs = session.GetDogs();
-            for (auto& dog : dogs) {  // цикл по собакам сессии
-                dog->CalcNewPosOnRoad(*map, time_delta);
+            // Колесо таймеров просматривает только ячейки с истекающими сроками,
+            // поэтому проверка простоя не зависит от числа собак
+            session->RetireIdleDogs(game_time_, retired_dogs_);
+            // в простаивающей сессии опубликованный снимок уже актуален
+            if (session->GetDogCount() > 0 && !session->IsIdle()) {
+                tick_sessions_.push_back(session.get());
             }
         }
+        // Сессии без собак удаляем. Запрос ушедшего игрока в потоке ввода-вывода
+        // держит свой указатель на сессию, и она освободится после него
+        std::erase_if(sessions, [](const std::shared_ptr<GameSession>& session) {
+            return session->GetDogCount() == 0;
+        });
     }
+    auto for_each_session = [this](const util::WorkStealingPool::Task& task) {
+        if (tick_pool_) {
+            tick_pool_->ParallelFor(tick_sessions_.size(), task);
+        } else {
+            for (size_t i = 0; i < tick_sessions_.size(); ++i) {
+                task(i);
+            }
+        }
+    };
+    finish_phase(TickPhase::Retirement);
+    for_each_session([this, time_delta](size_t i) {
+        tick_sessions_[i]->Tick(time_delta);
+    });
+    finish_phase(TickPhase::Movement);
+    // Все сессии сделали шаг - новое состояние становится доступно читателям
+    for_each_session([this](size_t i) {
+        tick_sessions_[i]->PublishSnapshot();
+    });
+    finish_phase(TickPhase::Snapshot);
 }
 
 // void Game::ChangeGameSate(int time_delta){
@@ -597,35 +1487,123 @@ void Game::ChangeGameSate(std::chrono::milliseconds time_delta){
 //     }
 // }
 
+std::string_view TickTimings::GetName(TickPhase phase) noexcept {
+    switch (phase) {
+    case TickPhase::Bots:
+        return "bots"sv;
+    case TickPhase::Retirement:
+        return "retirement"sv;
+    case TickPhase::Movement:
+        return "movement"sv;
+    case TickPhase::Snapshot:
+        return "snapshot"sv;
+    case TickPhase::Players:
+        return "players"sv;
+    case TickPhase::Count:
+        break;
+    }
+    return "unknown"sv;
+}
+
+TickTimings& Game::GetTickTimings() noexcept {
+    return tick_timings_;
+}
+
+const TickTimings& Game::GetTickTimings() const noexcept {
+    return tick_timings_;
+}
+
+void Game::Compact(){
+    for (auto& [map, sessions] : sessions_) {
+        for (auto& session : sessions) {
+            session->Compact();
+        }
+    }
+}
+
+void Game::SetRandomSeed(uint64_t seed) noexcept {
+    random_ = util::SplitMix64{seed};
+}
+
+uint64_t Game::GetStateChecksum() const {
+    // FNV-1a по байтам состояния собак: карты в порядке каталога, сессии в порядке создания
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto add = [&hash](uint64_t value) {
+        for (int i = 0; i < 8; ++i, value >>= 8) {
+            hash = (hash ^ (value & 0xff)) * 0x100000001b3ULL;
+        }
+    };
+    for (size_t i = 0; i < maps_.size(); ++i) {
+        // У непостроенной карты ещё нет сессий
+        const auto* map = GetLoadedMap(i);
+        const auto it = map ? sessions_.find(map) : sessions_.end();
+        if (it == sessions_.end()) {
+            continue;
+        }
+        for (const auto& session : it->second) {
+            const auto snapshot = session->GetSnapshot();
+            add(snapshot->dogs.size());
+            for (const auto& dog : snapshot->dogs) {
+                add(static_cast<uint64_t>(*dog.id));
+                add(std::bit_cast<uint64_t>(dog.pos.x));
+                add(std::bit_cast<uint64_t>(dog.pos.y));
+                add(std::bit_cast<uint64_t>(dog.speed.dir_x));
+                add(std::bit_cast<uint64_t>(dog.speed.dir_y));
+                add(static_cast<unsigned char>(dog.dir));
+            }
+        }
+    }
+    return hash;
+}
+
 Game::MapToSessions& Game::GetSessions(){
     return sessions_;
 }
 
 
 
-const Game::Maps& Game::GetMaps() const noexcept {
-    return maps_;
+const Game::MapHeaders& Game::GetMapHeaders() const noexcept {
+    return map_headers_;
 }
 
-const Map* Game::FindMap(const Map::Id& id) const noexcept {
-    if (auto it = map_id_to_index_.find(id); it != map_id_to_index_.end()) {
-        return &maps_.at(it->second);
+const Map& Game::GetMap(size_t index) const {
+    auto& slot = *maps_.at(index);
+    if (const auto* map = slot.map.load(std::memory_order_acquire)) {
+        return *map;
     }
-    return nullptr;
+    std::lock_guard lock{slot.mutex};
+    if (!slot.map.load(std::memory_order_relaxed)) {
+        // Если загрузчик бросит исключение, следующее обращение попробует снова
+        auto map = std::make_unique<Map>(slot.loader());
+        const auto& header = map_headers_[index];
+        if (map->GetId() != header.id || map->GetName() != header.name) {
+            throw std::runtime_error("Map "s + *map->GetId() + " does not match catalog entry "s + *header.id);
+        }
+        slot.storage = std::move(map);
+        slot.loader = nullptr;
+        slot.map.store(slot.storage.get(), std::memory_order_release);
+    }
+    return *slot.storage;
 }
 
-Dog* Game::AddDog(std::string name){
-    Dog::Id id(dogs_.size()+1);
-    dogs_.push_back(std::make_unique<Dog>(name, id));
-    return dogs_.back().get();
+const Map* Game::GetLoadedMap(size_t index) const noexcept {
+    return maps_[index]->map.load(std::memory_order_acquire);
 }
 
+bool Game::IsMapLoaded(const Map::Id& id) const noexcept {
+    const auto it = map_id_to_index_.find(id);
+    return it != map_id_to_index_.end() && GetLoadedMap(it->second) != nullptr;
+}
 
-const Dog& Game::GetDog(Dog::Id id) const {
-    if(*id < dogs_.size()){
-        return *dogs_[*id];
+const Map* Game::FindMap(const Map::Id& id) const {
+    if (auto it = map_id_to_index_.find(id); it != map_id_to_index_.end()) {
+        return &GetMap(it->second);
     }
-    throw;
+    return nullptr;
+}
+
+Dog::Id Game::NewDogId(){
+    return Dog::Id{++last_dog_id_};
 }
 
 }  // namespace model
@@ -1,14 +1,29 @@
 #pragma once
+#include <array>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
+#include <algorithm>
+#include <atomic>
 #include <random>
 #include <sstream>
 #include <memory>
 #include <iomanip>
 #include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <span>
 
 #include "tagged.h"
+#include "fast_random.h"
+#include "mpsc_queue.h"
+#include "work_stealing_pool.h"
+#include "timing_wheel.h"
+#include "histogram.h"
 
 namespace model {
 
@@ -77,14 +92,71 @@ private:
     Offset offset_;
 };
 
+// Скомпилированная дорожная сеть карты. Дороги одного уровня, которые касаются
+// или перекрываются, объединены в пути. Граф сети: вершины - концы путей и точки
+// их пересечений, рёбра - участки путей между соседними вершинами.
+// Граф хранится в сжатом виде (CSR): рёбра вершины v лежат в
+// edges_[edge_offsets_[v], edge_offsets_[v + 1])
+class RoadNetwork {
+public:
+    // Coord level - это координа общая для обеих точек отрезка дороги 
+    // для горизонтальных дорог это "y", для вертикальных - "x"
+    // point1 <= point2 - это координаты точек на оставшейся оси, отличной от level
+    struct Path {Coord level, point1, point2;};
+    using NodeId = uint32_t;
+    struct Edge {
+        NodeId to;
+        Dimension length;
+    };
+
+    // Сложность O((n + k) log n), где n - число дорог, k - число пересечений путей
+    static RoadNetwork Compile(const std::vector<Road>& roads);
+
+    // Пути упорядочены по уровню и началу пути
+    const std::vector<Path>& GetHorizontalPaths() const noexcept;
+    const std::vector<Path>& GetVerticalPaths() const noexcept;
+
+    size_t GetNodeCount() const noexcept;
+    Point GetNodePos(NodeId node) const noexcept;
+    std::span<const Edge> GetEdges(NodeId node) const noexcept;
+    std::optional<NodeId> FindNode(Point pos) const noexcept;
+    // Вершины пути в порядке возрастания координаты вдоль него. Номера путей:
+    // сначала горизонтальные, затем вертикальные, как в Map::Segment
+    std::span<const NodeId> GetPathNodes(uint32_t path) const noexcept;
+    // Соседние вершины пути, между которыми лежит точка на оси дороги.
+    // Если точка совпадает с вершиной, обе вершины равны ей
+    struct Location {
+        NodeId node1, node2;
+    };
+    std::optional<Location> Locate(double x, double y) const noexcept;
+private:
+    std::vector<Path> h_paths_;
+    std::vector<Path> v_paths_;
+    std::vector<Point> nodes_; // упорядочены по x, затем по y; номер вершины - индекс
+    std::vector<uint32_t> edge_offsets_;
+    std::vector<Edge> edges_;
+    // вершины пути p лежат в path_nodes_[path_node_offsets_[p], path_node_offsets_[p + 1])
+    std::vector<uint32_t> path_node_offsets_;
+    std::vector<NodeId> path_nodes_;
+
+    std::optional<Location> LocateOnPath(uint32_t path, double point) const noexcept;
+};
+
 class Map;
 
+class DogStore;
+
+// Собака сессии. Сами данные собак лежат в DogStore сессии, объект Dog -
+// лишь лёгкая ссылка на них, его можно свободно копировать
 class Dog {
     public:
         using Id = util::Tagged<int, Dog>;
-        Dog(std::string user_name, Id id) noexcept;
+        // Номер слота собаки в хранилище и поколение слота, см. DogStore
+        using Handle = util::Tagged<uint64_t, DogStore>;
+        Dog(DogStore& store, Handle handle) noexcept;
         const Id& GetId() const noexcept ;
         const std::string& GetName() const noexcept ;
+        Handle GetHandle() const noexcept;
     
         using Dimension = double;
         using Coord = Dimension;
@@ -98,23 +170,197 @@ class Dog {
         enum class Dir: char {Left = 'L', Right = 'R', Up = 'U', Down = 'D', None = 0}; 
     
         void SetPos(Pos pos);
-        void SetPos(bool IsHorizontal, Pos pos);
         Pos GetPos() const;
         Speed GetSpeed() const;
-        void SetSpeed(Speed speed);
         void Stop();
-        void SetSpeed(Dir dir, Dimension dog_speed);
         char GetDirSymbol() const;
         void SetDirSpeed(Dir dir, Dimension dog_speed);
         static char CheckDirSymbol(char dir);
-        void CalcNewPosOnRoad(const Map& map, const std::chrono::milliseconds time_delta);      
     private:
-        Id id_;
-        std::string name_;
-        Pos pos_;
-        Speed speed_;
-        Dir dir_ = Dir::Up;
+        DogStore* store_;
+        Handle handle_;
     };
+
+// Собаки сессии в виде структуры массивов: горячие данные, которые читает и
+// пишет тик (координаты, скорости, пределы движения), лежат в отдельных непрерывных
+// массивах, а имена, идентификаторы и направления - отдельно от них.
+// Движущиеся собаки собраны в начале горячих массивов, и тик обходит только их.
+// Поэтому положение собаки в горячих массивах меняется, а Handle - нет.
+// Холодные данные лежат в слотах. Слот ушедшей собаки попадает в список свободных
+// и достаётся следующей новой собаке, а поколение слота увеличивается: Handle
+// ушедшей собаки содержит старое поколение, и его устаревание видно сразу
+class DogStore {
+public:
+    using Handle = Dog::Handle;
+    Handle Add(Dog::Id id, std::string name, Dog::Pos pos);
+    // Удаляет собаку. Её место в горячих массивах занимает последняя собака
+    void Remove(Handle handle) noexcept;
+    // Собака с этим Handle есть в хранилище
+    bool Contains(Handle handle) const noexcept;
+    // Количество собак
+    size_t Size() const noexcept;
+    // Количество слотов, включая свободные
+    size_t GetSlotCount() const noexcept;
+    // Handle собаки в слоте slot или nullopt, если слот свободен
+    std::optional<Handle> GetHandle(uint32_t slot) const noexcept;
+    static uint32_t GetSlot(Handle handle) noexcept;
+    // Отбрасывает свободные слоты в конце, возвращает лишнюю память и упорядочивает
+    // собак в горячих массивах по слотам, чтобы обход по слотам шёл подряд по памяти
+    void Compact();
+    // Количество движущихся собак
+    size_t GetActiveCount() const noexcept;
+    Dog operator[](Handle handle) noexcept;
+
+    const Dog::Id& GetId(Handle handle) const noexcept;
+    const std::string& GetName(Handle handle) const noexcept;
+    Dog::Pos GetPos(Handle handle) const noexcept;
+    void SetPos(Handle handle, Dog::Pos pos) noexcept;
+    Dog::Speed GetSpeed(Handle handle) const noexcept;
+    void SetSpeed(Handle handle, Dog::Speed speed) noexcept;
+    Dog::Dir GetDir(Handle handle) const noexcept;
+    // Сбрасывает точку остановки собаки
+    void SetDir(Handle handle, Dog::Dir dir) noexcept;
+    // Собака остановится в точке stop_at на оси своего движения, не доходя до края пути.
+    // Действует до следующей смены направления
+    void SetStopPoint(Handle handle, Dog::Coord stop_at) noexcept;
+    // Путь, по которому собака двигалась на последнем тике
+    uint32_t GetSegment(Handle handle) const noexcept;
+
+    // Перемещает движущихся собак по дорогам карты за время time_delta
+    void Move(const Map& map, std::chrono::milliseconds time_delta);
+    // Собаки, остановившиеся на краю пути во время последнего Move
+    const std::vector<Handle>& GetStoppedDogs() const noexcept;
+private:
+    // Находит путь, по которому движется собака, и пределы её движения
+    void UpdateSegment(const Map& map, Handle handle);
+    // Переносит собаку с индексом index в группу движущихся или стоящих собак
+    void SetMoving(size_t index, bool moving) noexcept;
+    void SwapDogs(size_t lhs, size_t rhs) noexcept;
+    static Handle MakeHandle(uint32_t slot, uint32_t generation) noexcept;
+    static uint32_t GetGeneration(Handle handle) noexcept;
+    // Переставляет собак горячих массивов: на место i встаёт собака order[i]
+    void Reorder(const std::vector<uint32_t>& order);
+
+    static constexpr uint32_t NO_INDEX = std::numeric_limits<uint32_t>::max();
+
+    // горячие данные, индекс собаки - slot_to_index_[handle]
+    std::vector<Dog::Coord> pos_x_;
+    std::vector<Dog::Coord> pos_y_;
+    std::vector<Dog::Dimension> speed_x_;
+    std::vector<Dog::Dimension> speed_y_;
+    // Пределы движения собаки вдоль её пути. Определяются только после смены
+    // направления: двигаясь прямо, собака остаётся на том же пути
+    std::vector<Dog::Coord> bound_min_;
+    std::vector<Dog::Coord> bound_max_;
+    std::vector<uint32_t> index_to_slot_;
+    size_t active_count_ = 0; // движущиеся собаки занимают индексы [0, active_count_)
+    // холодные данные, по слоту
+    std::vector<uint32_t> slot_to_index_; // NO_INDEX для свободного слота
+    std::vector<uint32_t> generations_;
+    std::vector<Dog::Dir> dir_;
+    std::vector<uint32_t> segment_;
+    std::vector<std::optional<Dog::Coord>> stop_at_;
+    std::vector<Dog::Id> ids_;
+    std::vector<std::string> names_;
+    std::vector<Handle> stale_segments_; // собаки, сменившие направление или положение
+    std::vector<Handle> stopped_;
+    // Свободные слоты в виде кучи: первым занимается слот с меньшим номером,
+    // поэтому свободные слоты копятся в конце, где их отбрасывает Compact
+    std::vector<uint32_t> free_slots_;
+    // Поколение для новых слотов. Больше поколений отброшенных слотов, чтобы
+    // Handle отброшенного слота не совпал с Handle новой собаки в нём
+    uint32_t next_generation_ = 0;
+};
+
+// Предметы на карте (офисы, в будущем - потерянные вещи), разложенные по клеткам
+// равномерной сетки. Хранятся только непустые клетки, поэтому память зависит от
+// числа предметов, а не от размеров карты. Добавление и удаление - O(1): предмет
+// знает своё место в списке клетки и при удалении меняется местами с последним.
+// Номера предметов - небольшие числа (например, индексы в векторе)
+class ItemGrid {
+public:
+    using ItemId = uint32_t;
+    // Отрезок движения собаки за тик
+    struct Segment {
+        Dog::Pos from, to;
+    };
+
+    explicit ItemGrid(Dog::Dimension cell_size = 1.0);
+    void Insert(ItemId id, Dog::Pos pos);
+    void Remove(ItemId id) noexcept;
+    bool Contains(ItemId id) const noexcept;
+    size_t Size() const noexcept;
+    Dog::Pos GetPos(ItemId id) const noexcept;
+    // Вызывает f(id) для предметов на расстоянии не больше radius от отрезка
+    template <typename F>
+    void ForEachNear(const Segment& segment, Dog::Dimension radius, F&& f) const;
+    // Пакетный запрос по отрезкам движения многих собак: f(номер отрезка, id)
+    template <typename F>
+    void ForEachNear(std::span<const Segment> segments, Dog::Dimension radius, F&& f) const;
+
+private:
+    static constexpr uint32_t NO_INDEX = std::numeric_limits<uint32_t>::max();
+    struct Item {
+        Dog::Pos pos;
+        uint64_t cell = 0;
+        uint32_t index = NO_INDEX; // место в списке клетки, NO_INDEX - предмета нет
+    };
+    Dog::Dimension cell_size_;
+    std::vector<Item> items_;
+    std::unordered_map<uint64_t, std::vector<ItemId>> cells_;
+    size_t size_ = 0;
+
+    int32_t GetCell(Dog::Coord coord) const noexcept;
+    static uint64_t GetKey(int32_t row, int32_t column) noexcept;
+    static bool IsNear(const Segment& segment, Dog::Pos pos, Dog::Dimension radius) noexcept;
+};
+
+template <typename F>
+void ItemGrid::ForEachNear(const Segment& segment, Dog::Dimension radius, F&& f) const {
+    const auto min_x = std::min(segment.from.x, segment.to.x) - radius;
+    const auto max_x = std::max(segment.from.x, segment.to.x) + radius;
+    const auto min_y = std::min(segment.from.y, segment.to.y) - radius;
+    const auto max_y = std::max(segment.from.y, segment.to.y) + radius;
+    const auto first_row = GetCell(min_y), last_row = GetCell(max_y);
+    const auto first_column = GetCell(min_x), last_column = GetCell(max_x);
+    const auto cell_count = (int64_t{last_row} - first_row + 1) * (int64_t{last_column} - first_column + 1);
+    // Для длинного отрезка проще проверить все предметы, чем все клетки вокруг него
+    if (cell_count > static_cast<int64_t>(cells_.size())) {
+        for (const auto& [key, ids] : cells_) {
+            for (const auto id : ids) {
+                if (IsNear(segment, items_[id].pos, radius)) {
+                    f(id);
+                }
+            }
+        }
+        return;
+    }
+    for (auto row = first_row; row <= last_row; ++row) {
+        for (auto column = first_column; column <= last_column; ++column) {
+            const auto it = cells_.find(GetKey(row, column));
+            if (it == cells_.end()) {
+                continue;
+            }
+            for (const auto id : it->second) {
+                if (IsNear(segment, items_[id].pos, radius)) {
+                    f(id);
+                }
+            }
+        }
+    }
+}
+
+template <typename F>
+void ItemGrid::ForEachNear(std::span<const Segment> segments, Dog::Dimension radius, F&& f) const {
+    if (size_ == 0) {
+        return;
+    }
+    for (size_t i = 0; i < segments.size(); ++i) {
+        ForEachNear(segments[i], radius, [&f, i](ItemId id) {
+            f(i, id);
+        });
+    }
+}
         
 class Map {
 public:
@@ -132,26 +378,57 @@ public:
     void AddRoad(const Road&& road);
     void AddBuilding(const Building& building);
     void AddOffice(Office office);
-    Dog::Pos GetRandomPos() const;
+    // Случайная точка на дорогах карты: дорога выбирается с вероятностью,
+    // пропорциональной её длине. Доступно после BildListOderedPath
+    Dog::Pos GetRandomPos(util::SplitMix64& random) const;
     Dog::Pos GetStartPos() const;
     void SetDogSpeed(Dog::Dimension dog_speed);
     Dog::Dimension GetDogSpeed() const;
+    // Компилирует дорожную сеть карты. Вызывается после добавления всех дорог
     void BildListOderedPath();
+    const RoadNetwork& GetRoadNetwork() const noexcept;
+    // Офисы на расстоянии не больше radius от отрезка движения собаки:
+    // f(индекс офиса в GetOffices())
+    template <typename F>
+    void ForEachOfficeNear(const ItemGrid::Segment& segment, Dog::Dimension radius, F&& f) const {
+        office_index_.ForEachNear(segment, radius, std::forward<F>(f));
+    }
+    // Путь (объединённые дороги одного уровня), которому принадлежит клетка дороги.
+    // Номера путей: сначала горизонтальные пути сети, затем вертикальные
+    struct Segment {
+        uint32_t id;
+        Dimension begin, end; // пределы пути вдоль его направления
+    };
+    static constexpr uint32_t NO_SEGMENT = std::numeric_limits<uint32_t>::max();
+    // Для клетки вне дорог возвращает NO_SEGMENT с пределами, равными самой клетке
+    Segment GetSegment(bool IsHorizontal, Dimension level, Dimension point) const;
     Dimension GetEndOfPath(bool IsHorizontal, bool to_right, Dimension level_dog, Dimension point_dog) const ;
     Dimension GetEndOfPathV(Dimension level_dog, Dimension point_dog, bool to_right) const ;
 private:
     using OfficeIdToIndex = std::unordered_map<Office::Id, size_t, util::TaggedHasher<Office::Id>>;
-    struct Path {Coord level, point1, point2;};
-    // Coord level - это координа общая для обеих точек отрезка дороги 
-    // для горизонтальных дорог это "y", для вертикальных - "x"
-    // point1, point2 - это координаты точек на оставшейся оси, отличной от level
+    using Path = RoadNetwork::Path;
     class OrderedListPaths {
     public:
-        void BildListOderedPath();
+        static constexpr uint32_t NO_PATH = std::numeric_limits<uint32_t>::max();
+        // Пути должны быть объединены и упорядочены, как в RoadNetwork
+        void Build(std::vector<Path> paths);
         Dimension GetEndOfPath(Dimension level_dog, Dimension point_dog, bool to_right) const ;
-        void AddPath(Coord base, Coord point1, Coord point2);
+        // Номер пути, которому принадлежит клетка, или NO_PATH
+        uint32_t FindPath(Dimension level, Dimension point) const;
+        const Path& GetPath(uint32_t index) const;
+        size_t Size() const noexcept;
     private:
+        // Клетки одного уровня (строки или столбца): для каждой целой координаты
+        // от first_point - номер пути в paths_, которому принадлежит клетка
+        struct Line {
+            Coord first_point = 0;
+            std::vector<uint32_t> cell_paths;
+        };
         std::vector<Path> paths_;
+        Coord first_level_ = 0;
+        std::vector<Line> lines_; // линия уровня level хранится в lines_[level - first_level_]
+
+        void BuildLines();
     };
     Id id_;
     std::string name_;
@@ -160,54 +437,325 @@ private:
 
     OfficeIdToIndex warehouse_id_to_index_;
     Offices offices_;
+    ItemGrid office_index_; // номера предметов - индексы в offices_
     Dog::Dimension dog_speed_;
+    RoadNetwork road_network_;
     OrderedListPaths h_paths_;
     OrderedListPaths v_paths_;
+    util::AliasTable road_sampler_; // выбор дороги для случайной точки
     // void BildListOderedPath(OrderedListPaths paths);
 };
 
+// Прямоугольная область карты, границы включаются
+struct Area {
+    Dog::Coord min_x, min_y, max_x, max_y;
+};
+
+// Равномерная сетка положений собак для выборки собак в области. Собаки
+// хранятся упорядоченными по ключу клетки (строка, затем столбец), поэтому
+// память не зависит от размеров карты, а клетки строки идут подряд
+class DogGrid {
+public:
+    static constexpr Dog::Dimension CELL_SIZE = 8.0;
+
+    // Пересчитывает клетки count собак с положениями get_pos(index). Порядок
+    // сохраняется с прошлого вызова: между тиками клетку меняют немногие собаки,
+    // и упорядочивание вставками почти линейно, а если ни одна собака не сменила
+    // клетку, упорядочивание не нужно вовсе
+    template <typename GetPos>
+    void Update(size_t count, GetPos get_pos);
+    // Вызывает f(index) для каждой собаки в области
+    template <typename F>
+    void ForEachInArea(const Area& area, F&& f) const;
+
+private:
+    struct Entry {
+        uint64_t key;
+        uint32_t index;
+    };
+    std::vector<Entry> entries_; // упорядочены по key
+    std::vector<Dog::Pos> positions_; // по индексу собаки
+
+    static int32_t GetCell(Dog::Coord coord) noexcept;
+    static uint64_t GetKey(int32_t row, int32_t column) noexcept;
+    static int32_t GetRow(uint64_t key) noexcept;
+    void Sort();
+};
+
+template <typename GetPos>
+void DogGrid::Update(size_t count, GetPos get_pos) {
+    positions_.resize(count);
+    if (entries_.size() > count) {
+        entries_.clear();
+    }
+    // Новые собаки добавляются в конец, их место найдёт упорядочивание
+    bool changed = entries_.size() < count;
+    for (auto i = static_cast<uint32_t>(entries_.size()); i < count; ++i) {
+        entries_.push_back({0, i});
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        positions_[i] = get_pos(i);
+    }
+    for (auto& entry : entries_) {
+        const auto pos = positions_[entry.index];
+        const auto key = GetKey(GetCell(pos.y), GetCell(pos.x));
+        if (key != entry.key) {
+            entry.key = key;
+            changed = true;
+        }
+    }
+    if (changed) {
+        Sort();
+    }
+}
+
+template <typename F>
+void DogGrid::ForEachInArea(const Area& area, F&& f) const {
+    if (entries_.empty() || area.min_x > area.max_x || area.min_y > area.max_y) {
+        return;
+    }
+    // Строки сетки за пределами занятых собаками не просматриваем
+    const auto first_row = std::max(GetCell(area.min_y), GetRow(entries_.front().key));
+    const auto last_row = std::min(GetCell(area.max_y), GetRow(entries_.back().key));
+    const auto first_column = GetCell(area.min_x);
+    const auto last_column = GetCell(area.max_x);
+    auto it = entries_.begin();
+    for (auto row = first_row; row <= last_row; ++row) {
+        const auto last_key = GetKey(row, last_column);
+        it = std::lower_bound(it, entries_.end(), GetKey(row, first_column), [](const Entry& entry, uint64_t key) {
+            return entry.key < key;
+        });
+        for (; it != entries_.end() && it->key <= last_key; ++it) {
+            const auto pos = positions_[it->index];
+            if (pos.x >= area.min_x && pos.x <= area.max_x && pos.y >= area.min_y && pos.y <= area.max_y) {
+                f(it->index);
+            }
+        }
+    }
+}
+
+// Неизменяемый снимок положения собак сессии. Публикуется после каждого тика,
+// читается из любых потоков без блокировок
+struct SessionSnapshot {
+    struct DogState {
+        Dog::Id id;
+        Dog::Pos pos;
+        Dog::Speed speed;
+        char dir;
+    };
+    static constexpr uint32_t NO_DOG = std::numeric_limits<uint32_t>::max();
+    std::vector<DogState> dogs; // в порядке слотов собак
+    std::vector<Dog::Handle> handles; // Handle собаки dogs[i]
+    std::vector<uint32_t> slot_to_dog; // индекс в dogs по слоту собаки или NO_DOG
+    DogGrid grid; // индексы в сетке - индексы в dogs
+    // Индекс собаки в dogs или nullopt, если её не было в сессии на момент снимка
+    std::optional<size_t> FindDog(Dog::Handle handle) const noexcept;
+};
+
+// Неизменяемый список участников сессии. Публикуется при входе игрока в сессию
+struct SessionRoster {
+    struct Member {
+        Dog::Id id;
+        std::string name;
+    };
+    std::vector<Member> dogs;
+};
+
 class GameSession {
 public:
-    using Dogs = std::vector<Dog*>;
-    GameSession(const Map* map, bool randomize_spawn_points) noexcept;
-    void AddDog(Dog* dog);
-    const Dogs& GetDogs() const;
+    // Команда игрока на изменение направления движения собаки
+    struct DogCommand {
+        Dog::Handle dog;
+        Dog::Dir dir;
+        std::optional<Dog::Coord> stop_at{}; // точка остановки на пути (для ботов)
+    };
+    // seed - зерно генератора случайных точек появления собак
+    GameSession(const Map* map, bool randomize_spawn_points, uint64_t seed = 0) noexcept;
+    GameSession(const GameSession&) = delete;
+    GameSession& operator=(const GameSession&) = delete;
+    // Собака с retire_when_idle = false (например, бот) не уходит из сессии при простое
+    Dog AddDog(Dog::Id id, std::string name, bool retire_when_idle = true);
+    // Удаляет собаку из сессии. Команды для неё, ещё стоящие в очереди, будут пропущены
+    void RemoveDog(Dog::Handle handle);
+    // Собака, простоявшая retirement_time, уходит из сессии. 0 - собаки не уходят.
+    // now - время игры, от которого идут часы сессии. Вызывается до добавления собак
+    void SetRetirementTime(std::chrono::milliseconds retirement_time, std::chrono::milliseconds now = {});
+    // Продвигает часы сессии до now (время игры) и удаляет собак, чей простой истёк.
+    // Их идентификаторы добавляются в retired
+    void RetireIdleDogs(std::chrono::milliseconds now, std::vector<Dog::Id>& retired);
+    bool HasDog(Dog::Handle handle) const noexcept;
+    size_t GetDogCount() const noexcept;
+    // В сессии никто не движется и нет новых команд - тик её не изменит
+    bool IsIdle() const noexcept;
+    Dog GetDog(Dog::Handle handle);
+    const DogStore& GetDogs() const;
     const Map& GetMap() const;
+    // Ставит команду в очередь сессии. Можно вызывать из любого потока,
+    // команда будет выполнена в начале следующего тика
+    void PushCommand(DogCommand command);
+    // Выполняет все накопленные команды в порядке их поступления
+    void ApplyCommands();
+    // Шаг симуляции сессии: команды игроков, затем движение собак.
+    // Сессии независимы друг от друга, поэтому их можно обрабатывать параллельно
+    void Tick(std::chrono::milliseconds time_delta);
+    // Последние опубликованные снимки. Можно вызывать из любого потока
+    std::shared_ptr<const SessionSnapshot> GetSnapshot() const;
+    std::shared_ptr<const SessionRoster> GetRoster() const;
+    // Публикует снимок текущего состояния собак. Вызывается после тика
+    void PublishSnapshot();
+    // Уплотняет хранилище собак. Вызывается в strand между тиками
+    void Compact();
 private:
-    Dogs dogs_;
+    DogStore dogs_;
     const Map* map_;
     bool randomize_spawn_points_;
+    util::SplitMix64 random_;
+    util::MpscQueue<DogCommand> commands_;
+    // Опубликованные снимки читаются и заменяются через std::atomic_load/std::atomic_store
+    std::shared_ptr<const SessionSnapshot> snapshot_ = std::make_shared<SessionSnapshot>();
+    std::shared_ptr<const SessionRoster> roster_ = std::make_shared<SessionRoster>();
+    // Буфер для следующего снимка - предыдущий снимок, если его уже никто не читает.
+    // Сетка собак обновляется прямо в буфере, начиная с порядка этого снимка
+    std::shared_ptr<SessionSnapshot> back_snapshot_;
+    // Сроки ухода стоящих собак по слотам. Команда движения отменяет срок, остановка
+    // назначает новый, поэтому тик не просматривает простаивающих собак
+    std::chrono::milliseconds retirement_time_{0};
+    util::TimingWheel idle_deadlines_;
+    std::vector<uint8_t> retire_when_idle_; // по слоту собаки
+    std::vector<util::TimingWheel::Key> expired_;
+    std::vector<Dog::Handle> retiring_;
+
+    void ScheduleRetirement(Dog::Handle handle);
+    // Удаляет собак и публикует один снимок и список участников на всех
+    void RemoveDogs(std::span<const Dog::Handle> handles);
+};
+
+// Фазы тика игры, время которых измеряется
+enum class TickPhase {
+    Bots,       // команды ботам
+    Retirement, // уход простаивающих собак
+    Movement,   // команды игроков и движение собак
+    Snapshot,   // публикация снимков сессий
+    Players,    // уход игроков и уплотнение хранилищ
+    Count
+};
+
+// Гистограммы времени фаз тиков. Пишутся внутри strand
+class TickTimings {
+public:
+    void Record(TickPhase phase, util::Histogram::Duration duration) noexcept {
+        phases_[static_cast<size_t>(phase)].Record(duration);
+    }
+    const util::Histogram& Get(TickPhase phase) const noexcept {
+        return phases_[static_cast<size_t>(phase)];
+    }
+    static std::string_view GetName(TickPhase phase) noexcept;
+
+private:
+    std::array<util::Histogram, static_cast<size_t>(TickPhase::Count)> phases_;
+};
+
+// Способ выбора сессии для нового игрока
+enum class SessionPolicy {
+    FillFirst,   // первая сессия карты, в которой есть место
+    LeastLoaded  // наименее заполненная сессия карты
+};
+
+// Карта в каталоге игры: идентификатор и название известны сразу,
+// а сама карта может строиться при первом обращении
+struct MapHeader {
+    Map::Id id;
+    std::string name;
 };
 
 class Game {
 public:
-    using Maps = std::vector<Map>;
+    using MapHeaders = std::vector<MapHeader>;
+    using MapLoader = std::function<Map()>;
     Game(bool randomize_spawn_points);
     void AddMap(Map map);
-    const Maps& GetMaps() const noexcept ;
-    const Map* FindMap(const Map::Id& id) const noexcept ;
+    // Добавляет карту, которую loader построит при первом обращении к ней
+    void AddLazyMap(Map::Id id, std::string name, MapLoader loader);
+    // Каталог всех карт в порядке добавления. Карты не строятся
+    const MapHeaders& GetMapHeaders() const noexcept;
+    // Карта с номером index в каталоге. Строится при первом обращении,
+    // можно вызывать из любого потока. Если построенная карта не совпадает
+    // с каталогом по id или названию, бросает std::runtime_error
+    const Map& GetMap(size_t index) const;
+    // Карта с идентификатором id (строится при первом обращении) или nullptr.
+    // Исключения загрузчика карты передаются вызывающему
+    const Map* FindMap(const Map::Id& id) const;
+    // Карта уже построена (загружена сразу или к ней уже обращались)
+    bool IsMapLoaded(const Map::Id& id) const noexcept;
     // No copy functions.
     Game(const Game&) = delete;
     void operator=(const Game&) = delete;
-    Dog* AddDog(std::string name);
-    const Dog& GetDog(Dog::Id id) const ;
-    GameSession* GetSession(const Map* map);
+    // Выдаёт идентификатор для новой собаки
+    Dog::Id NewDogId();
+    // Сессия на карте, в которую можно добавить игрока. Новая сессия
+    // создаётся, если во всех сессиях карты уже максимальное число игроков.
+    // Сессия, оставшаяся без собак, удаляется из игры на следующем тике, а память
+    // освобождается, когда её отпустят все, кто получил на неё указатель
+    std::shared_ptr<GameSession> GetSession(const Map* map);
+    // max_players = 0 - число игроков в сессии не ограничено
+    void SetSessionLimit(size_t max_players, SessionPolicy policy);
     void SetDefaultDogSpeed(Dog::Dimension dog_speed);
     Dog::Dimension GetDefaultDogSpeed() const;
+    // Время простоя, после которого собака уходит из игры. 0 - не уходит.
+    // Действует на сессии, созданные после вызова
+    void SetDogRetirementTime(std::chrono::milliseconds retirement_time);
+    // Собаки, ушедшие из игры на последнем тике
+    const std::vector<Dog::Id>& GetRetiredDogs() const noexcept;
+    // Количество потоков, между которыми распределяются сессии во время тика
+    void SetTickThreads(unsigned threads);
     void ChangeGameSate(std::chrono::milliseconds time_delta);
+    // Уплотняет хранилища собак всех сессий
+    void Compact();
+    // Время фаз тиков. Фазы игры записывает ChangeGameSate, фазы приложения - приложение
+    TickTimings& GetTickTimings() noexcept;
+    const TickTimings& GetTickTimings() const noexcept;
+    // Задаёт зерно, из которого выводятся генераторы новых сессий. С одинаковым
+    // зерном и одинаковыми действиями игроков игра проходит одинаково.
+    // Без вызова зерно берётся из std::random_device
+    void SetRandomSeed(uint64_t seed) noexcept;
+    // Контрольная сумма опубликованного состояния собак всех сессий. Порядок
+    // обхода не зависит от адресов в памяти, поэтому сумма воспроизводима
+    uint64_t GetStateChecksum() const;
 
 private:
     using MapIdHasher = util::TaggedHasher<Map::Id>;
     using MapIdToIndex = std::unordered_map<Map::Id, size_t, MapIdHasher>;
-    using MapToSessions = std::unordered_map<const Map*, std::vector<GameSession>>;
-    std::vector<Map> maps_;
+    // Сессии хранятся по указателю: на них ссылаются игроки, боты и запросы в потоках
+    // ввода-вывода, а очередь команд сессии неперемещаема
+    using MapToSessions = std::unordered_map<const Map*, std::vector<std::shared_ptr<GameSession>>>;
+    // Построенная карта публикуется через map и дальше не меняется.
+    // Карты строятся под блокировкой своего слота и не ждут друг друга
+    struct MapSlot {
+        MapLoader loader;
+        std::unique_ptr<Map> storage;
+        std::atomic<const Map*> map{nullptr};
+        std::mutex mutex;
+    };
+    MapHeaders map_headers_;
+    std::vector<std::unique_ptr<MapSlot>> maps_; // по номеру в каталоге
     MapIdToIndex map_id_to_index_;
-    std::vector<std::unique_ptr<Dog>> dogs_;
+    int last_dog_id_ = 0;
     MapToSessions sessions_;
     Dog::Dimension default_dog_speed_ = 1.0;
     bool randomize_spawn_points_;
+    util::SplitMix64 random_{util::MakeRandomSeed()}; // зёрна генераторов сессий
+    std::chrono::milliseconds dog_retirement_time_{0};
+    std::chrono::milliseconds game_time_{0}; // время игры, часы колёс таймеров сессий
+    std::vector<Dog::Id> retired_dogs_;
+    size_t max_players_per_session_ = 0;
+    SessionPolicy session_policy_ = SessionPolicy::FillFirst;
+    std::unique_ptr<util::WorkStealingPool> tick_pool_;
+    std::vector<GameSession*> tick_sessions_; // сессии текущего тика
+    TickTimings tick_timings_;
 
     MapToSessions& GetSessions();
+    // Карта, если она уже построена, иначе nullptr
+    const Map* GetLoadedMap(size_t index) const noexcept;
 };
 
 }  // namespace model
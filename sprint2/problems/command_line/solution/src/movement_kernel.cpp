@@ -0,0 +1,139 @@
+#include "movement_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MOVEMENT_KERNEL_X86
+#endif
+
+namespace movement {
+
+namespace {
+
+void IntegrateScalar(const DogArrays& dogs, size_t first, double time_delta) {
+    for (size_t i = first; i < dogs.count; ++i) {
+        const bool horizontal = dogs.speed_x[i] != 0.0;
+        if (!horizontal && dogs.speed_y[i] == 0.0) { // собака стоит
+            continue;
+        }
+        double& point = horizontal ? dogs.pos_x[i] : dogs.pos_y[i];
+        const double speed = horizontal ? dogs.speed_x[i] : dogs.speed_y[i];
+        double point2 = point + speed * time_delta;
+        if (speed > 0 ? point2 >= dogs.bound_max[i] : point2 <= dogs.bound_min[i]) {
+            point2 = speed > 0 ? dogs.bound_max[i] : dogs.bound_min[i];
+            dogs.speed_x[i] = dogs.speed_y[i] = 0.0; // Останавливаем собаку на краю дороги
+        }
+        point = point2;
+    }
+}
+
+#ifdef MOVEMENT_KERNEL_X86
+
+__m128d SelectSse2(__m128d mask, __m128d if_true, __m128d if_false) {
+    return _mm_or_pd(_mm_and_pd(mask, if_true), _mm_andnot_pd(mask, if_false));
+}
+
+size_t IntegrateSse2(const DogArrays& dogs, double time_delta) {
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d delta = _mm_set1_pd(time_delta);
+    size_t i = 0;
+    for (; i + 2 <= dogs.count; i += 2) {
+        const __m128d speed_x = _mm_loadu_pd(dogs.speed_x + i);
+        const __m128d speed_y = _mm_loadu_pd(dogs.speed_y + i);
+        const __m128d horizontal = _mm_cmpneq_pd(speed_x, zero);
+        const __m128d moving = _mm_or_pd(horizontal, _mm_cmpneq_pd(speed_y, zero));
+        if (_mm_movemask_pd(moving) == 0) {
+            continue;
+        }
+        const __m128d pos_x = _mm_loadu_pd(dogs.pos_x + i);
+        const __m128d pos_y = _mm_loadu_pd(dogs.pos_y + i);
+        const __m128d bound_min = _mm_loadu_pd(dogs.bound_min + i);
+        const __m128d bound_max = _mm_loadu_pd(dogs.bound_max + i);
+        const __m128d speed = SelectSse2(horizontal, speed_x, speed_y);
+        const __m128d point1 = SelectSse2(horizontal, pos_x, pos_y);
+        const __m128d point2 = _mm_add_pd(point1, _mm_mul_pd(speed, delta));
+        const __m128d forward = _mm_cmpgt_pd(speed, zero);
+        const __m128d at_max = _mm_and_pd(forward, _mm_cmpge_pd(point2, bound_max));
+        const __m128d at_min = _mm_andnot_pd(forward, _mm_cmple_pd(point2, bound_min));
+        const __m128d stop = _mm_and_pd(_mm_or_pd(at_max, at_min), moving);
+        const __m128d point = SelectSse2(at_max, bound_max, SelectSse2(at_min, bound_min, point2));
+        _mm_storeu_pd(dogs.pos_x + i, SelectSse2(_mm_and_pd(moving, horizontal), point, pos_x));
+        _mm_storeu_pd(dogs.pos_y + i, SelectSse2(_mm_andnot_pd(horizontal, moving), point, pos_y));
+        _mm_storeu_pd(dogs.speed_x + i, _mm_andnot_pd(stop, speed_x));
+        _mm_storeu_pd(dogs.speed_y + i, _mm_andnot_pd(stop, speed_y));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+size_t IntegrateAvx2(const DogArrays& dogs, double time_delta) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d delta = _mm256_set1_pd(time_delta);
+    size_t i = 0;
+    for (; i + 4 <= dogs.count; i += 4) {
+        const __m256d speed_x = _mm256_loadu_pd(dogs.speed_x + i);
+        const __m256d speed_y = _mm256_loadu_pd(dogs.speed_y + i);
+        const __m256d horizontal = _mm256_cmp_pd(speed_x, zero, _CMP_NEQ_UQ);
+        const __m256d moving = _mm256_or_pd(horizontal, _mm256_cmp_pd(speed_y, zero, _CMP_NEQ_UQ));
+        if (_mm256_movemask_pd(moving) == 0) {
+            continue;
+        }
+        const __m256d pos_x = _mm256_loadu_pd(dogs.pos_x + i);
+        const __m256d pos_y = _mm256_loadu_pd(dogs.pos_y + i);
+        const __m256d bound_min = _mm256_loadu_pd(dogs.bound_min + i);
+        const __m256d bound_max = _mm256_loadu_pd(dogs.bound_max + i);
+        const __m256d speed = _mm256_blendv_pd(speed_y, speed_x, horizontal);
+        const __m256d point1 = _mm256_blendv_pd(pos_y, pos_x, horizontal);
+        // Умножение и сложение раздельно (без FMA), как в скалярном коде
+        const __m256d point2 = _mm256_add_pd(point1, _mm256_mul_pd(speed, delta));
+        const __m256d forward = _mm256_cmp_pd(speed, zero, _CMP_GT_OQ);
+        const __m256d at_max = _mm256_and_pd(forward, _mm256_cmp_pd(point2, bound_max, _CMP_GE_OQ));
+        const __m256d at_min = _mm256_andnot_pd(forward, _mm256_cmp_pd(point2, bound_min, _CMP_LE_OQ));
+        const __m256d stop = _mm256_and_pd(_mm256_or_pd(at_max, at_min), moving);
+        const __m256d point = _mm256_blendv_pd(_mm256_blendv_pd(point2, bound_min, at_min), bound_max, at_max);
+        _mm256_storeu_pd(dogs.pos_x + i, _mm256_blendv_pd(pos_x, point, _mm256_and_pd(moving, horizontal)));
+        _mm256_storeu_pd(dogs.pos_y + i, _mm256_blendv_pd(pos_y, point, _mm256_andnot_pd(horizontal, moving)));
+        _mm256_storeu_pd(dogs.speed_x + i, _mm256_andnot_pd(stop, speed_x));
+        _mm256_storeu_pd(dogs.speed_y + i, _mm256_andnot_pd(stop, speed_y));
+    }
+    return i;
+}
+
+#endif // MOVEMENT_KERNEL_X86
+
+} // namespace
+
+bool IsSupported(Isa isa) noexcept {
+    switch (isa) {
+    case Isa::Scalar:
+        return true;
+#ifdef MOVEMENT_KERNEL_X86
+    case Isa::Sse2:
+        return __builtin_cpu_supports("sse2");
+    case Isa::Avx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+Isa GetBestIsa() noexcept {
+    static const Isa best = IsSupported(Isa::Avx2) ? Isa::Avx2
+                          : IsSupported(Isa::Sse2) ? Isa::Sse2
+                          : Isa::Scalar;
+    return best;
+}
+
+void Integrate(const DogArrays& dogs, double time_delta, Isa isa) {
+    size_t first = 0; // начало хвоста, который обрабатывается скалярно
+#ifdef MOVEMENT_KERNEL_X86
+    if (isa == Isa::Avx2) {
+        first = IntegrateAvx2(dogs, time_delta);
+    } else if (isa == Isa::Sse2) {
+        first = IntegrateSse2(dogs, time_delta);
+    }
+#endif
+    IntegrateScalar(dogs, first, time_delta);
+}
+
+} // namespace movement
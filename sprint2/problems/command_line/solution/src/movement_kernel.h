@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace movement {
+
+// Набор инструкций, которым выполняется пакетный шаг движения
+enum class Isa {Scalar, Sse2, Avx2};
+
+// Лучший набор инструкций, поддерживаемый процессором
+Isa GetBestIsa() noexcept;
+bool IsSupported(Isa isa) noexcept;
+
+// Собаки в виде структуры массивов
+struct DogArrays {
+    double* pos_x;
+    double* pos_y;
+    double* speed_x;
+    double* speed_y;
+    // Пределы, до которых собака может дойти вдоль оси своего движения
+    const double* bound_min;
+    const double* bound_max;
+    size_t count;
+};
+
+// Сдвигает движущихся собак на speed * time_delta вдоль направления движения.
+// Собака, дошедшая до своего предела, останавливается на нём.
+// Результат побитово совпадает для всех наборов инструкций
+void Integrate(const DogArrays& dogs, double time_delta, Isa isa = GetBestIsa());
+
+} // namespace movement
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <utility>
+
+namespace util {
+
+// Неблокирующая очередь "много писателей - один читатель".
+// Писатели добавляют элементы в стек Трайбера одной операцией CAS,
+// читатель забирает весь стек разом и обходит его в порядке добавления
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() = default;
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue() {
+        Drain([](T&&) {});
+    }
+
+    // Можно вызывать из любого потока
+    void Push(T value) {
+        Node* node = new Node{std::move(value), head_.load(std::memory_order_relaxed)};
+        while (!head_.compare_exchange_weak(node->next, node
+                                           , std::memory_order_release, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Извлекает все накопленные элементы и передает их в fn в порядке добавления.
+    // Вызывать может только один поток одновременно. Возвращает количество элементов.
+    // Если fn бросит исключение, оставшиеся извлечённые элементы удаляются
+    template <typename Fn>
+    size_t Drain(Fn&& fn) {
+        Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+        // Разворачиваем стек, чтобы обойти элементы в порядке их добавления
+        Node* reversed = nullptr;
+        while (node) {
+            Node* next = node->next;
+            node->next = reversed;
+            reversed = node;
+            node = next;
+        }
+        struct Cleanup {
+            Node*& rest;
+            ~Cleanup() {
+                while (rest) {
+                    delete std::exchange(rest, rest->next);
+                }
+            }
+        } cleanup{reversed};
+        size_t count = 0;
+        while (reversed) {
+            Node* next = reversed->next;
+            fn(std::move(reversed->value));
+            delete reversed;
+            reversed = next;
+            ++count;
+        }
+        return count;
+    }
+
+    bool Empty() const noexcept {
+        return head_.load(std::memory_order_relaxed) == nullptr;
+    }
+
+private:
+    struct Node {
+        T value;
+        Node* next;
+    };
+    std::atomic<Node*> head_{nullptr};
+};
+
+} // namespace util
@@ -0,0 +1,233 @@
+#include "query_string.h"
+
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+namespace query_string {
+
+namespace {
+
+int HexDigitValue(char ch) noexcept {
+    if (ch >= '0' && ch <= '9') {
+        return ch - '0';
+    }
+    if (ch >= 'a' && ch <= 'f') {
+        return ch - 'a' + 10;
+    }
+    if (ch >= 'A' && ch <= 'F') {
+        return ch - 'A' + 10;
+    }
+    return -1;
+}
+
+// Вызывает fn для каждого декодированного символа строки sv.
+// Возвращает false, если в строке есть некорректная %-последовательность или fn вернула false
+template <typename Fn>
+bool ForEachDecodedChar(std::string_view sv, Fn&& fn) {
+    for (size_t i = 0; i < sv.size(); ++i) {
+        char ch = sv[i];
+        if (ch == '+') {
+            ch = ' ';
+        } else if (ch == '%') {
+            if (i + 2 >= sv.size()) {
+                return false;
+            }
+            const int hi = HexDigitValue(sv[i + 1]);
+            const int lo = HexDigitValue(sv[i + 2]);
+            if (hi < 0 || lo < 0) {
+                return false;
+            }
+            ch = static_cast<char>(hi * 16 + lo);
+            i += 2;
+        }
+        if (!fn(ch)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+std::pair<std::string_view, std::string_view> SplitTarget(std::string_view target) {
+    const auto pos = target.find('?');
+    if (pos == std::string_view::npos) {
+        return {target, {}};
+    }
+    return {target.substr(0, pos), target.substr(pos + 1)};
+}
+
+Param::Param(std::string_view key, std::string_view raw_value) noexcept
+: key_(key)
+, raw_value_(raw_value) {
+}
+
+std::string_view Param::GetKey() const noexcept {
+    return key_;
+}
+
+bool Param::HasKey(std::string_view key) const noexcept {
+    size_t pos = 0;
+    const bool decoded = ForEachDecodedChar(key_, [&key, &pos](char ch) {
+        if (pos == key.size() || key[pos] != ch) {
+            return false;
+        }
+        ++pos;
+        return true;
+    });
+    return decoded && pos == key.size();
+}
+
+std::string_view Param::GetRawValue() const noexcept {
+    return raw_value_;
+}
+
+std::optional<std::string> Param::GetValue() const {
+    std::string res;
+    res.reserve(raw_value_.size());
+    if (!ForEachDecodedChar(raw_value_, [&res](char ch) { res.push_back(ch); return true; })) {
+        return std::nullopt;
+    }
+    return res;
+}
+
+std::optional<size_t> Param::GetValueAsSize() const noexcept {
+    constexpr size_t MAX_VALUE = std::numeric_limits<size_t>::max();
+    size_t res = 0;
+    bool has_digits = false;
+    const bool parsed = ForEachDecodedChar(raw_value_, [&res, &has_digits](char ch) {
+        if (ch < '0' || ch > '9') {
+            return false;
+        }
+        const size_t digit = static_cast<size_t>(ch - '0');
+        if (res > (MAX_VALUE - digit) / 10) {
+            return false; // переполнение
+        }
+        res = res * 10 + digit;
+        has_digits = true;
+        return true;
+    });
+    if (!parsed || !has_digits) {
+        return std::nullopt;
+    }
+    return res;
+}
+
+std::optional<double> Param::GetValueAsDouble() const noexcept {
+    double value = 0;
+    if (!GetValueAsDoubles({&value, 1})) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+bool Param::GetValueAsDoubles(std::span<double> values) const noexcept {
+    // Запись числа не длиннее нескольких десятков символов, декодируем её на стеке
+    constexpr size_t MAX_LENGTH = 256;
+    char buffer[MAX_LENGTH];
+    size_t length = 0;
+    const bool decoded = ForEachDecodedChar(raw_value_, [&buffer, &length](char ch) {
+        if (length == MAX_LENGTH) {
+            return false;
+        }
+        buffer[length++] = ch;
+        return true;
+    });
+    if (!decoded) {
+        return false;
+    }
+    const char* pos = buffer;
+    const char* const end = buffer + length;
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) {
+            if (pos == end || *pos != ',') {
+                return false;
+            }
+            ++pos;
+        }
+        const auto [next, error] = std::from_chars(pos, end, values[i]);
+        if (error != std::errc{} || !std::isfinite(values[i])) {
+            return false;
+        }
+        pos = next;
+    }
+    return pos == end;
+}
+
+Params::Iterator::Iterator(std::string_view rest) noexcept
+: rest_(rest)
+, at_end_(false) {
+    ParseNext();
+}
+
+Params::Iterator::reference Params::Iterator::operator*() const noexcept {
+    return current_;
+}
+
+Params::Iterator::pointer Params::Iterator::operator->() const noexcept {
+    return &current_;
+}
+
+Params::Iterator& Params::Iterator::operator++() noexcept {
+    ParseNext();
+    return *this;
+}
+
+Params::Iterator Params::Iterator::operator++(int) noexcept {
+    auto prev = *this;
+    ParseNext();
+    return prev;
+}
+
+bool Params::Iterator::operator==(const Iterator& other) const noexcept {
+    if (at_end_ || other.at_end_) {
+        return at_end_ == other.at_end_;
+    }
+    return rest_.data() == other.rest_.data() && current_.GetKey().data() == other.current_.GetKey().data();
+}
+
+void Params::Iterator::ParseNext() noexcept {
+    // Пропускаем пустые элементы вида "a=1&&b=2"
+    while (!rest_.empty() && rest_.front() == '&') {
+        rest_.remove_prefix(1);
+    }
+    if (rest_.empty()) {
+        at_end_ = true;
+        current_ = {};
+        return;
+    }
+    const auto amp_pos = rest_.find('&');
+    std::string_view item = rest_.substr(0, amp_pos);
+    rest_.remove_prefix(amp_pos == std::string_view::npos ? rest_.size() : amp_pos + 1);
+
+    const auto eq_pos = item.find('=');
+    if (eq_pos == std::string_view::npos) {
+        current_ = Param{item, {}};
+    } else {
+        current_ = Param{item.substr(0, eq_pos), item.substr(eq_pos + 1)};
+    }
+}
+
+Params::Params(std::string_view query) noexcept
+: query_(query) {
+}
+
+Params::Iterator Params::begin() const noexcept {
+    return Iterator{query_};
+}
+
+Params::Iterator Params::end() const noexcept {
+    return Iterator{};
+}
+
+std::optional<Param> Params::Find(std::string_view key) const noexcept {
+    for (const auto& param : *this) {
+        if (param.HasKey(key)) {
+            return param;
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace query_string
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace query_string {
+
+// Делит target запроса на путь и строку параметров (без символа '?')
+std::pair<std::string_view, std::string_view> SplitTarget(std::string_view target);
+
+// Параметр из строки запроса. Ключ и значение ссылаются на исходную строку,
+// процентное декодирование выполняется только при обращении к ним
+class Param {
+public:
+    Param() = default;
+    Param(std::string_view key, std::string_view raw_value) noexcept;
+    // Ключ в том виде, в котором он пришёл в запросе (без декодирования)
+    std::string_view GetKey() const noexcept;
+    // Декодированный ключ совпадает с key ("max%49tems" совпадает с "maxItems").
+    // Память не выделяется
+    bool HasKey(std::string_view key) const noexcept;
+    std::string_view GetRawValue() const noexcept;
+    // Декодированное значение. Пустой optional - если значение закодировано с ошибкой
+    std::optional<std::string> GetValue() const;
+    // Значение как неотрицательное целое число, без выделения памяти
+    std::optional<size_t> GetValueAsSize() const noexcept;
+    // Значение как конечное число, без выделения памяти
+    std::optional<double> GetValueAsDouble() const noexcept;
+    // Значение как values.size() конечных чисел через запятую, например "0,0,10,10"
+    bool GetValueAsDoubles(std::span<double> values) const noexcept;
+private:
+    std::string_view key_;
+    std::string_view raw_value_;
+};
+
+// Последовательность параметров вида "key1=value1&key2=value2".
+// Разбор выполняется по ходу обхода, память не выделяется
+class Params {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Param;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Param*;
+        using reference = const Param&;
+
+        Iterator() = default;
+        explicit Iterator(std::string_view rest) noexcept;
+        reference operator*() const noexcept;
+        pointer operator->() const noexcept;
+        Iterator& operator++() noexcept;
+        Iterator operator++(int) noexcept;
+        bool operator==(const Iterator& other) const noexcept;
+    private:
+        std::string_view rest_;  // ещё не разобранная часть строки
+        Param current_;
+        bool at_end_ = true;
+
+        void ParseNext() noexcept;
+    };
+
+    explicit Params(std::string_view query) noexcept;
+    Iterator begin() const noexcept;
+    Iterator end() const noexcept;
+    // Первый параметр, декодированный ключ которого равен key
+    std::optional<Param> Find(std::string_view key) const noexcept;
+private:
+    std::string_view query_;
+};
+
+} // namespace query_string
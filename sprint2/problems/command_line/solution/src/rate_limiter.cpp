@@ -0,0 +1,85 @@
+#include "rate_limiter.h"
+
+#include <algorithm>
+
+namespace rate_limiter {
+
+bool Config::IsEnabled() const noexcept {
+    return rate > 0.0;
+}
+
+TokenBucket::TokenBucket(Config config) noexcept {
+    if (!config.IsEnabled()) {
+        return; // нулевой интервал означает, что ограничения нет
+    }
+    using Seconds = std::chrono::duration<double>;
+    emission_interval_ = std::chrono::duration_cast<Nanoseconds>(Seconds{1.0 / config.rate});
+    burst_tolerance_ = std::chrono::duration_cast<Nanoseconds>(
+        emission_interval_ * (std::max(config.burst, 1.0) - 1.0));
+}
+
+bool TokenBucket::TryConsume(Clock::time_point now) noexcept {
+    if (emission_interval_ == Nanoseconds::zero()) {
+        return true;
+    }
+    const auto now_ns = std::chrono::duration_cast<Nanoseconds>(now.time_since_epoch()).count();
+    auto arrival = theoretical_arrival_.load(std::memory_order_relaxed);
+    while (true) {
+        const auto start = std::max(arrival, now_ns);
+        if (start - now_ns > burst_tolerance_.count()) {
+            return false; // жетонов не осталось
+        }
+        if (theoretical_arrival_.compare_exchange_weak(arrival, start + emission_interval_.count()
+                                                      , std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+bool TokenBucket::IsFull(Clock::time_point now) const noexcept {
+    const auto now_ns = std::chrono::duration_cast<Nanoseconds>(now.time_since_epoch()).count();
+    return theoretical_arrival_.load(std::memory_order_relaxed) <= now_ns;
+}
+
+void TokenBucket::Reset() noexcept {
+    theoretical_arrival_.store(0, std::memory_order_relaxed);
+}
+
+IpRateLimiter::IpRateLimiter(Config config, size_t capacity)
+: config_(config)
+, capacity_(std::max<size_t>(capacity, 1)) {
+    index_.reserve(std::min(capacity_, MAX_TRACKED_ADDRESSES));
+}
+
+bool IpRateLimiter::TryConsume(std::string_view ip, Clock::time_point now) {
+    if (!config_.IsEnabled()) {
+        return true;
+    }
+    std::lock_guard lock{mutex_};
+    return Touch(ip).bucket.TryConsume(now);
+}
+
+size_t IpRateLimiter::GetTrackedCount() const {
+    std::lock_guard lock{mutex_};
+    return entries_.size();
+}
+
+IpRateLimiter::Entry& IpRateLimiter::Touch(std::string_view ip) {
+    if (const auto it = index_.find(ip); it != index_.end()) {
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return entries_.front();
+    }
+    if (entries_.size() < capacity_) {
+        entries_.emplace_front(ip, config_);
+    } else {
+        // Лимит исчерпан: забираем ведро самого давнего адреса вместе с узлом списка
+        entries_.splice(entries_.begin(), entries_, std::prev(entries_.end()));
+        index_.erase(entries_.front().ip);
+        entries_.front().ip = ip;
+        entries_.front().bucket.Reset();
+    }
+    index_.emplace(entries_.front().ip, entries_.begin());
+    return entries_.front();
+}
+
+} // namespace rate_limiter
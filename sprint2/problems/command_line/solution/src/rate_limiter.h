@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace rate_limiter {
+
+using Clock = std::chrono::steady_clock;
+
+// Параметры "ведра с жетонами"
+struct Config {
+    double rate = 0.0;  // скорость пополнения ведра, запросов в секунду (0 - ограничения нет)
+    double burst = 1.0; // емкость ведра - сколько запросов можно сделать подряд
+    bool IsEnabled() const noexcept;
+};
+
+// Ведро с жетонами, реализованное по алгоритму GCRA: всё состояние - одно атомарное
+// "теоретическое время прихода" следующего запроса, поэтому ведро можно хранить
+// прямо в записи игрока и проверять из любого потока без блокировок
+class TokenBucket {
+public:
+    explicit TokenBucket(Config config) noexcept;
+    TokenBucket(const TokenBucket&) = delete;
+    TokenBucket& operator=(const TokenBucket&) = delete;
+
+    // Забирает жетон из ведра. Возвращает false, если ведро пусто
+    bool TryConsume(Clock::time_point now) noexcept;
+    // Ведро полностью наполнено (клиент давно не присылал запросов)
+    bool IsFull(Clock::time_point now) const noexcept;
+    // Наполняет ведро, как будто запросов ещё не было
+    void Reset() noexcept;
+private:
+    using Nanoseconds = std::chrono::nanoseconds;
+    Nanoseconds emission_interval_{};  // время пополнения одного жетона
+    Nanoseconds burst_tolerance_{};    // на сколько запросы могут опережать равномерный поток
+    std::atomic<Nanoseconds::rep> theoretical_arrival_{};
+};
+
+// Набор ведер для ограничения частоты запросов с одного IP-адреса. Число ведер
+// ограничено: для нового адреса сверх лимита переиспользуется ведро адреса,
+// дольше всех не присылавшего запросов, так что каждый запрос стоит O(1)
+class IpRateLimiter {
+public:
+    static constexpr size_t MAX_TRACKED_ADDRESSES = 1u << 16;
+
+    explicit IpRateLimiter(Config config, size_t capacity = MAX_TRACKED_ADDRESSES);
+    IpRateLimiter(const IpRateLimiter&) = delete;
+    IpRateLimiter& operator=(const IpRateLimiter&) = delete;
+
+    bool TryConsume(std::string_view ip, Clock::time_point now);
+    size_t GetTrackedCount() const;
+private:
+    struct Entry {
+        Entry(std::string_view ip, Config config)
+            : ip(ip)
+            , bucket(config) {
+        }
+        std::string ip;
+        TokenBucket bucket;
+    };
+    // В начале списка - адреса, от которых запросы приходили последними
+    using Entries = std::list<Entry>;
+
+    Config config_;
+    size_t capacity_;
+    mutable std::mutex mutex_;
+    Entries entries_;
+    // Ключи ссылаются на строки в entries_
+    std::unordered_map<std::string_view, Entries::iterator> index_;
+
+    Entry& Touch(std::string_view ip);
+};
+
+} // namespace rate_limiter
@@ -0,0 +1,47 @@
+#include "request_arena.h"
+
+#include <memory>
+
+namespace util {
+
+namespace {
+
+struct ThreadBlock {
+    std::unique_ptr<std::byte[]> data;
+    bool in_use = false;
+};
+
+thread_local ThreadBlock thread_block;
+
+bool TryAcquireThreadBlock() {
+    if (thread_block.in_use) {
+        return false;
+    }
+    if (!thread_block.data) {
+        thread_block.data = std::make_unique<std::byte[]>(RequestArena::BLOCK_SIZE);
+    }
+    thread_block.in_use = true;
+    return true;
+}
+
+} // namespace
+
+RequestArena::RequestArena()
+: owns_thread_block_(TryAcquireThreadBlock())
+, resource_(owns_thread_block_
+    ? std::pmr::monotonic_buffer_resource{thread_block.data.get(), BLOCK_SIZE, std::pmr::new_delete_resource()}
+    : std::pmr::monotonic_buffer_resource{std::pmr::new_delete_resource()}) {
+}
+
+RequestArena::~RequestArena() {
+    resource_.release();
+    if (owns_thread_block_) {
+        thread_block.in_use = false;
+    }
+}
+
+std::pmr::memory_resource* RequestArena::GetResource() noexcept {
+    return &resource_;
+}
+
+} // namespace util
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+
+namespace util {
+
+// Арена для временных данных одного запроса. Память выделяется из блока,
+// закрепленного за потоком, и освобождается целиком при разрушении арены.
+// Блок выделяется один раз на поток и переиспользуется всеми его запросами
+class RequestArena {
+public:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    RequestArena();
+    ~RequestArena();
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    std::pmr::memory_resource* GetResource() noexcept;
+private:
+    // Блок потока занят этой ареной (вложенная арена работает без блока потока)
+    bool owns_thread_block_;
+    std::pmr::monotonic_buffer_resource resource_;
+};
+
+} // namespace util
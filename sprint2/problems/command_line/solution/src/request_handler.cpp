@@ -1,7 +1,10 @@
 #include "request_handler.h"
 #include "json_loader.h"
 #include "boost_json.h"
+#include "query_string.h"
+#include "request_arena.h"
 #include <boost/beast.hpp>
+#include <algorithm>
 #include <filesystem>
 #include <string_view>
 #include <unordered_map>
@@ -68,6 +71,57 @@ StringResponse MakeStringResponse(http::status status, std::string_view body, un
     return response;
 }
 
+SharedResponse MakeSharedResponse(http::status status, std::shared_ptr<const std::string> body, unsigned http_version,
+                                  bool keep_alive, http::verb method,
+                                  std::string_view content_type) {
+    SharedResponse response(status, http_version);
+    response.set(http::field::content_type, content_type);
+    response.set(http::field::cache_control, "no-cache"s);
+    response.content_length(body->size());
+    if (method != http::verb::head) {
+        response.body() = std::move(body);
+    }
+    response.keep_alive(keep_alive);
+    return response;
+}
+
+MapBodies::MapBodies(app::Application& app)
+: app_(app){
+    const auto maps = app.ListMaps();
+    list_ = std::make_shared<const std::string>(boost_json::GetMapsJson(maps));
+    maps_.resize(maps.size());
+    for (size_t i = 0; i < maps.size(); ++i) {
+        map_index_.emplace(maps[i].id, i);
+        // Отложенные карты не строим ради их тел
+        if (app.IsMapLoaded(maps[i].id)) {
+            maps_[i] = Render(maps[i].id);
+        }
+    }
+}
+
+std::shared_ptr<const std::string> MapBodies::GetList() const noexcept {
+    return list_;
+}
+
+std::shared_ptr<const std::string> MapBodies::GetMap(std::string_view id) const {
+    const auto it = map_index_.find(id);
+    if (it == map_index_.end()) {
+        return nullptr;
+    }
+    auto& slot = maps_[it->second];
+    auto body = std::atomic_load(&slot);
+    if (!body) {
+        // Одновременные первые запросы могут построить тело дважды, оба тела одинаковы
+        body = Render(id);
+        std::atomic_store(&slot, body);
+    }
+    return body;
+}
+
+std::shared_ptr<const std::string> MapBodies::Render(std::string_view id) const {
+    return std::make_shared<const std::string>(boost_json::GetMapJson(app_.GetMapInfo(id)));
+}
+
 StringResponse ErrorResponseJson(http::status status, std::string_view code, std::string_view message
                                  , const StringRequest& req){
     auto body = boost_json::GetErrorMes(code, message);
@@ -82,8 +136,8 @@ StringResponse ErrorResponseJson(http::status status, const StringRequest& req){
     }
 }
 
-std::vector<std::string_view> SplitQueryLine(std::string_view sv, char ch){
-    std::vector<std::string_view> res{};
+std::pmr::vector<std::string_view> SplitQueryLine(std::string_view sv, char ch, std::pmr::memory_resource* mr){
+    std::pmr::vector<std::string_view> res{mr};
     for(auto pos = sv.find(ch, 0); pos != std::string::npos; pos = sv.find(ch, 0))
     {
         res.push_back(sv.substr(0, pos));
@@ -150,31 +204,76 @@ fs::path GetAbsolutePath(const fs::path& static_content_path, const StringReques
     return fs::weakly_canonical(static_content_path / rel_path);
 }
 
-ApiHandler::ApiHandler(app::Application& app, const bool is_test_tick_mode)
+ApiHandler::ApiHandler(app::Application& app, const bool is_test_tick_mode, rate_limiter::Config ip_rate_limit)
 : app_(app)
-, is_test_tick_mode_(is_test_tick_mode){
+, map_bodies_(app)
+, is_test_tick_mode_(is_test_tick_mode)
+, ip_rate_limiter_(ip_rate_limit){
 }
 
-std::vector<std::string> GetQueryWords(const StringRequest& req){
-    auto target = req.target();
-    std::string query(target.substr(1).data(), target.size()-1);
-    // Разбираем запрос по словам
-    auto query_words = SplitQueryLine(query, '/');  
-    return std::vector<std::string>(query_words.begin(), query_words.end());
+// Слова пути запроса ссылаются на target запроса, строка параметров после '?' отбрасывается
+std::pmr::vector<std::string_view> GetQueryWords(const StringRequest& req, std::pmr::memory_resource* mr){
+    auto [path, query] = query_string::SplitTarget(req.target());
+    // Разбираем путь по словам
+    return SplitQueryLine(path.substr(1), '/', mr);  
 }
 
-bool CheckWord(const std::vector<std::string>& query_words, const size_t index, const std::string_view word){
+bool CheckWord(const std::pmr::vector<std::string_view>& query_words, const size_t index, const std::string_view word){
     return query_words.size() > index && query_words[index] == word;
 }
 
-bool CheckEndWord(const std::vector<std::string>& query_words, const size_t index, const std::string_view word){
+bool CheckEndWord(const std::pmr::vector<std::string_view>& query_words, const size_t index, const std::string_view word){
     return query_words.size() == index+1 && query_words[index] == word;
 }
 
-TypeApiRequest ApiHandler::GetTypeApiRequest(const std::vector<std::string>& query_words){
+// Читает из строки запроса параметры постраничного вывода ?start=&maxItems=
+// Пустой optional - если значения параметров некорректны
+std::optional<app::Page> GetPageParam(const StringRequest& req){
+    auto [path, query] = query_string::SplitTarget(req.target());
+    app::Page page;
+    for (const auto& param : query_string::Params{query}) {
+        if (param.HasKey("start"sv)) {
+            auto start = param.GetValueAsSize();
+            if (!start) {
+                return std::nullopt;
+            }
+            page.start = *start;
+        } else if (param.HasKey("maxItems"sv)) {
+            page.max_items = param.GetValueAsSize();
+            if (!page.max_items) {
+                return std::nullopt;
+            }
+        }
+    }
+    return page;
+}
+
+// Область интереса из параметров ?radius=&bbox=x0,y0,x1,y1
+std::optional<app::game_state::View> GetViewParam(const StringRequest& req){
+    auto [path, query] = query_string::SplitTarget(req.target());
+    app::game_state::View view;
+    for (const auto& param : query_string::Params{query}) {
+        if (param.HasKey("radius"sv)) {
+            view.radius = param.GetValueAsDouble();
+            if (!view.radius || *view.radius < 0) {
+                return std::nullopt;
+            }
+        } else if (param.HasKey("bbox"sv)) {
+            double coords[4];
+            if (!param.GetValueAsDoubles(coords)) {
+                return std::nullopt;
+            }
+            view.area = model::Area{std::min(coords[0], coords[2]), std::min(coords[1], coords[3])
+                                    , std::max(coords[0], coords[2]), std::max(coords[1], coords[3])};
+        }
+    }
+    return view;
+}
+
+TypeApiRequest ApiHandler::GetTypeApiRequest(const std::pmr::vector<std::string_view>& query_words) const {
     if (query_words.size()>2 && query_words[0] == "api"sv && query_words[1] == "v1"sv) {
         // query_words.resize(query_words.size()+1); // чтобы не проверять размер вектора на каждом элементе 
-        if (query_words[2] == "maps"s){  //если запрос по картам
+        if (query_words[2] == "maps"sv){  //если запрос по картам
             if (query_words.size() == 4) {
                 return TypeApiRequest::GetMapInfo;
             } else {
@@ -189,6 +288,8 @@ TypeApiRequest ApiHandler::GetTypeApiRequest(const std::vector<std::string>& que
                 return TypeApiRequest::GameState;
             } else if (CheckWord(query_words, 3, "player"sv) && CheckEndWord(query_words, 4, "action"sv) ) {
                 return TypeApiRequest::MovePlayers;
+            } else if (CheckWord(query_words, 3, "player"sv) && CheckEndWord(query_words, 4, "leave"sv) ) {
+                return TypeApiRequest::LeavePlayer;
             } else if (CheckEndWord(query_words, 3, "tick"sv)) {
                 return TypeApiRequest::GameTick;
             };
@@ -222,7 +323,8 @@ std::optional<StringResponse> ApiHandler::CheckPlayerToken(const StringRequest&
         return ErrorResponseJson(http::status::unauthorized, "invalidToken","Authorization header is missing", req);
     }
 
-    std::string token = std::string(req.at(http::field::authorization).substr(7));
+    // Токен ищется по ссылке на заголовок, без копии
+    const std::string_view token = req.at(http::field::authorization).substr(7);
     auto player = app_.FindPlayer(token);
 
     if(!player){
@@ -245,23 +347,35 @@ std::optional<StringResponse>  ApiHandler::CheckRequest(const StringRequest& req
     return {};                                     
 }
 
-StringResponse ApiHandler::ListMaps(const StringRequest& req) const{
-    ResponseParam res;
-    res.body = boost_json::GetMapsJson(app_.ListMaps());
-    return MakeStringResponse(res.status, res.body
+std::optional<StringResponse> ApiHandler::CheckRateLimit(const StringRequest& req, std::string_view end_point){
+    const auto now = rate_limiter::Clock::now();
+    bool allowed = ip_rate_limiter_.TryConsume(end_point, now);
+    if (allowed && req.count(http::field::authorization) != 0 && req.at(http::field::authorization).size() == 39) {
+        allowed = app_.TryConsumePlayerRequest(req.at(http::field::authorization).substr(7), now);
+    }
+    if (allowed) {
+        return {};
+    }
+    return ErrorResponseJson(http::status::too_many_requests, "tooManyRequests"sv, "Request rate limit exceeded"sv, req);
+}
+
+bool ApiHandler::CanHandleOutsideStrand(const StringRequest& req) const {
+    util::RequestArena arena;
+    auto it = CHECK_LIST_REQUEST.find(GetTypeApiRequest(GetQueryWords(req, arena.GetResource())));
+    return it != CHECK_LIST_REQUEST.end() && it->second.executor == Executor::IoThread;
+}
+
+ApiResponse ApiHandler::ListMaps(const StringRequest& req) const{
+    return MakeSharedResponse(http::status::ok, map_bodies_.GetList()
         , req.version(), req.keep_alive(), req.method(), ContentType::APP_JSON);
 }
 
-StringResponse ApiHandler::GetMapInfo(std::string_view map_name, const StringRequest& req) const{
-    ResponseParam res;
-    try {
-        res.body = boost_json::GetMapJson(app_.GetMapInfo(map_name));
-    } catch (const app::map_info::Error&) {
-        res.body = boost_json::GetErrorMes("mapNotFound", "Map not found");
-        res.status = http::status::not_found;
+ApiResponse ApiHandler::GetMapInfo(std::string_view map_name, const StringRequest& req) const{
+    if (auto body = map_bodies_.GetMap(map_name)) {
+        return MakeSharedResponse(http::status::ok, std::move(body)
+            , req.version(), req.keep_alive(), req.method(), ContentType::APP_JSON);
     }
-
-    return MakeStringResponse(res.status, res.body
+    return MakeStringResponse(http::status::not_found, boost_json::GetErrorMes("mapNotFound", "Map not found")
         , req.version(), req.keep_alive(), req.method(), ContentType::APP_JSON);
 }
 
@@ -288,18 +402,40 @@ StringResponse ApiHandler::RequestAddPlayer(const StringRequest& req) {
         , req.version(), req.keep_alive(), req.method(), ContentType::APP_JSON);
 }
 
-StringResponse ApiHandler::RequestPlayersListForUser(const StringRequest& req) {
-    // Получаем список всех собак в сессии этого игрока
-    std::string token = std::string(req.at(http::field::authorization).substr(7));
-    auto body = boost_json::GetPlayersJsonBody(app_.GetPlayersListForUser(token));
+StringResponse ApiHandler::RequestPlayersListForUser(const StringRequest& req, std::pmr::memory_resource* mr) {
+    auto page = GetPageParam(req);
+    if (!page) {
+        return ErrorResponseJson(http::status::bad_request, "invalidArgument","Invalid pagination parameters", req);
+    }
+    // Получаем список собак в сессии этого игрока
+    std::string_view token = req.at(http::field::authorization).substr(7);
+    std::pmr::string body(mr);
+    try {
+        body = boost_json::GetPlayersJsonBody(app_.GetPlayersListForUser(token, *page, mr), mr);
+    } catch (const std::invalid_argument&) { // игрок вышел из игры после проверки токена
+        return ErrorResponseJson(http::status::unauthorized, "unknownToken","Player token has not been found", req);
+    }
     
     return MakeStringResponse(http::status::ok, body
         , req.version(), req.keep_alive(), req.method(), ContentType::APP_JSON);
 }
 
-StringResponse ApiHandler::GetGameStateForUser(const StringRequest& req){
-    std::string token = std::string(req.at(http::field::authorization).substr(7));
-    auto body = boost_json::GetGameSateJsonBody(app_.GetGameSate(token));
+StringResponse ApiHandler::GetGameStateForUser(const StringRequest& req, std::pmr::memory_resource* mr){
+    auto page = GetPageParam(req);
+    if (!page) {
+        return ErrorResponseJson(http::status::bad_request, "invalidArgument","Invalid pagination parameters", req);
+    }
+    auto view = GetViewParam(req);
+    if (!view) {
+        return ErrorResponseJson(http::status::bad_request, "invalidArgument","Invalid view parameters", req);
+    }
+    std::string_view token = req.at(http::field::authorization).substr(7);
+    std::pmr::string body(mr);
+    try {
+        body = boost_json::GetGameSateJsonBody(app_.GetGameSate(token, *page, mr, *view), mr);
+    } catch (const std::invalid_argument&) { // игрок вышел из игры после проверки токена
+        return ErrorResponseJson(http::status::unauthorized, "unknownToken","Player token has not been found", req);
+    }
 
     return MakeStringResponse(http::status::ok, body
     , req.version(), req.keep_alive(), req.method(), ContentType::APP_JSON);
@@ -324,6 +460,15 @@ StringResponse ApiHandler::RequestMovePlayers(const StringRequest& req){
         , req.version(), req.keep_alive(), req.method(), ContentType::APP_JSON);
 }
 
+StringResponse ApiHandler::RequestLeavePlayer(const StringRequest& req){
+    std::string_view token = req.at(http::field::authorization).substr(7);
+    if (!app_.RemovePlayer(token)) {
+        return ErrorResponseJson(http::status::unauthorized, "unknownToken","Player token has not been found", req);
+    }
+    return MakeStringResponse(http::status::ok, boost_json::SerializeEmptyJsonObject()
+        , req.version(), req.keep_alive(), req.method(), ContentType::APP_JSON);
+}
+
 StringResponse ApiHandler::RequestGameTick(const StringRequest& req){
     int time_delta;
     try{
@@ -344,8 +489,11 @@ StringResponse ApiHandler::RequestGameTick(const StringRequest& req){
 }
 
 
-StringResponse ApiHandler::HandleApiRequest(const StringRequest& req) {
-    std::vector<std::string> query_words = GetQueryWords(req);
+ApiResponse ApiHandler::HandleApiRequest(const StringRequest& req) {
+    // Все временные данные запроса размещаются в арене и освобождаются разом по его завершении.
+    // Из арены в кучу копируется только тело ответа
+    util::RequestArena arena;
+    auto query_words = GetQueryWords(req, arena.GetResource());
     // Определяем тип запроса
     auto type_req = GetTypeApiRequest(query_words);
     // Выполняем проверки корректности запроса
@@ -362,11 +510,13 @@ StringResponse ApiHandler::HandleApiRequest(const StringRequest& req) {
     case TypeApiRequest::AddPlayer:
         return RequestAddPlayer(req);
     case TypeApiRequest::GetListOfPlayersForUser:
-        return RequestPlayersListForUser(req);
+        return RequestPlayersListForUser(req, arena.GetResource());
     case TypeApiRequest::GameState:
-        return GetGameStateForUser(req);
+        return GetGameStateForUser(req, arena.GetResource());
     case TypeApiRequest::MovePlayers:
         return RequestMovePlayers(req);
+    case TypeApiRequest::LeavePlayer:
+        return RequestLeavePlayer(req);
     case TypeApiRequest::GameTick:
         if (is_test_tick_mode_){
             return RequestGameTick(req);
@@ -407,13 +557,14 @@ ResponseValue RequestHandler::HandleFileRequest(const StringRequest& req){
     return res;
 }
 
-RequestHandler::RequestHandler(app::Application& app, std::filesystem::path path_static_content, Strand api_strand, const bool is_test_tick_mode)
+RequestHandler::RequestHandler(app::Application& app, std::filesystem::path path_static_content, Strand api_strand
+                               , const bool is_test_tick_mode, rate_limiter::Config ip_rate_limit)
 : static_content_path_{std::move(path_static_content)}
 , api_strand_{api_strand}
-, api_handler_{app, is_test_tick_mode}{
+, api_handler_{app, is_test_tick_mode, ip_rate_limit}{
 }
 
-StringResponse RequestHandler::HandleApiRequest(const StringRequest& req) {
+ApiResponse RequestHandler::HandleApiRequest(const StringRequest& req) {
     return api_handler_.HandleApiRequest(req);
 }    
 
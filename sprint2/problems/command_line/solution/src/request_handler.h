@@ -2,9 +2,14 @@
 #include "http_server.h"
 // #include "model.h"
 #include "application.h"
+#include "rate_limiter.h"
+#include "shared_body.h"
 #include <filesystem>
+#include <functional>
+#include <unordered_map>
 #include <variant>
 #include <boost/asio/strand.hpp>
+#include <memory_resource>
 #include <optional>
 
 namespace http_handler {
@@ -22,14 +27,22 @@ using StringResponse = http::response<http::string_body>;
 // Ответ, тело которого представлено в виде файла
 using FileResponse = http::response<http::file_body>;
 using ResponseValue = std::variant<StringResponse, FileResponse>;
+// Ответ с заранее подготовленным общим телом
+using SharedResponse = http::response<SharedBody>;
+using ApiResponse = std::variant<StringResponse, SharedResponse>;
 
 
 enum class WaitingMethod {GET_HEAD,POST};
 enum class CheckToken {No, Yes};
+// Где выполняется запрос: в strand вместе с запросами, меняющими состояние игры,
+// или сразу в потоке ввода-вывода (чтение данных, неизменных после загрузки игры,
+// чтение опубликованных снимков сессий и постановка команд игроков в очередь сессии)
+enum class Executor {ApiStrand, IoThread};
 
 struct ChekParam {
     WaitingMethod wiating_method; 
     CheckToken check_token;
+    Executor executor = Executor::ApiStrand;
 };
 
 struct ContentType {
@@ -48,16 +61,18 @@ enum class TypeApiRequest {
     , GetListOfPlayersForUser
     , GameState
     , MovePlayers
+    , LeavePlayer
     , GameTick
 };
 
 const std::unordered_map<TypeApiRequest, ChekParam> CHECK_LIST_REQUEST{
-    {TypeApiRequest::ListMaps,           {WaitingMethod::GET_HEAD, CheckToken::No}}
-    , {TypeApiRequest::GetMapInfo,              {WaitingMethod::GET_HEAD, CheckToken::No}}
+    {TypeApiRequest::ListMaps,           {WaitingMethod::GET_HEAD, CheckToken::No, Executor::IoThread}}
+    , {TypeApiRequest::GetMapInfo,              {WaitingMethod::GET_HEAD, CheckToken::No, Executor::IoThread}}
     , {TypeApiRequest::AddPlayer,               {WaitingMethod::POST,     CheckToken::No}}
-    , {TypeApiRequest::GetListOfPlayersForUser, {WaitingMethod::GET_HEAD, CheckToken::Yes}}
-    , {TypeApiRequest::GameState, {WaitingMethod::GET_HEAD, CheckToken::Yes}}
-    , {TypeApiRequest::MovePlayers, {WaitingMethod::POST, CheckToken::Yes}}
+    , {TypeApiRequest::GetListOfPlayersForUser, {WaitingMethod::GET_HEAD, CheckToken::Yes, Executor::IoThread}}
+    , {TypeApiRequest::GameState, {WaitingMethod::GET_HEAD, CheckToken::Yes, Executor::IoThread}}
+    , {TypeApiRequest::MovePlayers, {WaitingMethod::POST, CheckToken::Yes, Executor::IoThread}}
+    , {TypeApiRequest::LeavePlayer, {WaitingMethod::POST, CheckToken::Yes}}
     , {TypeApiRequest::GameTick, {WaitingMethod::POST, CheckToken::No}}
 };
 
@@ -72,46 +87,91 @@ StringResponse MakeStringResponse(http::status status, std::string_view body, un
     std::string_view content_type = ContentType::APP_JSON,
     std::string_view allow = ""sv);
 
+// Создаёт SharedResponse, тело которого не копируется
+SharedResponse MakeSharedResponse(http::status status, std::shared_ptr<const std::string> body, unsigned http_version,
+    bool keep_alive, http::verb method,
+    std::string_view content_type = ContentType::APP_JSON);
+
+// Тела ответов со списком карт и с отдельными картами. Список и уже построенные карты
+// сериализуются при создании, отложенные карты - при первом запросе к ним.
+// Дальше тела только читаются, их можно получать из любого потока
+class MapBodies {
+public:
+    explicit MapBodies(app::Application& app);
+    std::shared_ptr<const std::string> GetList() const noexcept;
+    // Тело карты или nullptr, если карты с таким id нет
+    std::shared_ptr<const std::string> GetMap(std::string_view id) const;
+private:
+    struct StringHasher {
+        using is_transparent = void;
+        size_t operator()(std::string_view str) const noexcept {
+            return std::hash<std::string_view>{}(str);
+        }
+    };
+    app::Application& app_;
+    std::shared_ptr<const std::string> list_;
+    std::unordered_map<std::string, size_t, StringHasher, std::equal_to<>> map_index_;
+    // Тела карт по номеру в каталоге, читаются и заменяются через std::atomic_load/std::atomic_store
+    mutable std::vector<std::shared_ptr<const std::string>> maps_;
+
+    std::shared_ptr<const std::string> Render(std::string_view id) const;
+};
+
 class ApiHandler {
 public:
-    explicit ApiHandler(app::Application& app, const bool is_test_tick_mode);
-    StringResponse HandleApiRequest(const StringRequest& req);    
-    StringResponse ListMaps(const StringRequest& req) const ;
-    StringResponse GetMapInfo(std::string_view map_name, const StringRequest& req) const;
+    explicit ApiHandler(app::Application& app, const bool is_test_tick_mode, rate_limiter::Config ip_rate_limit);
+    ApiResponse HandleApiRequest(const StringRequest& req);    
+    // Проверка частоты запросов по IP-адресу и токену игрока. Вызывается в потоке
+    // ввода-вывода, чтобы лишние запросы не попадали в очередь strand
+    std::optional<StringResponse> CheckRateLimit(const StringRequest& req, std::string_view end_point);
+    // Запрос можно выполнить в потоке ввода-вывода, минуя strand
+    bool CanHandleOutsideStrand(const StringRequest& req) const;
+    ApiResponse ListMaps(const StringRequest& req) const ;
+    ApiResponse GetMapInfo(std::string_view map_name, const StringRequest& req) const;
     StringResponse RequestAddPlayer(const StringRequest& req);
-    StringResponse RequestPlayersListForUser(const StringRequest& req);
-    StringResponse GetGameStateForUser(const StringRequest& req);
+    StringResponse RequestPlayersListForUser(const StringRequest& req, std::pmr::memory_resource* mr);
+    StringResponse GetGameStateForUser(const StringRequest& req, std::pmr::memory_resource* mr);
     StringResponse RequestMovePlayers(const StringRequest& req);
+    StringResponse RequestLeavePlayer(const StringRequest& req);
     StringResponse RequestGameTick(const StringRequest& req);
 private:
     app::Application& app_;
-    TypeApiRequest GetTypeApiRequest(const std::vector<std::string>& query_words);
+    MapBodies map_bodies_;
+    TypeApiRequest GetTypeApiRequest(const std::pmr::vector<std::string_view>& query_words) const;
     std::optional<StringResponse> CheckMethodRequest(const StringRequest& req, WaitingMethod waiting_method);
     std::optional<StringResponse> CheckPlayerToken(const StringRequest& req);
     std::optional<StringResponse>  CheckRequest(const StringRequest& req, TypeApiRequest type_rec);
     const bool is_test_tick_mode_;
+    rate_limiter::IpRateLimiter ip_rate_limiter_;
 };
 
 class RequestHandler : public std::enable_shared_from_this<RequestHandler>{
 public:
     using Strand = net::strand<net::io_context::executor_type>;
-    explicit RequestHandler(app::Application& app, std::filesystem::path path_static_content, Strand api_strand, const bool is_test_tick_mode);
+    explicit RequestHandler(app::Application& app, std::filesystem::path path_static_content, Strand api_strand
+                            , const bool is_test_tick_mode, rate_limiter::Config ip_rate_limit);
     RequestHandler(const RequestHandler&) = delete;
     RequestHandler& operator=(const RequestHandler&) = delete;
 
     template <typename Body, typename Allocator, typename Send>
-    void operator()(http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
+    void operator()(std::string_view end_point, http::request<Body, http::basic_fields<Allocator>>&& req, Send&& send) {
         // Обработать запрос request и отправить ответ, используя send
         auto version = req.version();
         auto keep_alive = req.keep_alive();
         try {
             if(IsApiRequest(req)){
+                if (auto rejected = api_handler_.CheckRateLimit(req, end_point)) {
+                    return send(std::move(*rejected));
+                }
+                if (api_handler_.CanHandleOutsideStrand(req)) {
+                    return std::visit(send, HandleApiRequest(req));
+                }
                 auto handle = [self = shared_from_this(), send,
                                 req = std::forward<decltype(req)>(req), version, keep_alive] {
                     try {
                         // Этот assert не выстрелит, так как лямбда-функция будет выполняться внутри strand
                         assert(self->api_strand_.running_in_this_thread());
-                        return send(self->HandleApiRequest(req));
+                        return std::visit(send, self->HandleApiRequest(req));
                     } catch (...) {
                         send(self->ReportServerError(req));
                     }
@@ -134,7 +194,7 @@ private:
     std::filesystem::path static_content_path_;
     Strand api_strand_;
     ApiHandler api_handler_;
-    StringResponse HandleApiRequest(const StringRequest& req);    
+    ApiResponse HandleApiRequest(const StringRequest& req);    
     ResponseValue HandleFileRequest(const StringRequest& req);    
     bool IsApiRequest(const StringRequest& req);
     StringResponse ReportServerError(const StringRequest& req);
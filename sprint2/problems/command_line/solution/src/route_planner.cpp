@@ -0,0 +1,437 @@
+#include "route_planner.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+
+namespace routing {
+
+namespace {
+
+using NodeId = ContractionHierarchy::NodeId;
+using Distance = ContractionHierarchy::Distance;
+
+constexpr Distance INFINITE_DISTANCE = std::numeric_limits<Distance>::max();
+// Сколько вершин просматривает поиск обхода при построении. Если обход не найден
+// за это число шагов, добавляется лишнее сокращение - запросы остаются точными
+constexpr size_t WITNESS_SETTLE_LIMIT = 64;
+
+// Состояние поиска Дейкстры. Расстояния действительны только у вершин с меткой
+// текущего поиска, поэтому между поисками массивы не очищаются
+struct SearchSpace {
+    std::vector<Distance> distance;
+    std::vector<NodeId> parent;
+    std::vector<uint32_t> stamp;
+    uint32_t current = 0;
+    std::vector<std::pair<Distance, NodeId>> heap;
+
+    void Reset(size_t node_count) {
+        if (stamp.size() < node_count) {
+            distance.resize(node_count);
+            parent.resize(node_count);
+            stamp.resize(node_count, 0);
+        }
+        if (++current == 0) {
+            std::fill(stamp.begin(), stamp.end(), 0);
+            current = 1;
+        }
+        heap.clear();
+    }
+
+    bool IsReached(NodeId node) const noexcept {
+        return stamp[node] == current;
+    }
+
+    Distance Get(NodeId node) const noexcept {
+        return IsReached(node) ? distance[node] : INFINITE_DISTANCE;
+    }
+
+    void Relax(NodeId node, Distance length, NodeId from) {
+        if (length < Get(node)) {
+            stamp[node] = current;
+            distance[node] = length;
+            parent[node] = from;
+            heap.emplace_back(length, node);
+            std::push_heap(heap.begin(), heap.end(), std::greater<>{});
+        }
+    }
+
+    Distance Top() const noexcept {
+        return heap.empty() ? INFINITE_DISTANCE : heap.front().first;
+    }
+
+    // Извлекает ближайшую вершину. Устаревшие записи кучи пропускаются
+    std::optional<NodeId> Pop() {
+        while (!heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), std::greater<>{});
+            const auto [length, node] = heap.back();
+            heap.pop_back();
+            if (length == distance[node]) {
+                return node;
+            }
+        }
+        return std::nullopt;
+    }
+};
+
+// Деревья поиска запросов: у каждого потока свои
+SearchSpace& GetForwardSpace() {
+    thread_local SearchSpace space;
+    return space;
+}
+
+SearchSpace& GetBackwardSpace() {
+    thread_local SearchSpace space;
+    return space;
+}
+
+} // namespace
+
+ContractionHierarchy::ContractionHierarchy(const model::RoadNetwork& network) {
+    const auto node_count = network.GetNodeCount();
+    // Граф в процессе сжатия: рёбра и сокращения в обе стороны
+    std::vector<std::vector<Edge>> graph(node_count);
+    auto add_edge = [&graph](NodeId from, NodeId to, Distance length, NodeId middle) {
+        for (auto& edge : graph[from]) {
+            if (edge.to == to) {
+                if (length < edge.length) {
+                    edge.length = length;
+                    edge.middle = middle;
+                }
+                return;
+            }
+        }
+        graph[from].push_back({to, length, middle});
+    };
+    for (NodeId node = 0; node < node_count; ++node) {
+        for (const auto& edge : network.GetEdges(node)) {
+            add_edge(node, edge.to, edge.length, NO_NODE);
+        }
+    }
+
+    std::vector<bool> contracted(node_count, false);
+    std::vector<uint32_t> rank(node_count);
+    std::vector<int64_t> contracted_neighbours(node_count, 0);
+    SearchSpace witness;
+    struct Shortcut {
+        NodeId from, to;
+        Distance length;
+    };
+    std::vector<Shortcut> shortcuts;
+
+    // Сокращения, которые нужны при удалении вершины node: пути сосед - node - сосед,
+    // для которых нет обхода не длиннее. Возвращает приоритет вершины - чем он меньше,
+    // тем меньше граф растёт от её удаления
+    auto find_shortcuts = [&](NodeId node) -> int64_t {
+        shortcuts.clear();
+        const auto& edges = graph[node];
+        int64_t degree = 0;
+        for (size_t i = 0; i < edges.size(); ++i) {
+            const auto& in = edges[i];
+            if (contracted[in.to]) {
+                continue;
+            }
+            ++degree;
+            Distance max_length = -1;
+            for (size_t j = i + 1; j < edges.size(); ++j) {
+                if (!contracted[edges[j].to]) {
+                    max_length = std::max(max_length, in.length + edges[j].length);
+                }
+            }
+            if (max_length < 0) {
+                continue;
+            }
+            // Ищем обходы от соседа, не заходя в node и удалённые вершины
+            witness.Reset(node_count);
+            witness.Relax(in.to, 0, NO_NODE);
+            for (size_t settled = 0; settled < WITNESS_SETTLE_LIMIT && witness.Top() <= max_length; ++settled) {
+                const auto current = witness.Pop();
+                if (!current) {
+                    break;
+                }
+                for (const auto& edge : graph[*current]) {
+                    if (edge.to != node && !contracted[edge.to]) {
+                        witness.Relax(edge.to, witness.distance[*current] + edge.length, *current);
+                    }
+                }
+            }
+            for (size_t j = i + 1; j < edges.size(); ++j) {
+                const auto& out = edges[j];
+                if (!contracted[out.to] && witness.Get(out.to) > in.length + out.length) {
+                    shortcuts.push_back({in.to, out.to, in.length + out.length});
+                }
+            }
+        }
+        return static_cast<int64_t>(shortcuts.size()) - degree + contracted_neighbours[node];
+    };
+
+    using QueueItem = std::pair<int64_t, NodeId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+    for (NodeId node = 0; node < node_count; ++node) {
+        queue.emplace(find_shortcuts(node), node);
+    }
+    uint32_t next_rank = 0;
+    while (!queue.empty()) {
+        const auto node = queue.top().second;
+        queue.pop();
+        // Приоритеты соседей меняются после удаления вершин, поэтому
+        // пересчитываем приоритет перед удалением
+        const auto priority = find_shortcuts(node);
+        if (!queue.empty() && priority > queue.top().first) {
+            queue.emplace(priority, node);
+            continue;
+        }
+        for (const auto& shortcut : shortcuts) {
+            add_edge(shortcut.from, shortcut.to, shortcut.length, node);
+            add_edge(shortcut.to, shortcut.from, shortcut.length, node);
+        }
+        contracted[node] = true;
+        rank[node] = next_rank++;
+        for (const auto& edge : graph[node]) {
+            ++contracted_neighbours[edge.to];
+        }
+    }
+
+    // Для запросов оставляем только рёбра к вершинам, удалённым позже
+    up_offsets_.assign(node_count + 1, 0);
+    for (NodeId node = 0; node < node_count; ++node) {
+        for (const auto& edge : graph[node]) {
+            if (rank[edge.to] > rank[node]) {
+                up_edges_.push_back(edge);
+            }
+        }
+        up_offsets_[node + 1] = static_cast<uint32_t>(up_edges_.size());
+    }
+}
+
+size_t ContractionHierarchy::GetNodeCount() const noexcept {
+    return up_offsets_.empty() ? 0 : up_offsets_.size() - 1;
+}
+
+std::optional<ContractionHierarchy::Meeting> ContractionHierarchy::Search(NodeId from, NodeId to) const {
+    const auto node_count = GetNodeCount();
+    if (from >= node_count || to >= node_count) {
+        throw std::out_of_range("Unknown road network node");
+    }
+    auto& forward = GetForwardSpace();
+    auto& backward = GetBackwardSpace();
+    forward.Reset(node_count);
+    backward.Reset(node_count);
+    forward.Relax(from, 0, NO_NODE);
+    backward.Relax(to, 0, NO_NODE);
+
+    std::optional<Meeting> best;
+    auto best_distance = [&best] {
+        return best ? best->distance : INFINITE_DISTANCE;
+    };
+    // Поиски идут навстречу друг другу, пока ближайшая вершина хотя бы одного
+    // из них может улучшить найденный путь
+    while (forward.Top() < best_distance() || backward.Top() < best_distance()) {
+        const bool step_forward = forward.Top() <= backward.Top();
+        auto& space = step_forward ? forward : backward;
+        const auto& other = step_forward ? backward : forward;
+        const auto node = space.Pop();
+        if (!node) {
+            continue;
+        }
+        const auto distance = space.distance[*node];
+        if (other.IsReached(*node) && distance + other.distance[*node] < best_distance()) {
+            best = Meeting{*node, distance + other.distance[*node]};
+        }
+        // Если до вершины есть более короткий путь сверху, кратчайшие пути
+        // через неё продолжать не нужно (stall-on-demand)
+        const auto first = up_edges_.begin() + up_offsets_[*node];
+        const auto last = up_edges_.begin() + up_offsets_[*node + 1];
+        const bool stalled = std::any_of(first, last, [&space, distance](const Edge& edge) {
+            return space.Get(edge.to) < distance - edge.length;
+        });
+        if (stalled) {
+            continue;
+        }
+        for (auto edge = first; edge != last; ++edge) {
+            space.Relax(edge->to, distance + edge->length, *node);
+        }
+    }
+    return best;
+}
+
+std::optional<ContractionHierarchy::Distance> ContractionHierarchy::GetDistance(NodeId from, NodeId to) const {
+    if (const auto meeting = Search(from, to)) {
+        return meeting->distance;
+    }
+    return std::nullopt;
+}
+
+std::optional<ContractionHierarchy::NodeId> ContractionHierarchy::GetNextHop(NodeId from, NodeId to) const {
+    if (from == to) {
+        return std::nullopt;
+    }
+    const auto meeting = Search(from, to);
+    if (!meeting) {
+        return std::nullopt;
+    }
+    // Первое ребро иерархии на пути: из дерева прямого поиска, если встреча
+    // не в самой вершине from, иначе - из дерева обратного поиска
+    NodeId next = GetBackwardSpace().parent[from];
+    if (meeting->node != from) {
+        const auto& forward = GetForwardSpace();
+        next = meeting->node;
+        while (forward.parent[next] != from) {
+            next = forward.parent[next];
+        }
+    }
+    // Первое ребро дорожной сети внутри сокращения
+    for (auto middle = FindEdge(from, next).middle; middle != NO_NODE; middle = FindEdge(from, next).middle) {
+        next = middle;
+    }
+    return next;
+}
+
+std::vector<ContractionHierarchy::NodeId> ContractionHierarchy::GetPath(NodeId from, NodeId to) const {
+    const auto meeting = Search(from, to);
+    if (!meeting) {
+        return {};
+    }
+    // Вершины иерархии от from до встречи и от встречи до to
+    std::vector<NodeId> hierarchy_path;
+    for (auto node = meeting->node; node != NO_NODE; node = GetForwardSpace().parent[node]) {
+        hierarchy_path.push_back(node);
+    }
+    std::reverse(hierarchy_path.begin(), hierarchy_path.end());
+    for (auto node = GetBackwardSpace().parent[meeting->node]; node != NO_NODE; node = GetBackwardSpace().parent[node]) {
+        hierarchy_path.push_back(node);
+    }
+
+    std::vector<NodeId> path{from};
+    for (size_t i = 1; i < hierarchy_path.size(); ++i) {
+        Unpack(hierarchy_path[i - 1], hierarchy_path[i], path);
+    }
+    return path;
+}
+
+const ContractionHierarchy::Edge& ContractionHierarchy::FindEdge(NodeId a, NodeId b) const {
+    for (uint32_t i = up_offsets_[a]; i < up_offsets_[a + 1]; ++i) {
+        if (up_edges_[i].to == b) {
+            return up_edges_[i];
+        }
+    }
+    for (uint32_t i = up_offsets_[b]; i < up_offsets_[b + 1]; ++i) {
+        if (up_edges_[i].to == a) {
+            return up_edges_[i];
+        }
+    }
+    throw std::logic_error("Contraction hierarchy edge not found");
+}
+
+void ContractionHierarchy::Unpack(NodeId a, NodeId b, std::vector<NodeId>& path) const {
+    // Сокращение (a, b) через m раскрывается в (a, m) и (m, b)
+    std::vector<std::pair<NodeId, NodeId>> stack{{a, b}};
+    while (!stack.empty()) {
+        const auto [from, to] = stack.back();
+        stack.pop_back();
+        const auto middle = FindEdge(from, to).middle;
+        if (middle == NO_NODE) {
+            path.push_back(to);
+        } else {
+            stack.emplace_back(middle, to);
+            stack.emplace_back(from, middle);
+        }
+    }
+}
+
+DistanceTable::DistanceTable(const model::RoadNetwork& network)
+    : node_count_(network.GetNodeCount())
+    , distances_(node_count_ * node_count_, NO_PATH)
+    , next_hops_(node_count_ * node_count_, 0) {
+    SearchSpace space;
+    std::vector<NodeId> settled;
+    for (NodeId from = 0; from < node_count_; ++from) {
+        space.Reset(node_count_);
+        space.Relax(from, 0, from);
+        settled.clear();
+        while (const auto node = space.Pop()) {
+            settled.push_back(*node);
+            for (const auto& edge : network.GetEdges(*node)) {
+                space.Relax(edge.to, space.distance[*node] + edge.length, *node);
+            }
+        }
+        // Вершины выбираются из кучи по возрастанию расстояния, поэтому
+        // первая вершина пути до родителя уже известна
+        for (const auto node : settled) {
+            const auto parent = space.parent[node];
+            distances_[GetIndex(from, node)] = space.distance[node];
+            next_hops_[GetIndex(from, node)] = parent == from ? node : next_hops_[GetIndex(from, parent)];
+        }
+    }
+}
+
+size_t DistanceTable::GetNodeCount() const noexcept {
+    return node_count_;
+}
+
+size_t DistanceTable::GetIndex(NodeId from, NodeId to) const {
+    if (from >= node_count_ || to >= node_count_) {
+        throw std::out_of_range("Unknown road network node");
+    }
+    return size_t{from} * node_count_ + to;
+}
+
+std::optional<DistanceTable::Distance> DistanceTable::GetDistance(NodeId from, NodeId to) const {
+    const auto distance = distances_[GetIndex(from, to)];
+    if (distance == NO_PATH) {
+        return std::nullopt;
+    }
+    return distance;
+}
+
+std::optional<DistanceTable::NodeId> DistanceTable::GetNextHop(NodeId from, NodeId to) const {
+    const auto index = GetIndex(from, to);
+    if (from == to || distances_[index] == NO_PATH) {
+        return std::nullopt;
+    }
+    return next_hops_[index];
+}
+
+std::vector<DistanceTable::NodeId> DistanceTable::GetPath(NodeId from, NodeId to) const {
+    if (distances_[GetIndex(from, to)] == NO_PATH) {
+        return {};
+    }
+    std::vector<NodeId> path{from};
+    for (auto node = from; node != to; node = next_hops_[GetIndex(node, to)]) {
+        path.push_back(next_hops_[GetIndex(node, to)]);
+    }
+    return path;
+}
+
+RoutePlanner::RoutePlanner(const model::RoadNetwork& network, size_t table_max_nodes) {
+    if (network.GetNodeCount() <= table_max_nodes) {
+        router_.emplace<DistanceTable>(network);
+    } else {
+        router_.emplace<ContractionHierarchy>(network);
+    }
+}
+
+bool RoutePlanner::HasTable() const noexcept {
+    return std::holds_alternative<DistanceTable>(router_);
+}
+
+std::optional<RoutePlanner::Distance> RoutePlanner::GetDistance(NodeId from, NodeId to) const {
+    return std::visit([from, to](const auto& router) {
+        return router.GetDistance(from, to);
+    }, router_);
+}
+
+std::optional<RoutePlanner::NodeId> RoutePlanner::GetNextHop(NodeId from, NodeId to) const {
+    return std::visit([from, to](const auto& router) {
+        return router.GetNextHop(from, to);
+    }, router_);
+}
+
+std::vector<RoutePlanner::NodeId> RoutePlanner::GetPath(NodeId from, NodeId to) const {
+    return std::visit([from, to](const auto& router) {
+        return router.GetPath(from, to);
+    }, router_);
+}
+
+} // namespace routing
@@ -0,0 +1,107 @@
+#pragma once
+#include "model.h"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <variant>
+#include <vector>
+
+namespace routing {
+
+// Кратчайшие пути по дорожной сети карты на основе иерархии сжатия (contraction hierarchy).
+// При построении вершины по очереди удаляются из графа, а кратчайшие пути через них
+// заменяются рёбрами-сокращениями между соседями. Запрос - двунаправленный алгоритм
+// Дейкстры только по рёбрам к вершинам, удалённым позже, поэтому он просматривает
+// лишь малую часть графа
+class ContractionHierarchy {
+public:
+    using NodeId = model::RoadNetwork::NodeId;
+    using Distance = int64_t;
+
+    ContractionHierarchy() = default;
+    explicit ContractionHierarchy(const model::RoadNetwork& network);
+
+    size_t GetNodeCount() const noexcept;
+    // Длина кратчайшего пути или nullopt, если вершины не связаны
+    std::optional<Distance> GetDistance(NodeId from, NodeId to) const;
+    // Соседняя с from вершина дорожной сети на кратчайшем пути в to.
+    // nullopt, если from == to или вершины не связаны
+    std::optional<NodeId> GetNextHop(NodeId from, NodeId to) const;
+    // Вершины кратчайшего пути от from до to включительно, пусто, если пути нет
+    std::vector<NodeId> GetPath(NodeId from, NodeId to) const;
+
+private:
+    static constexpr NodeId NO_NODE = std::numeric_limits<NodeId>::max();
+    struct Edge {
+        NodeId to;
+        Distance length;
+        NodeId middle; // вершина, через которую проходит сокращение, или NO_NODE
+    };
+    // Результат запроса: вершина встречи прямого и обратного поиска
+    struct Meeting {
+        NodeId node;
+        Distance distance;
+    };
+
+    // Рёбра вершины v к вершинам, удалённым позже неё, лежат в
+    // up_edges_[up_offsets_[v], up_offsets_[v + 1])
+    std::vector<uint32_t> up_offsets_;
+    std::vector<Edge> up_edges_;
+
+    // Деревья поиска остаются в памяти потока до следующего запроса
+    std::optional<Meeting> Search(NodeId from, NodeId to) const;
+    // Ребро между вершинами a и b: оно хранится у вершины, удалённой раньше
+    const Edge& FindEdge(NodeId a, NodeId b) const;
+    // Добавляет в path вершины ребра (a, b) без a
+    void Unpack(NodeId a, NodeId b, std::vector<NodeId>& path) const;
+};
+
+// Кратчайшие пути между всеми парами вершин: ответ на запрос - чтение из таблицы.
+// Таблица строится запуском алгоритма Дейкстры из каждой вершины и занимает
+// O(n^2) памяти, поэтому подходит только для небольших карт
+class DistanceTable {
+public:
+    using NodeId = model::RoadNetwork::NodeId;
+    using Distance = int64_t;
+
+    DistanceTable() = default;
+    explicit DistanceTable(const model::RoadNetwork& network);
+
+    size_t GetNodeCount() const noexcept;
+    std::optional<Distance> GetDistance(NodeId from, NodeId to) const;
+    std::optional<NodeId> GetNextHop(NodeId from, NodeId to) const;
+    std::vector<NodeId> GetPath(NodeId from, NodeId to) const;
+
+private:
+    static constexpr Distance NO_PATH = -1;
+    size_t node_count_ = 0;
+    // Путь из from в to: distances_[from * node_count_ + to] и первая вершина после from
+    std::vector<Distance> distances_;
+    std::vector<NodeId> next_hops_;
+
+    size_t GetIndex(NodeId from, NodeId to) const;
+};
+
+// Поиск путей по дорожной сети карты: небольшие сети получают полную таблицу
+// путей, остальные - иерархию сжатия
+class RoutePlanner {
+public:
+    using NodeId = model::RoadNetwork::NodeId;
+    using Distance = int64_t;
+    // Сети не больше стольких вершин получают таблицу (12 Мб на 1024 вершины)
+    static constexpr size_t DEFAULT_TABLE_MAX_NODES = 1024;
+
+    RoutePlanner() = default;
+    explicit RoutePlanner(const model::RoadNetwork& network, size_t table_max_nodes = DEFAULT_TABLE_MAX_NODES);
+
+    bool HasTable() const noexcept;
+    std::optional<Distance> GetDistance(NodeId from, NodeId to) const;
+    std::optional<NodeId> GetNextHop(NodeId from, NodeId to) const;
+    std::vector<NodeId> GetPath(NodeId from, NodeId to) const;
+
+private:
+    std::variant<DistanceTable, ContractionHierarchy> router_;
+};
+
+} // namespace routing
@@ -0,0 +1,50 @@
+#pragma once
+#include "http_server.h"
+
+#include <memory>
+#include <string>
+#include <boost/optional.hpp>
+
+namespace http_handler {
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+
+// Тело ответа - неизменяемая строка, общая для всех ответов. Ответ хранит только
+// указатель на неё, поэтому заранее подготовленное тело отправляется без копирования
+struct SharedBody {
+    using value_type = std::shared_ptr<const std::string>;
+
+    static std::uint64_t size(const value_type& body) noexcept {
+        return body ? body->size() : 0;
+    }
+
+    class writer {
+    public:
+        using const_buffers_type = net::const_buffer;
+
+        template <bool isRequest, class Fields>
+        writer(const http::header<isRequest, Fields>&, const value_type& body) noexcept
+            : body_(body) {
+        }
+
+        void init(beast::error_code& ec) noexcept {
+            ec = {};
+        }
+
+        // Всё тело отдаётся одним буфером
+        boost::optional<std::pair<const_buffers_type, bool>> get(beast::error_code& ec) noexcept {
+            ec = {};
+            if (!body_ || body_->empty()) {
+                return boost::none;
+            }
+            return std::make_pair(const_buffers_type{body_->data(), body_->size()}, false);
+        }
+
+    private:
+        const value_type& body_;
+    };
+};
+
+} // namespace http_handler
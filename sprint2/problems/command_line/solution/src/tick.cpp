@@ -2,7 +2,11 @@
 #include <boost/asio/strand.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
+#include <algorithm>
+#include <cassert>
 #include <chrono>
+#include <stdexcept>
+#include <string>
 // #include <boost/program_options.hpp>
 // #include <boost/asio/strand.hpp>
 
@@ -22,44 +26,100 @@ namespace tick {
 namespace net = boost::asio;
 namespace sys = boost::system;
 // namespace beast = boost::beast;
+using namespace std::literals;
    
     
     
+StepPlan PlanSteps(std::chrono::steady_clock::duration lateness, std::chrono::milliseconds period
+                   , const Policy& policy) noexcept {
+    assert(period.count() > 0);
+    StepPlan plan;
+    plan.periods = static_cast<uint64_t>(std::max(lateness, std::chrono::steady_clock::duration::zero()) / period) + 1;
+    if (policy.mode == Policy::Mode::Coalesce) {
+        plan.delta = period * plan.periods;
+    } else {
+        plan.steps = std::min<uint64_t>(plan.periods, std::max(1u, policy.max_substeps));
+        plan.dropped = plan.periods - plan.steps;
+        plan.delta = period;
+    }
+    return plan;
+}
+
 // Функция handler будет вызываться внутри strand с интервалом period
-Ticker::Ticker(Strand strand, std::chrono::milliseconds period, Handler handler)
+Ticker::Ticker(Strand strand, std::chrono::milliseconds period, Handler handler, Policy policy)
     : strand_{strand}
     , period_{period}
-    , handler_{std::move(handler)} {
+    , handler_{std::move(handler)}
+    , policy_{policy} {
+    if (period_.count() <= 0) {
+        throw std::invalid_argument("Tick period must be positive"s);
+    }
+    policy_.max_substeps = std::max(1u, policy_.max_substeps);
+}
+
+void Ticker::SetStatsReport(std::chrono::milliseconds report_period, StatsHandler stats_handler) {
+    report_period_ = report_period;
+    stats_handler_ = std::move(stats_handler);
 }
 
 void Ticker::Start() {
     net::dispatch(strand_, [self = shared_from_this()] {
-        self->last_tick_ = Clock::now();
+        self->deadline_ = Clock::now() + self->period_;
+        self->last_report_ = Clock::now();
         self->ScheduleTick();
     });
 }
 
+Stats Ticker::GetStats() const {
+    return stats_;
+}
+
 void Ticker::ScheduleTick() {
     assert(strand_.running_in_this_thread());
-    timer_.expires_after(period_);
+    timer_.expires_at(deadline_);
     timer_.async_wait([self = shared_from_this()](sys::error_code ec) {
         self->OnTick(ec);
     });
 }
 
 void Ticker::OnTick(sys::error_code ec) {
-    using namespace std::chrono;
     assert(strand_.running_in_this_thread());
+    if (ec) {
+        return;
+    }
+    const auto now = Clock::now();
+    const auto lateness = std::max(now - deadline_, Clock::duration::zero());
+    stats_.lateness.Record(lateness);
+    ++stats_.wakeups;
+    const auto plan = PlanSteps(lateness, period_, policy_);
+    if (plan.periods > 1) {
+        ++stats_.overruns;
+        stats_.missed_periods += plan.periods - 1;
+    }
+    stats_.dropped_periods += plan.dropped;
+    deadline_ += period_ * plan.periods;
+    for (uint64_t i = 0; i < plan.steps; ++i) {
+        Step(plan.delta);
+    }
 
-    if (!ec) {
-        auto this_tick = Clock::now();
-        auto delta = duration_cast<milliseconds>(this_tick - last_tick_);
-        last_tick_ = this_tick;
-        try {
-            handler_(delta);
-        } catch (...) {
-        }
-        ScheduleTick();
+    if (stats_handler_ && report_period_.count() > 0 && Clock::now() - last_report_ >= report_period_) {
+        last_report_ = Clock::now();
+        stats_handler_(stats_);
+    }
+    ScheduleTick();
+}
+
+void Ticker::Step(std::chrono::milliseconds delta) {
+    const auto start = Clock::now();
+    try {
+        handler_(delta);
+    } catch (...) {
+    }
+    const auto duration = Clock::now() - start;
+    ++stats_.steps;
+    stats_.step_time.Record(duration);
+    if (duration > period_) {
+        ++stats_.long_steps;
     }
 }
 
@@ -4,6 +4,9 @@
 #include <boost/asio/ip/tcp.hpp>
 
 #include <chrono>
+#include <functional>
+
+#include "histogram.h"
 // #include <boost/program_options.hpp>
 // #include <boost/asio/strand.hpp>
 
@@ -30,22 +33,71 @@ namespace sys = boost::system;
    
     
     
+    // Что делать, если к моменту срабатывания таймера прошло несколько периодов
+    struct Policy {
+        enum class Mode {
+            CatchUp,  // несколько шагов по period подряд, не больше max_substeps
+            Coalesce  // один шаг на всё прошедшее время
+        };
+        Mode mode = Mode::CatchUp;
+        // Пропущенные сверх этого периоды отбрасываются: время игры отстаёт,
+        // зато сервер не тратит всё время на догоняющие шаги
+        unsigned max_substeps = 4;
+    };
+
+    // Как отработать срабатывание таймера, опоздавшее на lateness
+    struct StepPlan {
+        uint64_t periods = 1;              // наступившие сроки: текущий и пропущенные за ним
+        uint64_t steps = 1;                // вызовы handler
+        uint64_t dropped = 0;              // периоды, отброшенные из-за max_substeps
+        std::chrono::milliseconds delta{}; // время, передаваемое каждому вызову handler
+    };
+    // period должен быть больше нуля
+    StepPlan PlanSteps(std::chrono::steady_clock::duration lateness, std::chrono::milliseconds period
+                       , const Policy& policy) noexcept;
+
+    // Счётчики и гистограммы тикера. Меняются внутри strand
+    struct Stats {
+        uint64_t wakeups = 0;         // срабатывания таймера
+        uint64_t steps = 0;           // вызовы handler
+        uint64_t overruns = 0;        // срабатывания, к которым прошло больше одного периода
+        uint64_t missed_periods = 0;  // периоды, пропущенные при таких срабатываниях
+        uint64_t dropped_periods = 0; // периоды, отброшенные из-за max_substeps
+        uint64_t long_steps = 0;      // вызовы handler дольше периода
+        util::Histogram lateness;     // задержка срабатывания относительно срока
+        util::Histogram step_time;    // время одного вызова handler
+    };
+
+    // Вызывает handler с фиксированным шагом: сроки тиков отсчитываются от запуска
+    // (start + k * period), поэтому время работы handler не сдвигает следующие тики
     class Ticker : public std::enable_shared_from_this<Ticker> {
     public:
         using Strand = net::strand<net::io_context::executor_type>;
         using Handler = std::function<void(std::chrono::milliseconds delta)>;
-        // Функция handler будет вызываться внутри strand с интервалом period
-        Ticker(Strand strand, std::chrono::milliseconds period, Handler handler);
+        using StatsHandler = std::function<void(const Stats& stats)>;
+        // Функция handler будет вызываться внутри strand с интервалом period.
+        // Если period не больше нуля, бросает std::invalid_argument
+        Ticker(Strand strand, std::chrono::milliseconds period, Handler handler, Policy policy = {});
+        // stats_handler вызывается внутри strand после тика не чаще раза в report_period
+        void SetStatsReport(std::chrono::milliseconds report_period, StatsHandler stats_handler);
         void Start() ;
+        // Копия статистики. Вызывается внутри strand или после остановки io_context
+        Stats GetStats() const;
     private:
         void ScheduleTick();
         void OnTick(sys::error_code ec);
+        void Step(std::chrono::milliseconds delta);
         using Clock = std::chrono::steady_clock;
         Strand strand_;
         std::chrono::milliseconds period_;
         net::steady_timer timer_{strand_};
         Handler handler_;
-        std::chrono::steady_clock::time_point last_tick_;
+        Policy policy_;
+        Clock::time_point deadline_; // срок следующего тика
+        Stats stats_;
+        std::chrono::milliseconds report_period_{0};
+        StatsHandler stats_handler_;
+        Clock::time_point last_report_;
     };
 
 
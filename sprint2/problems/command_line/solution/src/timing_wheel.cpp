@@ -0,0 +1,128 @@
+#include "timing_wheel.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace util {
+
+TimingWheel::TimingWheel(Time now) noexcept
+    : now_(now) {
+    heads_.fill(NO_KEY);
+}
+
+void TimingWheel::Schedule(Key key, Time deadline) {
+    if (key >= timers_.size()) {
+        timers_.resize(key + 1);
+    }
+    Unlink(key);
+    timers_[key].deadline = deadline;
+    Insert(key);
+}
+
+void TimingWheel::Cancel(Key key) noexcept {
+    if (key < timers_.size()) {
+        Unlink(key);
+    }
+}
+
+bool TimingWheel::IsScheduled(Key key) const noexcept {
+    return key < timers_.size() && timers_[key].list != NO_LIST;
+}
+
+TimingWheel::Time TimingWheel::GetTime() const noexcept {
+    return now_;
+}
+
+void TimingWheel::Advance(Time now, std::vector<Key>& expired) {
+    pending_.clear();
+    TakeList(DUE_LIST);
+    if (now > now_) {
+        for (unsigned level = 0; level < LEVELS; ++level) {
+            const unsigned shift = level * LEVEL_BITS;
+            const Time from = now_ >> shift;
+            const Time to = now >> shift;
+            if (from == to) {
+                break; // на старших уровнях время тоже не дошло до следующей ячейки
+            }
+            // Ячейки (from, to] уровня, с переходом через его конец
+            uint64_t passed = ~uint64_t{0};
+            if (to - from < SLOTS) {
+                const auto first = static_cast<int>((from + 1) % SLOTS);
+                passed = std::rotl((uint64_t{1} << (to - from)) - 1, first);
+            }
+            for (uint64_t slots = occupied_[level] & passed; slots != 0; slots &= slots - 1) {
+                TakeList(level * SLOTS + std::countr_zero(slots));
+            }
+        }
+        now_ = now;
+    }
+    // Таймеры пройденных ячеек срабатывают или переходят на нижние уровни
+    for (const auto key : pending_) {
+        if (timers_[key].deadline <= now_) {
+            expired.push_back(key);
+        } else {
+            Insert(key);
+        }
+    }
+}
+
+void TimingWheel::Insert(Key key) {
+    const Time deadline = timers_[key].deadline;
+    if (deadline <= now_) {
+        Link(key, DUE_LIST);
+        return;
+    }
+    // Срок дальше охвата колеса ложится на верхний уровень в ячейку с его битами.
+    // Время пройдёт эту ячейку не позже срока, и Advance вставит таймер заново
+    const unsigned level = std::min<unsigned>((std::bit_width(deadline ^ now_) - 1) / LEVEL_BITS, LEVELS - 1);
+    const auto slot = static_cast<uint32_t>((deadline >> (level * LEVEL_BITS)) % SLOTS);
+    Link(key, level * SLOTS + slot);
+}
+
+void TimingWheel::Link(Key key, uint32_t list) noexcept {
+    auto& timer = timers_[key];
+    timer.list = list;
+    timer.prev = NO_KEY;
+    timer.next = heads_[list];
+    if (timer.next != NO_KEY) {
+        timers_[timer.next].prev = key;
+    }
+    heads_[list] = key;
+    if (list != DUE_LIST) {
+        occupied_[list / SLOTS] |= uint64_t{1} << (list % SLOTS);
+    }
+}
+
+void TimingWheel::Unlink(Key key) noexcept {
+    auto& timer = timers_[key];
+    if (timer.list == NO_LIST) {
+        return;
+    }
+    if (timer.prev != NO_KEY) {
+        timers_[timer.prev].next = timer.next;
+    } else {
+        heads_[timer.list] = timer.next;
+        if (timer.next == NO_KEY && timer.list != DUE_LIST) {
+            occupied_[timer.list / SLOTS] &= ~(uint64_t{1} << (timer.list % SLOTS));
+        }
+    }
+    if (timer.next != NO_KEY) {
+        timers_[timer.next].prev = timer.prev;
+    }
+    timer.list = NO_LIST;
+}
+
+void TimingWheel::TakeList(uint32_t list) {
+    for (Key key = heads_[list]; key != NO_KEY; ) {
+        auto& timer = timers_[key];
+        pending_.push_back(key);
+        timer.list = NO_LIST;
+        key = timer.next;
+    }
+    heads_[list] = NO_KEY;
+    if (list != DUE_LIST) {
+        occupied_[list / SLOTS] &= ~(uint64_t{1} << (list % SLOTS));
+    }
+}
+
+} // namespace util
@@ -0,0 +1,63 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace util {
+
+// Иерархическое колесо таймеров. Таймер с ключом key (небольшое число, например
+// номер слота) срабатывает в момент deadline. Время - целое число миллисекунд.
+// Уровень l колеса состоит из 64 ячеек по 64^l мс: таймер лежит на уровне старшей
+// группы из 6 бит, в которой его срок отличается от текущего времени, в ячейке
+// с этой группой бит срока. Когда текущее время доходит до ячейки, её таймеры
+// срабатывают или опускаются на уровни ниже. Установка и отмена таймера - O(1),
+// продвижение времени просматривает только пройденные непустые ячейки
+class TimingWheel {
+public:
+    using Key = uint32_t;
+    using Time = uint64_t;
+
+    explicit TimingWheel(Time now = 0) noexcept;
+
+    // Устанавливает срок таймера key, заменяя прежний
+    void Schedule(Key key, Time deadline);
+    void Cancel(Key key) noexcept;
+    bool IsScheduled(Key key) const noexcept;
+    Time GetTime() const noexcept;
+    // Продвигает время до now и добавляет в expired ключи сработавших таймеров.
+    // Сработавшие таймеры снимаются. Таймер со сроком дальше охвата колеса
+    // (2^36 мс) может пройти через верхний уровень несколько раз, но срабатывает в срок
+    void Advance(Time now, std::vector<Key>& expired);
+
+private:
+    static constexpr unsigned LEVEL_BITS = 6;
+    static constexpr unsigned SLOTS = 1u << LEVEL_BITS;
+    // 6 уровней охватывают 2^36 мс (около двух лет)
+    static constexpr unsigned LEVELS = 6;
+    static constexpr uint32_t DUE_LIST = LEVELS * SLOTS; // таймеры со сроком не позже текущего времени
+    static constexpr uint32_t NO_LIST = std::numeric_limits<uint32_t>::max();
+    static constexpr Key NO_KEY = std::numeric_limits<Key>::max();
+
+    // Таймеры одной ячейки связаны в двусвязный список через массивы по ключу
+    struct Timer {
+        Time deadline = 0;
+        Key prev = NO_KEY;
+        Key next = NO_KEY;
+        uint32_t list = NO_LIST;
+    };
+
+    Time now_;
+    std::vector<Timer> timers_;
+    std::array<Key, DUE_LIST + 1> heads_;
+    std::array<uint64_t, LEVELS> occupied_{}; // бит i - в ячейке i уровня есть таймеры
+    std::vector<Key> pending_; // таймеры пройденных ячеек при продвижении времени
+
+    void Insert(Key key);
+    void Link(Key key, uint32_t list) noexcept;
+    void Unlink(Key key) noexcept;
+    // Переносит таймеры ячейки в pending_
+    void TakeList(uint32_t list);
+};
+
+} // namespace util
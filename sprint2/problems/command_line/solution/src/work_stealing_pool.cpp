@@ -0,0 +1,136 @@
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+
+namespace util {
+
+WorkStealingPool::WorkStealingPool(unsigned threads) {
+    threads = std::max(1u, threads);
+    queues_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+    // Нулевая очередь принадлежит вызывающему потоку
+    workers_.reserve(threads - 1);
+    for (unsigned i = 1; i < threads; ++i) {
+        workers_.emplace_back([this, i] { WorkerLoop(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard lock{mutex_};
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+    // Дожидаемся рабочих потоков, пока мьютексы и условные переменные ещё живы
+    workers_.clear();
+}
+
+unsigned WorkStealingPool::GetThreadCount() const noexcept {
+    return static_cast<unsigned>(queues_.size());
+}
+
+void WorkStealingPool::ParallelFor(size_t count, const Task& task) {
+    if (count == 0) {
+        return;
+    }
+    // Раздаём задачи потокам непрерывными диапазонами
+    const size_t threads = queues_.size();
+    for (size_t i = 0; i < threads; ++i) {
+        auto& queue = *queues_[i];
+        std::lock_guard lock{queue.mutex};
+        for (size_t index = count * i / threads; index < count * (i + 1) / threads; ++index) {
+            queue.indices.push_back(index);
+        }
+    }
+    remaining_.store(count, std::memory_order_relaxed);
+    error_ = nullptr;
+    {
+        std::lock_guard lock{mutex_};
+        task_ = &task;
+        busy_workers_ = workers_.size();
+        ++generation_;
+    }
+    start_cv_.notify_all();
+
+    RunTasks(0, task);
+
+    // Барьер: ждём, пока все рабочие потоки закончат задачи этого вызова
+    std::unique_lock lock{mutex_};
+    done_cv_.wait(lock, [this] { return busy_workers_ == 0; });
+    task_ = nullptr;
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+void WorkStealingPool::WorkerLoop(unsigned worker_index) {
+    size_t seen_generation = 0;
+    while (true) {
+        const Task* task = nullptr;
+        {
+            std::unique_lock lock{mutex_};
+            start_cv_.wait(lock, [this, seen_generation] { return stop_ || generation_ != seen_generation; });
+            if (stop_) {
+                return;
+            }
+            seen_generation = generation_;
+            task = task_;
+        }
+        RunTasks(worker_index, *task);
+        {
+            std::lock_guard lock{mutex_};
+            --busy_workers_;
+        }
+        done_cv_.notify_one();
+    }
+}
+
+void WorkStealingPool::RunTasks(unsigned worker_index, const Task& task) {
+    size_t index = 0;
+    while (remaining_.load(std::memory_order_acquire) > 0) {
+        if (!PopLocal(worker_index, index) && !Steal(worker_index, index)) {
+            // Задачи разобраны, но ещё выполняются другими потоками
+            std::this_thread::yield();
+            continue;
+        }
+        try {
+            task(index);
+        } catch (...) {
+            std::lock_guard lock{error_mutex_};
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+        }
+        remaining_.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+bool WorkStealingPool::PopLocal(unsigned worker_index, size_t& index) {
+    auto& queue = *queues_[worker_index];
+    std::lock_guard lock{queue.mutex};
+    if (queue.indices.empty()) {
+        return false;
+    }
+    index = queue.indices.back();
+    queue.indices.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::Steal(unsigned thief_index, size_t& index) {
+    const size_t threads = queues_.size();
+    for (size_t shift = 1; shift < threads; ++shift) {
+        auto& queue = *queues_[(thief_index + shift) % threads];
+        std::lock_guard lock{queue.mutex};
+        if (!queue.indices.empty()) {
+            // Чужие задачи забираем с противоположного конца очереди
+            index = queue.indices.front();
+            queue.indices.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace util
@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+// Пул потоков для параллельного выполнения независимых задач тика.
+// У каждого потока своя очередь задач, освободившийся поток забирает задачи
+// из чужих очередей. Вызывающий поток тоже выполняет задачи
+class WorkStealingPool {
+public:
+    using Task = std::function<void(size_t index)>;
+
+    // threads - общее число потоков, включая вызывающий
+    explicit WorkStealingPool(unsigned threads);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Выполняет task(i) для всех i из [0, count) и возвращает управление,
+    // когда все задачи завершены. Первое из исключений задач пробрасывается вызывающему
+    void ParallelFor(size_t count, const Task& task);
+    unsigned GetThreadCount() const noexcept;
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<size_t> indices;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::jthread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    const Task* task_ = nullptr;
+    size_t generation_ = 0;   // номер текущего вызова ParallelFor
+    size_t busy_workers_ = 0; // рабочие потоки, ещё не закончившие текущий вызов
+    bool stop_ = false;
+
+    std::atomic<size_t> remaining_{0};
+    std::exception_ptr error_;
+    std::mutex error_mutex_;
+
+    void WorkerLoop(unsigned worker_index);
+    // Выполняет задачи из своей очереди, затем ворует из чужих
+    void RunTasks(unsigned worker_index, const Task& task);
+    bool PopLocal(unsigned worker_index, size_t& index);
+    bool Steal(unsigned thief_index, size_t& index);
+};
+
+} // namespace util
@@ -0,0 +1,69 @@
+#include <cmath>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/fast_random.h"
+#include "../src/model.h"
+
+using namespace std::literals;
+
+namespace {
+
+// Доли выпадения каждого индекса таблицы
+std::vector<double> SampleFrequencies(const util::AliasTable& table, size_t draws) {
+    util::SplitMix64 random{42};
+    std::vector<double> frequencies(table.Size());
+    for (size_t i = 0; i < draws; ++i) {
+        frequencies[table.Sample(random)] += 1.0 / draws;
+    }
+    return frequencies;
+}
+
+} // namespace
+
+SCENARIO("Alias table sampling") {
+    GIVEN("weights with a zero among them") {
+        const std::vector<double> weights{1.0, 2.0, 3.0, 0.0, 4.0};
+        const util::AliasTable table{weights};
+
+        THEN("indices are drawn proportionally to their weights") {
+            const auto frequencies = SampleFrequencies(table, 1'000'000);
+            for (size_t i = 0; i < weights.size(); ++i) {
+                CHECK(std::abs(frequencies[i] - weights[i] / 10.0) < 0.005);
+            }
+            CHECK(frequencies[3] == 0.0);
+        }
+    }
+    GIVEN("only zero weights") {
+        const util::AliasTable table{std::vector<double>(4, 0.0)};
+
+        THEN("indices are drawn uniformly") {
+            for (const auto frequency : SampleFrequencies(table, 1'000'000)) {
+                CHECK(std::abs(frequency - 0.25) < 0.005);
+            }
+        }
+    }
+}
+
+SCENARIO("Random position on map roads") {
+    GIVEN("a map with a long and a short road") {
+        model::Map map{model::Map::Id{"map1"s}, "Map 1"s};
+        map.AddRoad(model::Road{model::Road::HORIZONTAL, {0, 0}, 90});
+        map.AddRoad(model::Road{model::Road::VERTICAL, {100, 20}, 10});
+        map.BildListOderedPath();
+
+        THEN("positions lie on roads, the long road is chosen proportionally more often") {
+            size_t on_long_road = 0;
+            size_t on_short_road = 0;
+            const size_t draws = 100'000;
+            util::SplitMix64 random{42};
+            for (size_t i = 0; i < draws; ++i) {
+                const auto pos = map.GetRandomPos(random);
+                on_long_road += pos.y == 0.0 && pos.x >= 0.0 && pos.x <= 90.0;
+                on_short_road += pos.x == 100.0 && pos.y >= 10.0 && pos.y <= 20.0;
+            }
+            CHECK(on_long_road + on_short_road == draws);
+            CHECK(std::abs(static_cast<double>(on_long_road) / draws - 0.9) < 0.01);
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/histogram.h"
+
+using namespace std::literals;
+
+SCENARIO("Duration histogram") {
+    GIVEN("an empty histogram") {
+        util::Histogram histogram;
+
+        THEN("it reports zeros") {
+            CHECK(histogram.GetCount() == 0);
+            CHECK(histogram.GetMean() == 0ns);
+            CHECK(histogram.GetPercentile(0.99) == 0ns);
+        }
+    }
+    GIVEN("a histogram of 100 durations with a few long ones") {
+        util::Histogram histogram;
+        for (int i = 0; i < 97; ++i) {
+            histogram.Record(1000ns);
+        }
+        histogram.Record(50us);
+        histogram.Record(60us);
+        histogram.Record(2ms);
+
+        THEN("count, mean and max are exact") {
+            CHECK(histogram.GetCount() == 100);
+            CHECK(histogram.GetMax() == 2ms);
+            CHECK(histogram.GetMean() == (97 * 1000ns + 50us + 60us + 2ms) / 100);
+        }
+        THEN("percentiles are bounded by their bucket within a factor of two") {
+            const auto p50 = histogram.GetPercentile(0.5);
+            CHECK(p50 >= 1000ns);
+            CHECK(p50 < 2000ns);
+            const auto p98 = histogram.GetPercentile(0.98);
+            CHECK(p98 >= 50us);
+            CHECK(p98 < 120us);
+            CHECK(histogram.GetPercentile(1.0) == 2ms);
+        }
+    }
+}
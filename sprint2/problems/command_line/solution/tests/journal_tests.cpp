@@ -0,0 +1,155 @@
+#include <atomic>
+#include <filesystem>
+#include <thread>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/application.h"
+#include "../src/journal.h"
+
+using namespace std::literals;
+
+namespace {
+
+model::Map MakeMap() {
+    model::Map map{model::Map::Id{"map1"s}, "Map 1"s};
+    for (int i = 0; i <= 4; ++i) {
+        map.AddRoad(model::Road{model::Road::HORIZONTAL, {0, i * 10}, 40});
+        map.AddRoad(model::Road{model::Road::VERTICAL, {i * 10, 0}, 40});
+    }
+    map.BildListOderedPath();
+    map.SetDogSpeed(3.0);
+    return map;
+}
+
+// Игра со случайными точками появления собак
+struct TestGame {
+    model::Game game{true};
+    app::Application app{game};
+
+    TestGame() {
+        game.AddMap(MakeMap());
+        game.SetSessionLimit(3, model::SessionPolicy::FillFirst);
+    }
+};
+
+// Игроки входят, ходят, один уходит
+std::vector<uint64_t> Play(app::Application& app) {
+    std::vector<std::string> tokens;
+    std::vector<uint64_t> checksums;
+    for (int tick = 0; tick < 200; ++tick) {
+        if (tick % 20 == 0) {
+            tokens.push_back(*app.AddPlayer("player "s + std::to_string(tick), "map1"s).token);
+        }
+        if (tick % 7 == 0) {
+            app.SetDogDirect(tokens[tick % tokens.size()], "LRUD"[tick % 4]);
+        }
+        if (tick == 150) {
+            app.RemovePlayer(tokens.front());
+            tokens.erase(tokens.begin());
+        }
+        app.ChangeGameSate(50ms);
+        checksums.push_back(app.GetStateChecksum());
+    }
+    return checksums;
+}
+
+} // namespace
+
+SCENARIO("Deterministic game with a journal") {
+    GIVEN("two games with the same seed") {
+        TestGame first, second;
+        first.app.SetRandomSeed(42);
+        second.app.SetRandomSeed(42);
+
+        THEN("players get the same tokens and the games stay identical") {
+            CHECK(first.app.AddPlayer("dog"s, "map1"s).token == second.app.AddPlayer("dog"s, "map1"s).token);
+            CHECK(Play(first.app) == Play(second.app));
+        }
+    }
+    GIVEN("two games with the same seed, one ticking sessions in 4 threads") {
+        TestGame serial, parallel;
+        serial.app.SetRandomSeed(42);
+        parallel.app.SetRandomSeed(42);
+        parallel.game.SetTickThreads(4);
+
+        // В Play входят 10 игроков, по 3 в сессии - сессии тикают параллельно
+        THEN("the games stay identical") {
+            CHECK(Play(parallel.app) == Play(serial.app));
+        }
+    }
+    GIVEN("a game recorded to a journal") {
+        const auto path = std::filesystem::temp_directory_path() / "journal_tests.journal";
+        std::vector<uint64_t> recorded;
+        {
+            TestGame game;
+            game.app.SetRandomSeed(7);
+            game.app.SetJournal(std::make_unique<journal::Writer>(path, 7));
+            recorded = Play(game.app);
+        }
+
+        THEN("the replay repeats every tick") {
+            journal::Replay replay{path};
+            REQUIRE(replay.GetSeed() == 7);
+            TestGame game;
+            game.app.SetRandomSeed(replay.GetSeed());
+            const auto result = replay.Run(game.app);
+            CHECK(result.ticks == recorded.size());
+            CHECK(result.joins == 10);
+            CHECK(result.leaves == 1);
+            CHECK(result.mismatches == 0);
+            CHECK(result.checksum == recorded.back());
+        }
+        THEN("a replay with another seed diverges") {
+            journal::Replay replay{path};
+            TestGame game;
+            game.app.SetRandomSeed(8);
+            const auto result = replay.Run(game.app);
+            CHECK(result.mismatches > 0);
+            CHECK(result.first_mismatch == 1);
+        }
+        std::filesystem::remove(path);
+    }
+    GIVEN("a game recorded while commands arrive from another thread during ticks") {
+        const auto path = std::filesystem::temp_directory_path() / "journal_tests_threads.journal";
+        uint64_t recorded = 0;
+        size_t ticks = 0;
+        {
+            TestGame game;
+            game.app.SetRandomSeed(11);
+            game.app.SetJournal(std::make_unique<journal::Writer>(path, 11));
+            std::vector<std::string> tokens;
+            for (int i = 0; i < 6; ++i) {
+                tokens.push_back(*game.app.AddPlayer("player "s + std::to_string(i), "map1"s).token);
+            }
+            std::atomic<bool> done{false};
+            std::thread commands([&] {
+                // Команды приходят в произвольные моменты тика, как из потоков ввода-вывода
+                for (size_t i = 0; i < 3000; ++i) {
+                    game.app.SetDogDirect(tokens[i % tokens.size()], "LRUD-"[i % 5] == '-' ? 0 : "LRUD-"[i % 5]);
+                    std::this_thread::sleep_for(10us);
+                }
+                done = true;
+            });
+            // Тики идут вперемешку с командами, пока они не кончатся
+            for (; !done.load(); ++ticks) {
+                game.app.ChangeGameSate(20ms);
+            }
+            commands.join();
+            game.app.ChangeGameSate(20ms);
+            ++ticks;
+            recorded = game.app.GetStateChecksum();
+        }
+
+        THEN("the replay repeats every tick") {
+            journal::Replay replay{path};
+            TestGame game;
+            game.app.SetRandomSeed(replay.GetSeed());
+            const auto result = replay.Run(game.app);
+            CHECK(result.ticks == ticks);
+            CHECK(result.moves == 3000);
+            CHECK(result.mismatches == 0);
+            CHECK(result.checksum == recorded);
+        }
+        std::filesystem::remove(path);
+    }
+}
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/model.h"
+
+using namespace std::literals;
+
+SCENARIO("Road ends lookup") {
+    GIVEN("a map with roads added in arbitrary order") {
+        model::Map map{model::Map::Id{"map1"s}, "Map 1"s};
+        // Горизонтальные дороги на y = 0: [40, 70] перекрывает [30, 50], а [0, 30] их продолжает
+        map.AddRoad(model::Road{model::Road::HORIZONTAL, {70, 0}, 40});
+        map.AddRoad(model::Road{model::Road::HORIZONTAL, {0, 0}, 30});
+        map.AddRoad(model::Road{model::Road::HORIZONTAL, {30, 0}, 50});
+        // Отдельная дорога на том же уровне
+        map.AddRoad(model::Road{model::Road::HORIZONTAL, {80, 0}, 90});
+        map.AddRoad(model::Road{model::Road::VERTICAL, {10, -5}, 5});
+        map.BildListOderedPath();
+
+        THEN("touching and overlapping roads form a single path") {
+            CHECK(map.GetEndOfPath(true, true, 0, 5) == 70);
+            CHECK(map.GetEndOfPath(true, false, 0, 5) == 0);
+            CHECK(map.GetEndOfPath(true, true, 0, 60) == 70);
+            CHECK(map.GetEndOfPath(true, false, 0, 70) == 0);
+        }
+        THEN("separate roads on the same level stay separate") {
+            CHECK(map.GetEndOfPath(true, false, 0, 85) == 80);
+            CHECK(map.GetEndOfPath(true, true, 0, 80) == 90);
+        }
+        THEN("vertical roads are looked up by their x") {
+            CHECK(map.GetEndOfPath(false, true, 10, 0) == 5);
+            CHECK(map.GetEndOfPath(false, false, 10, 0) == -5);
+        }
+        THEN("a point off the roads is its own end") {
+            CHECK(map.GetEndOfPath(true, true, 0, 75) == 75);
+            CHECK(map.GetEndOfPath(true, true, 3, 10) == 10);
+            CHECK(map.GetEndOfPath(false, true, 11, 0) == 0);
+        }
+    }
+}
+
+SCENARIO("Road network graph") {
+    GIVEN("a map with crossing roads") {
+        model::Map map{model::Map::Id{"map1"s}, "Map 1"s};
+        // [0, 30] и [30, 70] сливаются в один путь, [80, 90] остаётся отдельным
+        map.AddRoad(model::Road{model::Road::HORIZONTAL, {70, 0}, 30});
+        map.AddRoad(model::Road{model::Road::HORIZONTAL, {0, 0}, 30});
+        map.AddRoad(model::Road{model::Road::HORIZONTAL, {80, 0}, 90});
+        map.AddRoad(model::Road{model::Road::VERTICAL, {10, -5}, 5});
+        map.BildListOderedPath();
+        const auto& network = map.GetRoadNetwork();
+
+        THEN("nodes are placed at road ends and crossings") {
+            CHECK(network.GetNodeCount() == 7);
+            CHECK(network.FindNode({10, 0}).has_value());
+            CHECK(network.FindNode({80, 0}).has_value());
+            CHECK_FALSE(network.FindNode({30, 0}).has_value());
+        }
+        THEN("edges connect neighbouring nodes of a path") {
+            const auto crossing = *network.FindNode({10, 0});
+            CHECK(network.GetEdges(crossing).size() == 4);
+
+            const auto end = *network.FindNode({70, 0});
+            const auto edges = network.GetEdges(end);
+            REQUIRE(edges.size() == 1);
+            CHECK(edges[0].to == crossing);
+            CHECK(edges[0].length == 60);
+        }
+        THEN("separate roads on the same level are not connected") {
+            const auto edges = network.GetEdges(*network.FindNode({80, 0}));
+            REQUIRE(edges.size() == 1);
+            CHECK(network.GetNodePos(edges[0].to).x == 90);
+        }
+    }
+}
+
+SCENARIO("Item grid queries along movement segments") {
+    GIVEN("a grid with items inserted, moved and removed at random") {
+        std::mt19937 random{42};
+        std::uniform_real_distribution<double> coord(-20.0, 60.0);
+        model::ItemGrid grid;
+        std::vector<std::optional<model::Dog::Pos>> items(300);
+        for (int step = 0; step < 2000; ++step) {
+            const auto id = static_cast<model::ItemGrid::ItemId>(random() % items.size());
+            if (random() % 3 == 0) {
+                grid.Remove(id);
+                items[id].reset();
+            } else {
+                items[id] = model::Dog::Pos{coord(random), coord(random)};
+                grid.Insert(id, *items[id]);
+            }
+        }
+        const auto count = std::count_if(items.begin(), items.end(), [](const auto& item) { return item.has_value(); });
+        REQUIRE(grid.Size() == static_cast<size_t>(count));
+
+        THEN("queries return exactly the items near each segment") {
+            std::vector<model::ItemGrid::Segment> segments;
+            for (int i = 0; i < 200; ++i) {
+                const model::Dog::Pos from{coord(random), coord(random)};
+                // короткие отрезки вдоль осей, как у собак, и несколько длинных косых
+                const double length = i % 20 == 0 ? 80.0 : 3.0 * (random() % 100) / 100.0;
+                const model::Dog::Pos to = i % 20 == 0 ? model::Dog::Pos{from.x + length, from.y + length / 2}
+                                         : i % 2 ? model::Dog::Pos{from.x + length, from.y} : model::Dog::Pos{from.x, from.y - length};
+                segments.push_back({from, to});
+            }
+            const double radius = 0.6;
+            std::vector<std::pair<size_t, model::ItemGrid::ItemId>> found;
+            grid.ForEachNear(segments, radius, [&found](size_t segment, model::ItemGrid::ItemId id) {
+                found.emplace_back(segment, id);
+            });
+            std::sort(found.begin(), found.end());
+
+            std::vector<std::pair<size_t, model::ItemGrid::ItemId>> expected;
+            for (size_t s = 0; s < segments.size(); ++s) {
+                const auto [from, to] = segments[s];
+                for (model::ItemGrid::ItemId id = 0; id < items.size(); ++id) {
+                    if (!items[id]) {
+                        continue;
+                    }
+                    // расстояние до отрезка по 1000 точкам на нём
+                    double best = INFINITY;
+                    for (int k = 0; k <= 1000; ++k) {
+                        const double x = from.x + (to.x - from.x) * k / 1000.0 - items[id]->x;
+                        const double y = from.y + (to.y - from.y) * k / 1000.0 - items[id]->y;
+                        best = std::min(best, std::hypot(x, y));
+                    }
+                    if (best <= radius - 0.05) {
+                        expected.emplace_back(s, id);
+                    }
+                }
+            }
+            // Каждый явно близкий предмет найден, найденные не дальше радиуса
+            for (const auto& pair : expected) {
+                CHECK(std::binary_search(found.begin(), found.end(), pair));
+            }
+            CHECK(found.size() >= expected.size());
+            CHECK(found.size() <= expected.size() + 10);
+        }
+    }
+    GIVEN("a map with offices") {
+        model::Map map{model::Map::Id{"map1"s}, "Map 1"s};
+        map.AddRoad(model::Road{model::Road::HORIZONTAL, {0, 0}, 40});
+        map.BildListOderedPath();
+        map.AddOffice(model::Office{model::Office::Id{"o1"s}, {10, 0}, {0, 0}});
+        map.AddOffice(model::Office{model::Office::Id{"o2"s}, {30, 1}, {0, 0}});
+
+        THEN("offices along a dog's segment are found in one query") {
+            std::vector<size_t> offices;
+            map.ForEachOfficeNear({{5, 0.2}, {31, 0.2}}, 0.55, [&offices](size_t office) {
+                offices.push_back(office);
+            });
+            CHECK(offices == std::vector<size_t>{0});
+            offices.clear();
+            map.ForEachOfficeNear({{5, 0.5}, {31, 0.5}}, 0.55, [&offices](size_t office) {
+                offices.push_back(office);
+            });
+            std::sort(offices.begin(), offices.end());
+            CHECK(offices == std::vector<size_t>{0, 1});
+        }
+    }
+}
+
+SCENARIO("Lazy maps") {
+    GIVEN("a game with an eager map and a lazy map") {
+        model::Game game{false};
+        game.AddMap(model::Map{model::Map::Id{"map1"s}, "Map 1"s});
+        int loads = 0;
+        bool fail = true;
+        game.AddLazyMap(model::Map::Id{"map2"s}, "Map 2"s, [&] {
+            ++loads;
+            if (std::exchange(fail, false)) {
+                throw std::runtime_error("broken map"s);
+            }
+            model::Map map{model::Map::Id{"map2"s}, "Map 2"s};
+            map.AddRoad(model::Road{model::Road::HORIZONTAL, {0, 0}, 10});
+            map.BildListOderedPath();
+            return map;
+        });
+
+        THEN("the catalog lists both maps without building the lazy one") {
+            const auto& headers = game.GetMapHeaders();
+            REQUIRE(headers.size() == 2);
+            CHECK(*headers[1].id == "map2"s);
+            CHECK(headers[1].name == "Map 2"s);
+            CHECK(loads == 0);
+        }
+        THEN("the lazy map is built on first lookup, a failed build is retried") {
+            CHECK_THROWS_AS(game.FindMap(model::Map::Id{"map2"s}), std::runtime_error);
+            const auto* map = game.FindMap(model::Map::Id{"map2"s});
+            REQUIRE(map != nullptr);
+            CHECK(map->GetRoads().size() == 1);
+            CHECK(game.FindMap(model::Map::Id{"map2"s}) == map);
+            CHECK(&game.GetMap(1) == map);
+            CHECK(loads == 2);
+            CHECK(game.FindMap(model::Map::Id{"map3"s}) == nullptr);
+        }
+    }
+    GIVEN("a lazy map whose loader builds another map") {
+        model::Game game{false};
+        game.AddLazyMap(model::Map::Id{"map1"s}, "Map 1"s, [] {
+            return model::Map{model::Map::Id{"map2"s}, "Map 1"s};
+        });
+        game.AddLazyMap(model::Map::Id{"map2"s}, "Map 2"s, [] {
+            return model::Map{model::Map::Id{"map2"s}, "Other"s};
+        });
+
+        THEN("the map is rejected and not published") {
+            CHECK_THROWS_AS(game.GetMap(0), std::runtime_error);
+            CHECK_THROWS_AS(game.GetMap(1), std::runtime_error);
+            CHECK_FALSE(game.IsMapLoaded(model::Map::Id{"map1"s}));
+            CHECK_FALSE(game.IsMapLoaded(model::Map::Id{"map2"s}));
+        }
+    }
+    GIVEN("a lazy map that is slow to build") {
+        model::Game game{false};
+        std::promise<void> slow_started;
+        std::promise<void> other_built;
+        auto other_built_future = other_built.get_future();
+        bool waited = false;
+        game.AddLazyMap(model::Map::Id{"slow"s}, "Slow"s, [&] {
+            // Пока строится эта карта, в другом потоке строится соседняя
+            slow_started.set_value();
+            waited = other_built_future.wait_for(5s) == std::future_status::ready;
+            return model::Map{model::Map::Id{"slow"s}, "Slow"s};
+        });
+        game.AddLazyMap(model::Map::Id{"fast"s}, "Fast"s, [] {
+            return model::Map{model::Map::Id{"fast"s}, "Fast"s};
+        });
+
+        THEN("other maps are built without waiting for it") {
+            std::thread slow{[&] {
+                game.GetMap(0);
+            }};
+            slow_started.get_future().wait();
+            game.GetMap(1);
+            other_built.set_value();
+            slow.join();
+            CHECK(waited);
+            CHECK(game.IsMapLoaded(model::Map::Id{"slow"s}));
+        }
+    }
+}
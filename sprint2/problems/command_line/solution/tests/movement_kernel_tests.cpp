@@ -0,0 +1,112 @@
+#include <cstring>
+#include <random>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/movement_kernel.h"
+
+namespace {
+
+struct Dogs {
+    std::vector<double> pos_x, pos_y, speed_x, speed_y, bound_min, bound_max;
+
+    movement::DogArrays GetArrays() {
+        return {pos_x.data(), pos_y.data(), speed_x.data(), speed_y.data(),
+                bound_min.data(), bound_max.data(), pos_x.size()};
+    }
+};
+
+// Собаки на дорогах: стоящие, движущиеся по горизонтали и вертикали,
+// в том числе стоящие ровно на краю пути
+Dogs MakeDogs(size_t count) {
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> cell(-50, 50);
+    std::uniform_int_distribution<int> length(0, 3);
+    std::uniform_real_distribution<double> offset(-0.4, 0.4);
+    std::uniform_int_distribution<int> kind(0, 5);
+    const double speeds[] = {0.0, 1.0, -1.0, 3.3, -3.3, 0.1};
+
+    Dogs dogs;
+    for (size_t i = 0; i < count; ++i) {
+        const int begin = cell(generator);
+        const int end = begin + length(generator);
+        dogs.bound_min.push_back(-0.4 + begin);
+        dogs.bound_max.push_back(0.4 + end);
+        const double along = kind(generator) == 0 ? dogs.bound_max.back() : begin + offset(generator);
+        const double level = cell(generator);
+        const double speed = speeds[kind(generator)];
+        if (kind(generator) % 2 == 0) {
+            dogs.pos_x.push_back(along);
+            dogs.pos_y.push_back(level);
+            dogs.speed_x.push_back(speed);
+            dogs.speed_y.push_back(0.0);
+        } else {
+            dogs.pos_x.push_back(level);
+            dogs.pos_y.push_back(along);
+            dogs.speed_x.push_back(0.0);
+            dogs.speed_y.push_back(speed);
+        }
+    }
+    return dogs;
+}
+
+bool SameBits(const std::vector<double>& lhs, const std::vector<double>& rhs) {
+    return lhs.size() == rhs.size() && std::memcmp(lhs.data(), rhs.data(), lhs.size() * sizeof(double)) == 0;
+}
+
+} // namespace
+
+SCENARIO("Batched dog movement") {
+    GIVEN("dogs moving along roads") {
+        // Нечётное количество, чтобы задействовать и скалярный хвост
+        const Dogs initial = MakeDogs(10007);
+
+        Dogs expected = initial;
+        movement::Integrate(expected.GetArrays(), 0.5, movement::Isa::Scalar);
+
+        THEN("moving dogs advance until the end of their path, stopped dogs stay in place") {
+            for (size_t i = 0; i < initial.pos_x.size(); ++i) {
+                const bool horizontal = initial.speed_x[i] != 0.0;
+                const double speed = horizontal ? initial.speed_x[i] : initial.speed_y[i];
+                const double point1 = horizontal ? initial.pos_x[i] : initial.pos_y[i];
+                const double point2 = horizontal ? expected.pos_x[i] : expected.pos_y[i];
+                if (speed == 0.0) {
+                    CHECK(expected.pos_x[i] == initial.pos_x[i]);
+                    CHECK(expected.pos_y[i] == initial.pos_y[i]);
+                } else if (point1 + speed * 0.5 >= initial.bound_max[i] || point1 + speed * 0.5 <= initial.bound_min[i]) {
+                    CHECK((point2 == initial.bound_max[i] || point2 == initial.bound_min[i]));
+                    CHECK(expected.speed_x[i] == 0.0);
+                    CHECK(expected.speed_y[i] == 0.0);
+                } else {
+                    CHECK(point2 == point1 + speed * 0.5);
+                    CHECK(expected.speed_x[i] == initial.speed_x[i]);
+                    CHECK(expected.speed_y[i] == initial.speed_y[i]);
+                }
+            }
+        }
+
+        auto check_isa = [&initial, &expected](movement::Isa isa) {
+            if (!movement::IsSupported(isa)) {
+                return;
+            }
+            Dogs actual = initial;
+            movement::Integrate(actual.GetArrays(), 0.5, isa);
+
+            CHECK(SameBits(actual.pos_x, expected.pos_x));
+            CHECK(SameBits(actual.pos_y, expected.pos_y));
+            CHECK(SameBits(actual.speed_x, expected.speed_x));
+            CHECK(SameBits(actual.speed_y, expected.speed_y));
+        };
+
+        WHEN("the SSE2 kernel is used") {
+            THEN("the result is bit-identical to the scalar one") {
+                check_isa(movement::Isa::Sse2);
+            }
+        }
+        WHEN("the AVX2 kernel is used") {
+            THEN("the result is bit-identical to the scalar one") {
+                check_isa(movement::Isa::Avx2);
+            }
+        }
+    }
+}
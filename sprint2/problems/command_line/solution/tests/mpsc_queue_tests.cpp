@@ -0,0 +1,97 @@
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/mpsc_queue.h"
+
+using namespace std::literals;
+
+namespace {
+
+struct Item {
+    size_t producer;
+    size_t seq;
+};
+
+// Элемент, который помнит, сколько его копий ещё живо
+using Tracked = std::shared_ptr<int>;
+
+} // namespace
+
+SCENARIO("MPSC queue") {
+    GIVEN("producers pushing concurrently with a consumer") {
+        constexpr size_t PRODUCERS = 4;
+        constexpr size_t ITEMS = 20'000;
+        util::MpscQueue<Item> queue;
+        std::atomic<size_t> finished{0};
+        std::vector<std::jthread> producers;
+        for (size_t producer = 0; producer < PRODUCERS; ++producer) {
+            producers.emplace_back([&queue, &finished, producer] {
+                for (size_t seq = 0; seq < ITEMS; ++seq) {
+                    queue.Push({producer, seq});
+                }
+                finished.fetch_add(1);
+            });
+        }
+
+        std::vector<size_t> next(PRODUCERS, 0);
+        size_t received = 0;
+        bool in_order = true;
+        auto consume = [&](Item&& item) {
+            in_order = in_order && item.seq == next[item.producer];
+            next[item.producer] = item.seq + 1;
+            ++received;
+        };
+        while (finished.load() < PRODUCERS) {
+            queue.Drain(consume);
+        }
+        queue.Drain(consume);
+
+        THEN("nothing is lost and each producer's items come in push order") {
+            CHECK(received == PRODUCERS * ITEMS);
+            CHECK(in_order);
+            CHECK(next == std::vector<size_t>(PRODUCERS, ITEMS));
+            CHECK(queue.Empty());
+            CHECK(queue.Drain(consume) == 0);
+        }
+    }
+    GIVEN("a queue destroyed with undrained items") {
+        const auto token = std::make_shared<int>(0);
+        {
+            util::MpscQueue<Tracked> queue;
+            for (int i = 0; i < 10; ++i) {
+                queue.Push(token);
+            }
+            REQUIRE(token.use_count() == 11);
+        }
+
+        THEN("the items are freed") {
+            CHECK(token.use_count() == 1);
+        }
+    }
+    GIVEN("a drain callback that throws") {
+        const auto token = std::make_shared<int>(0);
+        util::MpscQueue<Tracked> queue;
+        for (int i = 0; i < 10; ++i) {
+            queue.Push(token);
+        }
+        int calls = 0;
+        CHECK_THROWS_AS(queue.Drain([&calls](Tracked&&) {
+            if (++calls == 3) {
+                throw std::runtime_error("fail"s);
+            }
+        }), std::runtime_error);
+
+        THEN("the remaining drained items are freed and the queue stays usable") {
+            CHECK(calls == 3);
+            CHECK(token.use_count() == 1);
+            CHECK(queue.Empty());
+            queue.Push(token);
+            CHECK(queue.Drain([](Tracked&&) {}) == 1);
+            CHECK(token.use_count() == 1);
+        }
+    }
+}
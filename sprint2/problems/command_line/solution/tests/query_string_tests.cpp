@@ -0,0 +1,123 @@
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/query_string.h"
+
+using namespace std::literals;
+
+namespace {
+
+using Items = std::vector<std::pair<std::string, std::string>>;
+
+Items GetItems(std::string_view query) {
+    Items items;
+    for (const auto& param : query_string::Params{query}) {
+        items.emplace_back(param.GetKey(), param.GetRawValue());
+    }
+    return items;
+}
+
+} // namespace
+
+SCENARIO("Request target splitting") {
+    THEN("the query follows the first question mark") {
+        CHECK(query_string::SplitTarget("/api/v1/maps"sv) == std::pair{"/api/v1/maps"sv, ""sv});
+        CHECK(query_string::SplitTarget("/api/v1/maps?"sv) == std::pair{"/api/v1/maps"sv, ""sv});
+        CHECK(query_string::SplitTarget("/a?b=1?c=2"sv) == std::pair{"/a"sv, "b=1?c=2"sv});
+    }
+}
+
+SCENARIO("Query parameter values") {
+    GIVEN("percent-encoded values") {
+        THEN("escapes and '+' are decoded") {
+            CHECK(query_string::Param{"k"sv, "a+b%20c%2B%2b"sv}.GetValue() == "a b c++"s);
+            CHECK(query_string::Param{"k"sv, ""sv}.GetValue() == ""s);
+            CHECK(query_string::Param{"k"sv, "%41%7a"sv}.GetValue() == "Az"s);
+        }
+        THEN("truncated or non-hex escapes are rejected") {
+            for (const auto raw : {"%"sv, "%4"sv, "ab%"sv, "ab%4"sv, "%zz"sv, "%4g"sv, "%g4"sv}) {
+                CHECK_FALSE(query_string::Param{"k"sv, raw}.GetValue());
+                CHECK_FALSE(query_string::Param{"k"sv, raw}.GetValueAsSize());
+            }
+        }
+    }
+    GIVEN("sizes") {
+        auto size = [](std::string_view raw) {
+            return query_string::Param{"k"sv, raw}.GetValueAsSize();
+        };
+
+        THEN("only decimal digits are accepted") {
+            CHECK(size("0"sv) == 0u);
+            CHECK(size("0042"sv) == 42u);
+            CHECK(size("%31%32"sv) == 12u);
+            CHECK_FALSE(size(""sv));
+            CHECK_FALSE(size("-1"sv));
+            CHECK_FALSE(size("+1"sv));
+            CHECK_FALSE(size("1 "sv));
+            CHECK_FALSE(size("12a"sv));
+            CHECK_FALSE(size("1.5"sv));
+        }
+        THEN("values that do not fit size_t are rejected") {
+            const auto max = std::numeric_limits<size_t>::max();
+            CHECK(size(std::to_string(max)) == max);
+            // max + 1 и max * 10
+            auto over = std::to_string(max);
+            ++over.back();
+            CHECK_FALSE(size(over));
+            CHECK_FALSE(size(std::to_string(max) + "0"s));
+        }
+    }
+}
+
+SCENARIO("Query parameters") {
+    GIVEN("a query with empty items and keys without values") {
+        const query_string::Params params{"a=1&&b=x%3D1&c&=5&a=2&"sv};
+
+        THEN("empty items are skipped and a key without '=' has an empty value") {
+            CHECK(GetItems("a=1&&b=x%3D1&c&=5&a=2&"sv)
+                  == Items{{"a"s, "1"s}, {"b"s, "x%3D1"s}, {"c"s, ""s}, {""s, "5"s}, {"a"s, "2"s}});
+            CHECK(GetItems(""sv).empty());
+            CHECK(GetItems("&&&"sv).empty());
+        }
+        THEN("Find returns the first parameter with the key") {
+            REQUIRE(params.Find("a"sv));
+            CHECK(params.Find("a"sv)->GetRawValue() == "1"sv);
+            CHECK(params.Find("b"sv)->GetValue() == "x=1"s);
+            CHECK(params.Find("c"sv)->GetRawValue().empty());
+            CHECK(params.Find(""sv)->GetRawValue() == "5"sv);
+            CHECK_FALSE(params.Find("d"sv));
+        }
+        THEN("iterators at the same item compare equal") {
+            CHECK(params.begin() == params.begin());
+            CHECK(params.begin() != params.end());
+            auto it = params.begin();
+            const auto prev = it++;
+            CHECK(prev == params.begin());
+            CHECK(it != prev);
+            CHECK(it->GetKey() == "b"sv);
+            for (int i = 0; i < 4; ++i) {
+                ++it;
+            }
+            CHECK(it == params.end());
+            CHECK(query_string::Params{""sv}.begin() == query_string::Params{""sv}.end());
+            CHECK(query_string::Params{"&&"sv}.begin() == query_string::Params{"&&"sv}.end());
+        }
+    }
+    GIVEN("percent-encoded keys") {
+        const query_string::Params params{"max%49tems=3&st%61rt=1&bad%4=2"sv};
+
+        THEN("keys are matched after decoding") {
+            CHECK(params.begin()->GetKey() == "max%49tems"sv);
+            CHECK(params.begin()->HasKey("maxItems"sv));
+            CHECK_FALSE(params.begin()->HasKey("max%49tems"sv));
+            CHECK_FALSE(params.begin()->HasKey("max"sv));
+            CHECK_FALSE(params.begin()->HasKey("maxItemsX"sv));
+            CHECK(params.Find("maxItems"sv)->GetValueAsSize() == 3u);
+            CHECK(params.Find("start"sv)->GetValueAsSize() == 1u);
+            CHECK_FALSE(params.Find("bad"sv));
+        }
+    }
+}
@@ -0,0 +1,74 @@
+#include <string>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/rate_limiter.h"
+
+using namespace std::literals;
+
+SCENARIO("Token bucket") {
+    GIVEN("a bucket of 3 requests refilled at 10 requests per second") {
+        rate_limiter::TokenBucket bucket{{10.0, 3.0}};
+        const rate_limiter::Clock::time_point now{1h};
+
+        THEN("a burst drains it and the tokens come back with time") {
+            CHECK(bucket.IsFull(now));
+            CHECK(bucket.TryConsume(now));
+            CHECK(bucket.TryConsume(now));
+            CHECK(bucket.TryConsume(now));
+            CHECK_FALSE(bucket.TryConsume(now));
+            CHECK_FALSE(bucket.IsFull(now));
+            CHECK(bucket.TryConsume(now + 100ms));
+            CHECK_FALSE(bucket.TryConsume(now + 100ms));
+            CHECK(bucket.IsFull(now + 1s));
+        }
+        THEN("reset refills it") {
+            while (bucket.TryConsume(now)) {
+            }
+            bucket.Reset();
+            CHECK(bucket.IsFull(now));
+            CHECK(bucket.TryConsume(now));
+        }
+    }
+    GIVEN("a bucket without a rate") {
+        rate_limiter::TokenBucket bucket{{}};
+
+        THEN("it never runs out") {
+            for (int i = 0; i < 100; ++i) {
+                CHECK(bucket.TryConsume(rate_limiter::Clock::time_point{}));
+            }
+        }
+    }
+}
+
+SCENARIO("Rate limiter by IP address") {
+    GIVEN("a limiter of one request per second tracking 3 addresses") {
+        rate_limiter::IpRateLimiter limiter{{1.0, 1.0}, 3};
+        const rate_limiter::Clock::time_point now{1h};
+
+        THEN("every address has its own bucket") {
+            CHECK(limiter.TryConsume("10.0.0.1"sv, now));
+            CHECK(limiter.TryConsume("10.0.0.2"sv, now));
+            CHECK_FALSE(limiter.TryConsume("10.0.0.1"sv, now));
+            CHECK_FALSE(limiter.TryConsume("10.0.0.2"sv, now));
+            CHECK(limiter.GetTrackedCount() == 2);
+        }
+        THEN("the number of buckets never exceeds the capacity") {
+            for (int i = 0; i < 1000; ++i) {
+                limiter.TryConsume("10.0.1."s + std::to_string(i), now);
+                REQUIRE(limiter.GetTrackedCount() <= 3);
+            }
+        }
+        THEN("the least recently seen address is evicted first") {
+            CHECK(limiter.TryConsume("10.0.0.1"sv, now));
+            CHECK(limiter.TryConsume("10.0.0.2"sv, now));
+            CHECK(limiter.TryConsume("10.0.0.3"sv, now));
+            // Адрес 1 снова активен, поэтому при переполнении вытесняется адрес 2
+            CHECK_FALSE(limiter.TryConsume("10.0.0.1"sv, now));
+            CHECK(limiter.TryConsume("10.0.0.4"sv, now));
+            CHECK(limiter.GetTrackedCount() == 3);
+            CHECK_FALSE(limiter.TryConsume("10.0.0.1"sv, now));
+            CHECK_FALSE(limiter.TryConsume("10.0.0.3"sv, now));
+            CHECK_FALSE(limiter.TryConsume("10.0.0.4"sv, now));
+        }
+    }
+}
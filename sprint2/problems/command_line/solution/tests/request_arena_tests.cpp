@@ -0,0 +1,124 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/application.h"
+#include "../src/boost_json.h"
+#include "../src/request_arena.h"
+#include "../src/request_handler.h"
+#include "support/counting_allocator.h"
+
+using namespace std::literals;
+
+SCENARIO("Request arena") {
+    GIVEN("a game session with several players") {
+        model::Game game{false};
+        model::Map map{model::Map::Id{"map1"s}, "Map 1"s};
+        map.AddRoad(model::Road{model::Road::HORIZONTAL, {0, 0}, 40});
+        map.AddRoad(model::Road{model::Road::VERTICAL, {40, 0}, 30});
+        map.BildListOderedPath();
+        map.SetDogSpeed(1.0);
+        game.AddMap(std::move(map));
+
+        app::Application app{game};
+        constexpr size_t PLAYERS_COUNT = 20;
+        std::string token;
+        for (size_t i = 0; i < PLAYERS_COUNT; ++i) {
+            // Имена длиннее буфера короткой строки, чтобы копирование имени требовало памяти
+            auto result = app.AddPlayer("a player with a rather long name #"s + std::to_string(i), "map1"s);
+            token = *result.token;
+        }
+        app.SetDogDirect(token, 'R');
+        app.ChangeGameSate(100ms);
+
+        auto handle_request = [&app, &token](size_t& states, size_t& players) {
+            util::RequestArena arena;
+            auto state = app.GetGameSate(token, {}, arena.GetResource());
+            auto list = app.GetPlayersListForUser(token, {}, arena.GetResource());
+            states = state.size();
+            players = list.size();
+        };
+
+        WHEN("requests are handled in a request arena") {
+            size_t states = 0;
+            size_t players = 0;
+            handle_request(states, players); // первый запрос выделяет блок арены для потока
+
+            const size_t allocations_before = test_support::GetAllocationCount();
+            for (int i = 0; i < 100; ++i) {
+                handle_request(states, players);
+            }
+            const size_t allocations = test_support::GetAllocationCount() - allocations_before;
+
+            THEN("results are complete") {
+                CHECK(states == PLAYERS_COUNT);
+                CHECK(players == PLAYERS_COUNT);
+            }
+            THEN("steady state does not touch the heap") {
+                CHECK(allocations == 0);
+            }
+        }
+
+        WHEN("state and player list requests go through the API handler") {
+            namespace http = http_handler::http;
+            http_handler::ApiHandler handler{app, false, {}};
+            auto make_request = [&token](std::string_view target) {
+                http_handler::StringRequest req{http::verb::get, target, 11};
+                req.set(http::field::authorization, "Bearer "s + token);
+                return req;
+            };
+            const auto state_request = make_request("/api/v1/game/state"sv);
+            const auto players_request = make_request("/api/v1/game/players?start=0&maxItems=100"sv);
+            // Выделения при обработке запроса: JSON и ответ строятся в арене,
+            // в кучу попадают только копия тела и заголовки ответа
+            auto count_request = [&handler](const http_handler::StringRequest& req, std::string& body) {
+                const size_t allocations_before = test_support::GetAllocationCount();
+                {
+                    const auto response = handler.HandleApiRequest(req);
+                    body = std::get<http_handler::StringResponse>(response).body();
+                }
+                // Копия тела в body не выделяет память: её ёмкость выросла при первом запросе
+                return test_support::GetAllocationCount() - allocations_before;
+            };
+            // Выделения при построении такого же ответа из готового тела
+            auto count_response = [](const http_handler::StringRequest& req, const std::string& body) {
+                const size_t allocations_before = test_support::GetAllocationCount();
+                {
+                    const auto response = http_handler::MakeStringResponse(http::status::ok, body, req.version()
+                                                                           , req.keep_alive(), req.method());
+                }
+                return test_support::GetAllocationCount() - allocations_before;
+            };
+
+            std::string state_body;
+            std::string players_body;
+            count_request(state_request, state_body); // первый запрос выделяет блок арены для потока
+            count_request(players_request, players_body);
+
+            THEN("only the response body copy and headers touch the heap") {
+                for (int i = 0; i < 10; ++i) {
+                    CHECK(count_request(state_request, state_body) == count_response(state_request, state_body));
+                    CHECK(count_request(players_request, players_body) == count_response(players_request, players_body));
+                }
+                util::RequestArena arena;
+                const auto mr = arena.GetResource();
+                CHECK(state_body == std::string_view(boost_json::GetGameSateJsonBody(app.GetGameSate(token, {}, mr), mr)));
+                CHECK(players_body == std::string_view(
+                    boost_json::GetPlayersJsonBody(app.GetPlayersListForUser(token, {}, mr), mr)));
+            }
+        }
+
+        WHEN("an arena is created inside another one") {
+            util::RequestArena outer;
+            const size_t allocations_before = test_support::GetAllocationCount();
+            size_t states = 0;
+            size_t players = 0;
+            handle_request(states, players);
+            const size_t allocations = test_support::GetAllocationCount() - allocations_before;
+
+            THEN("the nested arena falls back to the heap and still works") {
+                CHECK(states == PLAYERS_COUNT);
+                CHECK(players == PLAYERS_COUNT);
+                CHECK(allocations > 0);
+            }
+        }
+    }
+}
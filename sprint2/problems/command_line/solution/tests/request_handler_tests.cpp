@@ -0,0 +1,284 @@
+#include <limits>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <variant>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/boost_json.h"
+#include "../src/request_handler.h"
+
+using namespace std::literals;
+
+namespace {
+
+namespace http = http_handler::http;
+
+model::Map MakeMap(std::string id, std::string name, int length) {
+    model::Map map{model::Map::Id{std::move(id)}, std::move(name)};
+    map.AddRoad(model::Road{model::Road::HORIZONTAL, {0, 0}, length});
+    map.BildListOderedPath();
+    return map;
+}
+
+http_handler::StringRequest MakeRequest(http::verb method, std::string_view target) {
+    http_handler::StringRequest req{method, target, 11};
+    req.keep_alive(true);
+    return req;
+}
+
+// Запрос игрока с токеном token
+http_handler::StringRequest MakePlayerRequest(std::string_view target, std::string_view token) {
+    auto req = MakeRequest(http::verb::get, target);
+    req.set(http::field::authorization, "Bearer "s + std::string(token));
+    return req;
+}
+
+// Строковый ответ или исключение, если обработчик вернул ответ с общим телом
+const http_handler::StringResponse& GetString(const http_handler::ApiResponse& response) {
+    if (const auto* string = std::get_if<http_handler::StringResponse>(&response)) {
+        return *string;
+    }
+    throw std::logic_error("Response body is shared"s);
+}
+
+// Ответ с общим телом или исключение, если обработчик вернул строковый ответ
+const http_handler::SharedResponse& GetShared(const http_handler::ApiResponse& response) {
+    if (const auto* shared = std::get_if<http_handler::SharedResponse>(&response)) {
+        return *shared;
+    }
+    throw std::logic_error("Response body is not shared"s);
+}
+
+} // namespace
+
+SCENARIO("Prebuilt map bodies") {
+    GIVEN("a handler for a game with a built map and a lazy map") {
+        model::Game game{false};
+        game.AddMap(MakeMap("map1"s, "Map 1"s, 40));
+        int loads = 0;
+        game.AddLazyMap(model::Map::Id{"map2"s}, "Map 2"s, [&] {
+            ++loads;
+            return MakeMap("map2"s, "Map 2"s, 20);
+        });
+        app::Application app{game};
+        http_handler::ApiHandler handler{app, false, {}};
+
+        THEN("creating the handler does not build the lazy map") {
+            CHECK(loads == 0);
+            CHECK_FALSE(app.IsMapLoaded("map2"sv));
+        }
+        THEN("the map list body is the serialized catalog") {
+            const auto response = handler.HandleApiRequest(MakeRequest(http::verb::get, "/api/v1/maps"sv));
+            const auto& shared = GetShared(response);
+            CHECK(shared.result() == http::status::ok);
+            REQUIRE(shared.body() != nullptr);
+            CHECK(*shared.body() == boost_json::GetMapsJson(app.ListMaps()));
+            CHECK(loads == 0);
+        }
+        THEN("a built map body is the serialized map and is shared by all responses") {
+            const auto first = handler.HandleApiRequest(MakeRequest(http::verb::get, "/api/v1/maps/map1"sv));
+            const auto second = handler.HandleApiRequest(MakeRequest(http::verb::get, "/api/v1/maps/map1"sv));
+            const auto& body = GetShared(first).body();
+            REQUIRE(body != nullptr);
+            CHECK(*body == boost_json::GetMapJson(app.GetMapInfo("map1"sv)));
+            CHECK(GetShared(first)[http::field::content_length] == std::to_string(body->size()));
+            CHECK(GetShared(second).body() == body);
+            CHECK(GetShared(first)[http::field::content_type] == http_handler::ContentType::APP_JSON);
+        }
+        THEN("a lazy map body is built on the first request and then shared") {
+            const auto first = handler.HandleApiRequest(MakeRequest(http::verb::get, "/api/v1/maps/map2"sv));
+            CHECK(loads == 1);
+            const auto& body = GetShared(first).body();
+            REQUIRE(body != nullptr);
+            CHECK(*body == boost_json::GetMapJson(app.GetMapInfo("map2"sv)));
+            const auto second = handler.HandleApiRequest(MakeRequest(http::verb::get, "/api/v1/maps/map2"sv));
+            CHECK(GetShared(second).body() == body);
+            CHECK(loads == 1);
+        }
+        THEN("a HEAD response has the length of the body but no body") {
+            const auto get = handler.HandleApiRequest(MakeRequest(http::verb::get, "/api/v1/maps/map1"sv));
+            const auto head = handler.HandleApiRequest(MakeRequest(http::verb::head, "/api/v1/maps/map1"sv));
+            const auto& shared = GetShared(head);
+            CHECK(shared.result() == http::status::ok);
+            CHECK(shared.body() == nullptr);
+            CHECK(http_handler::SharedBody::size(shared.body()) == 0);
+            CHECK(shared[http::field::content_length] == std::to_string(GetShared(get).body()->size()));
+        }
+        THEN("an unknown map id gets 404 without building any map") {
+            const auto response = handler.HandleApiRequest(MakeRequest(http::verb::get, "/api/v1/maps/map3"sv));
+            const auto* error = std::get_if<http_handler::StringResponse>(&response);
+            REQUIRE(error != nullptr);
+            CHECK(error->result() == http::status::not_found);
+            CHECK(error->body() == boost_json::GetErrorMes("mapNotFound"sv, "Map not found"sv));
+            CHECK(loads == 0);
+        }
+    }
+}
+
+SCENARIO("Pagination parameters") {
+    GIVEN("a handler for a session with 5 players") {
+        model::Game game{false};
+        game.AddMap(MakeMap("map1"s, "Map 1"s, 40));
+        app::Application app{game};
+        http_handler::ApiHandler handler{app, false, {}};
+        std::string token;
+        for (int i = 0; i < 5; ++i) {
+            token = *app.AddPlayer("player"s + std::to_string(i), "map1"s).token;
+        }
+        std::pmr::memory_resource* mr = std::pmr::get_default_resource();
+        auto players = [&](std::string_view target) {
+            return GetString(handler.HandleApiRequest(MakePlayerRequest(target, token)));
+        };
+        auto expected_players = [&](app::Page page) {
+            return std::string(boost_json::GetPlayersJsonBody(app.GetPlayersListForUser(token, page, mr), mr));
+        };
+
+        THEN("the page range is clamped to the list") {
+            CHECK(app::Page{}.GetRange(5) == std::pair<size_t, size_t>{0, 5});
+            CHECK(app::Page{1, 2}.GetRange(5) == std::pair<size_t, size_t>{1, 3});
+            CHECK(app::Page{4, 10}.GetRange(5) == std::pair<size_t, size_t>{4, 5});
+            CHECK(app::Page{7, 2}.GetRange(5) == std::pair<size_t, size_t>{5, 5});
+            CHECK(app::Page{2, 0}.GetRange(5) == std::pair<size_t, size_t>{2, 2});
+            CHECK(app::Page{0, std::numeric_limits<size_t>::max()}.GetRange(5) == std::pair<size_t, size_t>{0, 5});
+        }
+        THEN("start and maxItems select a part of the list") {
+            const auto& page = players("/api/v1/game/players?start=1&maxItems=2"sv);
+            CHECK(page.result() == http::status::ok);
+            CHECK(page.body() == expected_players({1, 2}));
+            CHECK(page.body() != expected_players({}));
+            CHECK(players("/api/v1/game/players"sv).body() == expected_players({}));
+            CHECK(players("/api/v1/game/players?start=3"sv).body() == expected_players({3, std::nullopt}));
+            CHECK(players("/api/v1/game/players?maxItems=0"sv).body() == expected_players({0, 0}));
+            CHECK(players("/api/v1/game/players?start=10&maxItems=18446744073709551615"sv).body()
+                  == expected_players({5, 0}));
+            CHECK(players("/api/v1/game/players?st%61rt=2&max%49tems=1&unknown"sv).body() == expected_players({2, 1}));
+            CHECK(players("/api/v1/game/state?start=1&maxItems=2"sv).body()
+                  == std::string(boost_json::GetGameSateJsonBody(app.GetGameSate(token, {1, 2}, mr), mr)));
+        }
+        THEN("invalid values get 400 invalidArgument") {
+            const auto error = boost_json::GetErrorMes("invalidArgument"sv, "Invalid pagination parameters"sv);
+            for (const auto target : {"/api/v1/game/players?start=-1"sv, "/api/v1/game/players?start="sv
+                                      , "/api/v1/game/players?maxItems"sv, "/api/v1/game/players?maxItems=1.5"sv
+                                      , "/api/v1/game/players?start=%zz"sv, "/api/v1/game/players?start=1%"sv
+                                      , "/api/v1/game/players?start=18446744073709551616"sv
+                                      , "/api/v1/game/state?maxItems=two"sv}) {
+                const auto& response = players(target);
+                CHECK(response.result() == http::status::bad_request);
+                CHECK(response.body() == error);
+            }
+        }
+    }
+}
+
+SCENARIO("View parameters") {
+    GIVEN("a handler for a session with players spread along a road") {
+        model::Game game{true};
+        game.AddMap(MakeMap("map1"s, "Map 1"s, 40));
+        app::Application app{game};
+        app.SetRandomSeed(42);
+        http_handler::ApiHandler handler{app, false, {}};
+        std::string token;
+        for (int i = 0; i < 10; ++i) {
+            token = *app.AddPlayer("player"s + std::to_string(i), "map1"s).token;
+        }
+        app.ChangeGameSate(0ms); // публикует снимок сессии
+        std::pmr::memory_resource* mr = std::pmr::get_default_resource();
+        auto state = [&](std::string_view target) {
+            return GetString(handler.HandleApiRequest(MakePlayerRequest(target, token)));
+        };
+        auto expected_state = [&](app::Page page, app::game_state::View view) {
+            return std::string(boost_json::GetGameSateJsonBody(app.GetGameSate(token, page, mr, view), mr));
+        };
+        const model::Area left_half{0, -1, 20, 1};
+
+        THEN("radius and bbox limit the dogs in the response") {
+            const auto all = expected_state({}, {});
+            const auto left = expected_state({}, {left_half, std::nullopt});
+            CHECK(left != all);
+            CHECK(left != expected_state({}, {model::Area{20, -1, 40, 1}, std::nullopt}));
+            CHECK(state("/api/v1/game/state?bbox=0,-1,20,1"sv).body() == left);
+            CHECK(state("/api/v1/game/state?bbox=0%2C-1%2C20%2C1"sv).body() == left);
+            CHECK(state("/api/v1/game/state?radius=5.5"sv).body() == expected_state({}, {std::nullopt, 5.5}));
+            CHECK(state("/api/v1/game/state?radius=0"sv).body() == expected_state({}, {std::nullopt, 0.0}));
+        }
+        THEN("swapped bbox corners are normalised") {
+            const auto left = expected_state({}, {left_half, std::nullopt});
+            CHECK(state("/api/v1/game/state?bbox=20,1,0,-1"sv).body() == left);
+            CHECK(state("/api/v1/game/state?bbox=0,1,20,-1"sv).body() == left);
+        }
+        THEN("bbox is combined with pagination") {
+            const auto page = expected_state({1, 2}, {left_half, std::nullopt});
+            CHECK(page != expected_state({}, {left_half, std::nullopt}));
+            CHECK(state("/api/v1/game/state?start=1&bbox=0,-1,20,1&maxItems=2"sv).body() == page);
+            CHECK(state("/api/v1/game/state?bbox=0,-1,20,1&start=100"sv).body()
+                  == expected_state({100, std::nullopt}, {left_half, std::nullopt}));
+        }
+        THEN("a value longer than the decoding buffer is accepted only if it decodes into it") {
+            // 300 символов в запросе, но 100 после декодирования
+            std::string encoded;
+            for (int i = 0; i < 98; ++i) {
+                encoded += "%30"s;
+            }
+            CHECK(state("/api/v1/game/state?radius="s + encoded + "12"s).body()
+                  == expected_state({}, {std::nullopt, 12.0}));
+            const auto long_value = "0,-1,20,"s + std::string(300, '0') + "1"s;
+            CHECK(state("/api/v1/game/state?bbox="s + long_value).result() == http::status::bad_request);
+        }
+        THEN("invalid values get 400 invalidArgument") {
+            const auto error = boost_json::GetErrorMes("invalidArgument"sv, "Invalid view parameters"sv);
+            for (const auto target : {"/api/v1/game/state?radius=-1"sv, "/api/v1/game/state?radius=-0.5"sv
+                                      , "/api/v1/game/state?radius=nan"sv, "/api/v1/game/state?radius=inf"sv
+                                      , "/api/v1/game/state?radius=1e400"sv, "/api/v1/game/state?radius="sv
+                                      , "/api/v1/game/state?radius=5m"sv
+                                      , "/api/v1/game/state?bbox=0,0,10"sv, "/api/v1/game/state?bbox=0,0,10,10,5"sv
+                                      , "/api/v1/game/state?bbox=0,0,10,10,"sv, "/api/v1/game/state?bbox=,0,0,10,10"sv
+                                      , "/api/v1/game/state?bbox=0,,10,10"sv, "/api/v1/game/state?bbox=0,0,nan,10"sv
+                                      , "/api/v1/game/state?bbox=0,0,inf,10"sv, "/api/v1/game/state?bbox=0,0,10,-inf"sv
+                                      , "/api/v1/game/state?bbox=0%2"sv, "/api/v1/game/state?bbox"sv}) {
+                const auto& response = state(target);
+                CHECK(response.result() == http::status::bad_request);
+                CHECK(response.body() == error);
+            }
+        }
+    }
+}
+
+SCENARIO("Requests handled outside the API strand") {
+    GIVEN("an API handler") {
+        model::Game game{false};
+        game.AddMap(MakeMap("map1"s, "Map 1"s, 40));
+        app::Application app{game};
+        http_handler::ApiHandler handler{app, false, {}};
+        auto outside_strand = [&handler](http::verb method, std::string_view target) {
+            return handler.CanHandleOutsideStrand(MakeRequest(method, target));
+        };
+
+        THEN("reads and player commands run in the IO thread") {
+            CHECK(outside_strand(http::verb::get, "/api/v1/maps"sv));
+            CHECK(outside_strand(http::verb::get, "/api/v1/maps?start=1"sv));
+            CHECK(outside_strand(http::verb::get, "/api/v1/maps/map1"sv));
+            CHECK(outside_strand(http::verb::head, "/api/v1/maps/map1?x=1"sv));
+            CHECK(outside_strand(http::verb::get, "/api/v1/game/state"sv));
+            CHECK(outside_strand(http::verb::get, "/api/v1/game/state?radius=5&bbox=0,0,1,1"sv));
+            CHECK(outside_strand(http::verb::get, "/api/v1/game/players"sv));
+            CHECK(outside_strand(http::verb::get, "/api/v1/game/players?start=0&maxItems=10"sv));
+            CHECK(outside_strand(http::verb::post, "/api/v1/game/player/action"sv));
+            CHECK(outside_strand(http::verb::post, "/api/v1/game/player/action?x=1"sv));
+        }
+        THEN("requests that change the game run in the strand") {
+            CHECK_FALSE(outside_strand(http::verb::post, "/api/v1/game/join"sv));
+            CHECK_FALSE(outside_strand(http::verb::post, "/api/v1/game/join?map=map1"sv));
+            CHECK_FALSE(outside_strand(http::verb::post, "/api/v1/game/tick"sv));
+            CHECK_FALSE(outside_strand(http::verb::post, "/api/v1/game/tick?timeDelta=10"sv));
+            CHECK_FALSE(outside_strand(http::verb::post, "/api/v1/game/player/leave"sv));
+            CHECK_FALSE(outside_strand(http::verb::post, "/api/v1/game/player/leave?x=1"sv));
+        }
+        THEN("unknown endpoints run in the strand") {
+            CHECK_FALSE(outside_strand(http::verb::get, "/api/v1/game"sv));
+            CHECK_FALSE(outside_strand(http::verb::get, "/api/v1/game/state/extra"sv));
+            CHECK_FALSE(outside_strand(http::verb::post, "/api/v1/game/player"sv));
+            CHECK_FALSE(outside_strand(http::verb::get, "/api/v2/maps"sv));
+        }
+    }
+}
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/application.h"
+#include "../src/route_planner.h"
+
+using namespace std::literals;
+
+namespace {
+
+using NodeId = model::RoadNetwork::NodeId;
+using Distance = routing::ContractionHierarchy::Distance;
+
+// Расстояния от вершины from до всех вершин обычным алгоритмом Дейкстры
+std::vector<Distance> FindDistances(const model::RoadNetwork& network, NodeId from) {
+    std::vector<Distance> distances(network.GetNodeCount(), -1);
+    using Item = std::pair<Distance, NodeId>;
+    std::priority_queue<Item, std::vector<Item>, std::greater<>> queue;
+    queue.emplace(0, from);
+    while (!queue.empty()) {
+        const auto [distance, node] = queue.top();
+        queue.pop();
+        if (distances[node] >= 0) {
+            continue;
+        }
+        distances[node] = distance;
+        for (const auto& edge : network.GetEdges(node)) {
+            if (distances[edge.to] < 0) {
+                queue.emplace(distance + edge.length, edge.to);
+            }
+        }
+    }
+    return distances;
+}
+
+// Решётка с неравными кварталами, пропущенными участками и отдельной дорогой
+model::Map MakeMap() {
+    model::Map map{model::Map::Id{"map1"s}, "Map 1"s};
+    const std::vector<int> lines{0, 3, 10, 12, 20, 27, 40};
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (i % 3 == 1) {
+            // улица из двух дорог с разрывом посередине
+            map.AddRoad(model::Road{model::Road::HORIZONTAL, {0, lines[i]}, 11});
+            map.AddRoad(model::Road{model::Road::HORIZONTAL, {21, lines[i]}, 40});
+        } else {
+            map.AddRoad(model::Road{model::Road::HORIZONTAL, {0, lines[i]}, 40});
+        }
+        map.AddRoad(model::Road{model::Road::VERTICAL, {lines[i], i == 2 ? 12 : 0}, 40});
+    }
+    map.AddRoad(model::Road{model::Road::HORIZONTAL, {50, 5}, 60});
+    map.BildListOderedPath();
+    return map;
+}
+
+// Проверяет пути между всеми парами вершин по сравнению с алгоритмом Дейкстры
+template <typename Router>
+void CheckAllPairs(const model::RoadNetwork& network, const Router& router) {
+    for (NodeId from = 0; from < network.GetNodeCount(); ++from) {
+        const auto expected = FindDistances(network, from);
+        for (NodeId to = 0; to < network.GetNodeCount(); ++to) {
+            const auto distance = router.GetDistance(from, to);
+            const auto path = router.GetPath(from, to);
+            if (expected[to] < 0) {
+                CHECK_FALSE(distance.has_value());
+                CHECK(path.empty());
+                CHECK_FALSE(router.GetNextHop(from, to).has_value());
+                continue;
+            }
+            REQUIRE(distance.has_value());
+            CHECK(*distance == expected[to]);
+
+            // Путь идёт по рёбрам сети и имеет кратчайшую длину
+            REQUIRE(!path.empty());
+            CHECK(path.front() == from);
+            CHECK(path.back() == to);
+            Distance length = 0;
+            for (size_t i = 1; i < path.size(); ++i) {
+                const auto edges = network.GetEdges(path[i - 1]);
+                const auto edge = std::find_if(edges.begin(), edges.end(), [&](const auto& e) { return e.to == path[i]; });
+                REQUIRE(edge != edges.end());
+                length += edge->length;
+            }
+            CHECK(length == expected[to]);
+            if (from != to) {
+                CHECK(router.GetNextHop(from, to) == path[1]);
+            }
+        }
+    }
+}
+
+} // namespace
+
+SCENARIO("Shortest paths on a road network") {
+    GIVEN("a road network with gaps and a separate road") {
+        const auto map = MakeMap();
+        const auto& network = map.GetRoadNetwork();
+
+        THEN("the contraction hierarchy finds shortest paths between all nodes") {
+            const routing::ContractionHierarchy hierarchy{network};
+            REQUIRE(hierarchy.GetNodeCount() == network.GetNodeCount());
+            CheckAllPairs(network, hierarchy);
+        }
+        THEN("the distance table finds shortest paths between all nodes") {
+            const routing::DistanceTable table{network};
+            REQUIRE(table.GetNodeCount() == network.GetNodeCount());
+            CheckAllPairs(network, table);
+        }
+        THEN("the planner uses the table only for small networks") {
+            CHECK(routing::RoutePlanner{network}.HasTable());
+            const routing::RoutePlanner planner{network, network.GetNodeCount() - 1};
+            CHECK_FALSE(planner.HasTable());
+            CheckAllPairs(network, planner);
+        }
+    }
+}
+
+SCENARIO("Bots walk between offices") {
+    GIVEN("a game with a bot on a map with two offices") {
+        auto map = MakeMap();
+        map.SetDogSpeed(3.0);
+        map.AddOffice(model::Office{model::Office::Id{"o1"s}, {40, 17}, {0, 0}});
+        map.AddOffice(model::Office{model::Office::Id{"o2"s}, {5, 40}, {0, 0}});
+        // Офис вне дорог бот пропускает
+        map.AddOffice(model::Office{model::Office::Id{"o3"s}, {30, 30}, {0, 0}});
+        model::Game game{false};
+        game.AddMap(std::move(map));
+        app::Application app{game};
+        app.AddBots(1);
+        const auto session = game.GetSession(game.FindMap(model::Map::Id{"map1"s}));
+        REQUIRE(session->GetDogCount() == 1);
+
+        WHEN("the game runs") {
+            std::vector<model::Dog::Pos> stops;
+            for (int tick = 0; tick < 2000 && stops.size() < 3; ++tick) {
+                app.ChangeGameSate(50ms);
+                const auto& dog = session->GetSnapshot()->dogs.front();
+                if (dog.speed.dir_x == 0.0 && dog.speed.dir_y == 0.0) {
+                    // Бот стоит только в вершинах маршрута и у офисов
+                    const bool at_office = (dog.pos.x == 40 && dog.pos.y == 17) || (dog.pos.x == 5 && dog.pos.y == 40);
+                    if (at_office && (stops.empty() || stops.back().x != dog.pos.x || stops.back().y != dog.pos.y)) {
+                        stops.push_back(dog.pos);
+                    }
+                }
+            }
+
+            THEN("the bot visits the reachable offices in turn") {
+                REQUIRE(stops.size() == 3);
+                CHECK(stops[0].x == 40);
+                CHECK(stops[0].y == 17);
+                CHECK(stops[1].x == 5);
+                CHECK(stops[1].y == 40);
+                CHECK(stops[2].x == 40);
+            }
+        }
+    }
+}
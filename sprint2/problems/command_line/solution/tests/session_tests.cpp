@@ -0,0 +1,503 @@
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/application.h"
+#include "support/counting_allocator.h"
+
+using namespace std::literals;
+
+namespace {
+
+model::Map MakeMap() {
+    model::Map map{model::Map::Id{"map1"s}, "Map 1"s};
+    map.AddRoad(model::Road{model::Road::HORIZONTAL, {0, 0}, 40});
+    map.BildListOderedPath();
+    map.SetDogSpeed(1.0);
+    return map;
+}
+
+} // namespace
+
+SCENARIO("Sessions with a player limit") {
+    GIVEN("a game with at most 2 players per session") {
+        model::Game game{false};
+        game.AddMap(MakeMap());
+        const auto* map = game.FindMap(model::Map::Id{"map1"s});
+
+        WHEN("players join with the fill-first policy") {
+            game.SetSessionLimit(2, model::SessionPolicy::FillFirst);
+            app::Application app{game};
+            std::vector<std::string> tokens;
+            for (int i = 0; i < 5; ++i) {
+                tokens.push_back(*app.AddPlayer("dog"s + std::to_string(i), "map1"s).token);
+            }
+
+            THEN("sessions are filled one by one and players see only their session") {
+                CHECK(app.GetPlayersListForUser(tokens[0]).size() == 2);
+                CHECK(app.GetPlayersListForUser(tokens[2]).size() == 2);
+                CHECK(app.GetPlayersListForUser(tokens[4]).size() == 1);
+            }
+            THEN("the next player joins the session with a free place") {
+                CHECK(game.GetSession(map)->GetDogCount() == 1);
+            }
+        }
+
+        WHEN("players join with the least-loaded policy") {
+            game.SetSessionLimit(2, model::SessionPolicy::LeastLoaded);
+            app::Application app{game};
+            std::vector<std::string> tokens;
+            for (int i = 0; i < 3; ++i) {
+                tokens.push_back(*app.AddPlayer("dog"s + std::to_string(i), "map1"s).token);
+            }
+
+            THEN("no session exceeds the limit") {
+                CHECK(app.GetPlayersListForUser(tokens[0]).size() == 2);
+                CHECK(app.GetPlayersListForUser(tokens[2]).size() == 1);
+                CHECK(game.GetSession(map)->GetDogCount() == 1);
+            }
+        }
+    }
+    GIVEN("a game with at most 3 players per session and sessions of 2 and 1 players") {
+        model::Game game{false};
+        game.AddMap(MakeMap());
+        const auto* map = game.FindMap(model::Map::Id{"map1"s});
+        auto fill = [&game](model::SessionPolicy policy) {
+            game.SetSessionLimit(3, policy);
+            auto app = std::make_unique<app::Application>(game);
+            std::vector<std::string> tokens;
+            for (int i = 0; i < 4; ++i) {
+                tokens.push_back(*app->AddPlayer("dog"s + std::to_string(i), "map1"s).token);
+            }
+            app->RemovePlayer(tokens[0]);
+            return app;
+        };
+
+        THEN("fill-first places the next player into the first session") {
+            const auto app = fill(model::SessionPolicy::FillFirst);
+            CHECK(game.GetSession(map)->GetDogCount() == 2);
+        }
+        THEN("least-loaded places the next player into the emptier session") {
+            const auto app = fill(model::SessionPolicy::LeastLoaded);
+            CHECK(game.GetSession(map)->GetDogCount() == 1);
+        }
+    }
+    GIVEN("a session whose players all leave") {
+        model::Game game{false};
+        game.AddMap(MakeMap());
+        const auto* map = game.FindMap(model::Map::Id{"map1"s});
+        app::Application app{game};
+        const auto first = *app.AddPlayer("first"s, "map1"s).token;
+        const auto second = *app.AddPlayer("second"s, "map1"s).token;
+        std::weak_ptr<model::GameSession> session = game.GetSession(map);
+        app.SetDogDirect(first, 'R');
+        app.RemovePlayer(first);
+        app.RemovePlayer(second);
+
+        THEN("the session is freed on the next tick") {
+            CHECK_FALSE(session.expired());
+            app.ChangeGameSate(100ms);
+            CHECK(session.expired());
+        }
+        THEN("a session still referenced by a request outlives the game's reference") {
+            const auto held = session.lock();
+            app.ChangeGameSate(100ms);
+            CHECK_FALSE(session.expired());
+            CHECK(held->GetDogCount() == 0);
+            CHECK(game.GetSession(map) != held);
+        }
+        THEN("a player joining before the tick keeps the session") {
+            app.AddPlayer("third"s, "map1"s);
+            app.ChangeGameSate(100ms);
+            CHECK(game.GetSession(map) == session.lock());
+        }
+    }
+}
+
+SCENARIO("Area of interest for game state") {
+    GIVEN("a snapshot with dogs spread over several grid cells") {
+        model::SessionSnapshot snapshot;
+        const std::vector<model::Dog::Pos> positions{{0, 0}, {30, 0}, {3, 4}, {-20, 5}, {100, 100}, {6, 0}, {0, -50}};
+        for (size_t i = 0; i < positions.size(); ++i) {
+            snapshot.dogs.push_back({model::Dog::Id{static_cast<int>(i)}, positions[i], {}, 'U'});
+        }
+        snapshot.grid.Update(positions.size(), [&](uint32_t i) { return positions[i]; });
+        app::game_state::UseCase use_case;
+        auto* mr = std::pmr::get_default_resource();
+        auto get_ids = [](const app::game_state::Result& result) {
+            std::vector<int> ids;
+            for (const auto& dog : result) {
+                ids.push_back(dog.id);
+            }
+            return ids;
+        };
+
+        THEN("the grid finds dogs in an area") {
+            std::vector<uint32_t> found;
+            snapshot.grid.ForEachInArea({-20, -1, 6, 5}, [&](uint32_t i) { found.push_back(i); });
+            std::sort(found.begin(), found.end());
+            CHECK(found == std::vector<uint32_t>{0, 2, 3, 5});
+        }
+        THEN("without limits the whole session is returned") {
+            CHECK(use_case.GetGameSate(snapshot, {}, 0, {}, mr).size() == positions.size());
+        }
+        THEN("the radius keeps dogs within a circle around the player in snapshot order") {
+            const auto result = use_case.GetGameSate(snapshot, {std::nullopt, 6.0}, 0, {}, mr);
+            CHECK(get_ids(result) == std::vector<int>{0, 2, 5});
+        }
+        THEN("the bounding box and radius are combined and paginated") {
+            const app::game_state::View view{model::Area{-100, -100, 4, 100}, 50.0};
+            CHECK(get_ids(use_case.GetGameSate(snapshot, view, 0, {}, mr)) == std::vector<int>{0, 2, 3, 6});
+            CHECK(get_ids(use_case.GetGameSate(snapshot, view, 0, {1, 2}, mr)) == std::vector<int>{2, 3});
+        }
+        THEN("dogs moved between cells are found at the new place") {
+            auto moved = positions;
+            moved[4] = {1, 1};
+            snapshot.dogs[4].pos = moved[4];
+            snapshot.grid.Update(moved.size(), [&](uint32_t i) { return moved[i]; });
+            const auto result = use_case.GetGameSate(snapshot, {std::nullopt, 2.0}, 0, {}, mr);
+            CHECK(get_ids(result) == std::vector<int>{0, 4});
+        }
+    }
+    GIVEN("a session where dogs walk through grid cells tick after tick") {
+        model::Game game{false};
+        game.AddMap(MakeMap());
+        const auto session = game.GetSession(game.FindMap(model::Map::Id{"map1"s}));
+        std::vector<model::Dog::Handle> dogs;
+        for (int i = 0; i < 4; ++i) {
+            dogs.push_back(session->AddDog(game.NewDogId(), "dog"s + std::to_string(i)).GetHandle());
+        }
+        session->PushCommand({dogs[1], model::Dog::Dir::Right});
+        session->PushCommand({dogs[3], model::Dog::Dir::Right});
+
+        THEN("every published grid finds each dog at its position") {
+            // Снимки чередуются, и сетка каждого обновляется от состояния двумя тиками раньше
+            std::vector<std::shared_ptr<const model::SessionSnapshot>> held;
+            for (int tick = 0; tick < 40; ++tick) {
+                game.ChangeGameSate(1s);
+                const auto snapshot = session->GetSnapshot();
+                if (tick % 10 == 0) {
+                    held.push_back(snapshot); // часть снимков держат читатели
+                }
+                for (uint32_t i = 0; i < snapshot->dogs.size(); ++i) {
+                    const auto pos = snapshot->dogs[i].pos;
+                    std::vector<uint32_t> found;
+                    snapshot->grid.ForEachInArea({pos.x, pos.y, pos.x, pos.y}, [&](uint32_t index) {
+                        found.push_back(index);
+                    });
+                    REQUIRE(std::find(found.begin(), found.end(), i) != found.end());
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Session snapshot buffers") {
+    GIVEN("a session with moving dogs") {
+        model::Game game{false};
+        game.AddMap(MakeMap());
+        const auto session = game.GetSession(game.FindMap(model::Map::Id{"map1"s}));
+        for (int i = 0; i < 4; ++i) {
+            const auto dog = session->AddDog(game.NewDogId(), "dog"s + std::to_string(i)).GetHandle();
+            session->PushCommand({dog, model::Dog::Dir::Right});
+        }
+        game.ChangeGameSate(100ms);
+
+        WHEN("a reader holds an old snapshot across several ticks") {
+            const auto held = session->GetSnapshot();
+            const auto dogs = held->dogs;
+            const auto handles = held->handles;
+            for (int tick = 0; tick < 5; ++tick) {
+                game.ChangeGameSate(100ms);
+            }
+            const auto current = session->GetSnapshot();
+
+            THEN("the held snapshot is not overwritten") {
+                REQUIRE(current != held);
+                REQUIRE(held->dogs.size() == dogs.size());
+                for (size_t i = 0; i < dogs.size(); ++i) {
+                    CHECK(held->dogs[i].id == dogs[i].id);
+                    CHECK(held->dogs[i].pos.x == dogs[i].pos.x);
+                    CHECK(held->dogs[i].pos.y == dogs[i].pos.y);
+                    CHECK(held->dogs[i].speed.dir_x == dogs[i].speed.dir_x);
+                    CHECK(held->dogs[i].dir == dogs[i].dir);
+                    CHECK(current->dogs[i].pos.x > dogs[i].pos.x); // собаки ушли вперёд
+                }
+                CHECK(held->handles == handles);
+            }
+        }
+        WHEN("nobody holds the published snapshots") {
+            // За первые тики оба буфера созданы и заполнены
+            game.ChangeGameSate(100ms);
+            game.ChangeGameSate(100ms);
+            std::vector<const model::SessionSnapshot*> published;
+            published.reserve(6);
+            const size_t allocations_before = test_support::GetAllocationCount();
+            for (int tick = 0; tick < 6; ++tick) {
+                game.ChangeGameSate(100ms);
+                published.push_back(session->GetSnapshot().get());
+            }
+            const size_t allocations = test_support::GetAllocationCount() - allocations_before;
+
+            THEN("two buffers take turns and ticks do not allocate snapshots") {
+                for (size_t i = 2; i < published.size(); ++i) {
+                    CHECK(published[i] == published[i - 2]);
+                    CHECK(published[i] != published[i - 1]);
+                }
+                CHECK(allocations == 0);
+            }
+        }
+        WHEN("a reader releases a snapshot before the next tick") {
+            game.ChangeGameSate(100ms);
+            const model::SessionSnapshot* read_buffer = nullptr;
+            double read_x = 0;
+            {
+                const auto snapshot = session->GetSnapshot();
+                read_buffer = snapshot.get();
+                read_x = snapshot->dogs.front().pos.x;
+            }
+            game.ChangeGameSate(100ms);
+            game.ChangeGameSate(100ms);
+
+            THEN("its buffer is reused for a later snapshot with the new state") {
+                const auto snapshot = session->GetSnapshot();
+                CHECK(snapshot.get() == read_buffer);
+                CHECK(snapshot->dogs.front().pos.x > read_x);
+            }
+        }
+        WHEN("a reader releases a snapshot only after it was replaced") {
+            auto held = session->GetSnapshot();
+            game.ChangeGameSate(100ms);
+            held.reset();
+            const size_t allocations_before = test_support::GetAllocationCount();
+            game.ChangeGameSate(100ms);
+            const size_t allocations = test_support::GetAllocationCount() - allocations_before;
+
+            THEN("the next tick builds a new buffer instead") {
+                CHECK(allocations > 0);
+            }
+        }
+    }
+}
+
+SCENARIO("Dog store with slot reuse") {
+    GIVEN("a store with four dogs, two of them moving") {
+        model::DogStore store;
+        std::vector<model::Dog::Handle> handles;
+        for (int i = 0; i < 4; ++i) {
+            handles.push_back(store.Add(model::Dog::Id{i}, "dog"s + std::to_string(i), {double(i), 0}));
+        }
+        store.SetSpeed(handles[1], {1.0, 0});
+        store.SetSpeed(handles[3], {0, 1.0});
+
+        WHEN("a moving dog is removed") {
+            store.Remove(handles[1]);
+
+            THEN("its handle becomes stale and the other dogs keep their data") {
+                CHECK_FALSE(store.Contains(handles[1]));
+                CHECK(store.Size() == 3);
+                CHECK(store.GetActiveCount() == 1);
+                for (const int i : {0, 2, 3}) {
+                    REQUIRE(store.Contains(handles[i]));
+                    CHECK(*store.GetId(handles[i]) == i);
+                    CHECK(store.GetPos(handles[i]).x == i);
+                }
+                CHECK(store.GetSpeed(handles[3]).dir_y == 1.0);
+            }
+            THEN("a new dog takes the free slot with a new generation") {
+                const auto handle = store.Add(model::Dog::Id{10}, "new"s, {5, 5});
+                CHECK(store.GetSlotCount() == 4);
+                CHECK(model::DogStore::GetSlot(handle) == model::DogStore::GetSlot(handles[1]));
+                CHECK(handle != handles[1]);
+                CHECK_FALSE(store.Contains(handles[1]));
+                CHECK(store.GetName(handle) == "new"s);
+            }
+        }
+        WHEN("the last dogs are removed and the store is compacted") {
+            store.Remove(handles[3]);
+            store.Remove(handles[2]);
+            store.Compact();
+
+            THEN("free slots at the end are dropped, remaining dogs are intact") {
+                CHECK(store.GetSlotCount() == 2);
+                CHECK(store.GetActiveCount() == 1);
+                CHECK(store.GetSpeed(handles[1]).dir_x == 1.0);
+                CHECK(store.GetPos(handles[0]).x == 0);
+            }
+            THEN("handles of dropped slots never match new dogs") {
+                const auto first = store.Add(model::Dog::Id{20}, "a"s, {});
+                const auto second = store.Add(model::Dog::Id{21}, "b"s, {});
+                CHECK_FALSE(store.Contains(handles[2]));
+                CHECK_FALSE(store.Contains(handles[3]));
+                CHECK(store.Contains(first));
+                CHECK(store.Contains(second));
+            }
+        }
+    }
+}
+
+SCENARIO("Players leave the game") {
+    GIVEN("a session with three players") {
+        model::Game game{false};
+        game.AddMap(MakeMap());
+        app::Application app{game};
+        std::vector<std::string> tokens;
+        for (int i = 0; i < 3; ++i) {
+            tokens.push_back(*app.AddPlayer("dog"s + std::to_string(i), "map1"s).token);
+        }
+        const auto session = game.GetSession(game.FindMap(model::Map::Id{"map1"s}));
+        app.SetDogDirect(tokens[1], 'R');
+
+        WHEN("a player leaves before the queued command is applied") {
+            const auto handle = app.FindPlayer(tokens[1])->GetDogHandle();
+            REQUIRE(app.RemovePlayer(tokens[1]));
+            app.ChangeGameSate(100ms);
+
+            THEN("the token and the dog handle are no longer valid") {
+                CHECK(app.FindPlayer(tokens[1]) == nullptr);
+                CHECK_FALSE(app.RemovePlayer(tokens[1]));
+                CHECK_FALSE(session->HasDog(handle));
+                CHECK_FALSE(session->GetSnapshot()->FindDog(handle).has_value());
+            }
+            THEN("the other players see the session without the dog") {
+                CHECK(session->GetDogCount() == 2);
+                CHECK(app.GetPlayersListForUser(tokens[0]).size() == 2);
+                CHECK(app.GetGameSate(tokens[2]).size() == 2);
+                CHECK_THROWS_AS(app.GetGameSate(tokens[1]), std::invalid_argument);
+            }
+            THEN("a new player reuses the freed slots") {
+                const auto token = *app.AddPlayer("dog3"s, "map1"s).token;
+                const auto new_handle = app.FindPlayer(token)->GetDogHandle();
+                CHECK(model::DogStore::GetSlot(new_handle) == model::DogStore::GetSlot(handle));
+                CHECK(new_handle != handle);
+                CHECK(app.GetGameSate(token).size() == 3);
+            }
+        }
+    }
+}
+
+SCENARIO("Requests race with players joining and leaving") {
+    GIVEN("a game where players keep joining, leaving and retiring") {
+        model::Game game{false};
+        game.SetDogRetirementTime(300ms);
+        game.SetSessionLimit(4, model::SessionPolicy::LeastLoaded);
+        game.AddMap(MakeMap());
+        app::Application app{game, {1000.0, 10.0}};
+        std::mutex tokens_mutex;
+        std::vector<std::string> tokens;
+        std::atomic<bool> stop{false};
+
+        THEN("requests from other threads see only the player's own session") {
+            // Потоки ввода-вывода обращаются к игрокам по токенам, в том числе к ушедшим.
+            // Проверки Catch2 не потокобезопасны, поэтому нарушения только подсчитываются
+            std::vector<std::thread> readers;
+            std::atomic<size_t> requests{0};
+            std::atomic<size_t> oversized{0};
+            for (unsigned thread = 0; thread < 3; ++thread) {
+                readers.emplace_back([&, thread] {
+                    util::SplitMix64 random{thread};
+                    while (!stop.load()) {
+                        std::string token;
+                        {
+                            std::lock_guard lock{tokens_mutex};
+                            if (tokens.empty()) {
+                                continue;
+                            }
+                            token = tokens[random() % tokens.size()];
+                        }
+                        try {
+                            app.TryConsumePlayerRequest(token, rate_limiter::Clock::now());
+                            app.SetDogDirect(token, "LRUD"[random() % 4]);
+                            const auto state = app.GetGameSate(token);
+                            const auto players = app.GetPlayersListForUser(token);
+                            oversized += state.size() > 4 || players.size() > 4;
+                        } catch (const std::invalid_argument&) {
+                            // игрок успел выйти из игры
+                        }
+                        ++requests;
+                    }
+                });
+            }
+            // Поток strand: входы, выходы и тики с уходом простаивающих собак.
+            // Тики идут, пока читатели не сделают достаточно запросов
+            for (int tick = 0; tick < 300 || requests.load() < 1000; ++tick) {
+                const auto token = *app.AddPlayer("dog"s + std::to_string(tick), "map1"s).token;
+                std::string leaving;
+                {
+                    std::lock_guard lock{tokens_mutex};
+                    tokens.push_back(token);
+                    if (tick % 3 == 0) {
+                        leaving = tokens[tick % tokens.size()];
+                    }
+                    if (tokens.size() > 64) {
+                        tokens.erase(tokens.begin()); // старые токены остаются и у читателей
+                    }
+                }
+                if (!leaving.empty()) {
+                    app.RemovePlayer(leaving);
+                }
+                app.ChangeGameSate(50ms);
+            }
+            stop = true;
+            for (auto& reader : readers) {
+                reader.join();
+            }
+            CHECK(requests.load() > 0);
+            CHECK(oversized.load() == 0);
+        }
+    }
+}
+
+SCENARIO("Idle dogs retire") {
+    GIVEN("a game where dogs retire after standing for 10 seconds") {
+        model::Game game{false};
+        game.SetDogRetirementTime(10s);
+        game.AddMap(MakeMap());
+        app::Application app{game};
+        const auto idle = *app.AddPlayer("idle"s, "map1"s).token;
+        const auto active = *app.AddPlayer("active"s, "map1"s).token;
+        app.AddBots(1);
+        const auto session = game.GetSession(game.FindMap(model::Map::Id{"map1"s}));
+
+        WHEN("one player keeps moving and the other stands") {
+            // Дорога длиной 40 при скорости 1: собака доходит до конца за 40 с
+            app.SetDogDirect(active, 'R');
+            for (int i = 0; i < 99; ++i) {
+                app.ChangeGameSate(100ms);
+            }
+
+            THEN("nobody retires before the retirement time") {
+                CHECK(app.FindPlayer(idle) != nullptr);
+                CHECK(session->GetDogCount() == 3);
+            }
+            AND_WHEN("the retirement time passes") {
+                app.ChangeGameSate(100ms);
+
+                THEN("only the standing player leaves the game, bots stay") {
+                    CHECK(app.FindPlayer(idle) == nullptr);
+                    CHECK(app.FindPlayer(active) != nullptr);
+                    CHECK(session->GetDogCount() == 2);
+                    CHECK(game.GetRetiredDogs().size() == 1);
+                }
+            }
+            AND_WHEN("the moving dog reaches the end of the road and stands") {
+                for (int i = 0; i < 301; ++i) {
+                    app.ChangeGameSate(100ms);
+                }
+                CHECK(app.FindPlayer(active) != nullptr);
+                // собака остановится на краю дороги (x = 40.4) через 40.4 с
+                for (int i = 0; i < 110; ++i) {
+                    app.ChangeGameSate(100ms);
+                }
+
+                THEN("it retires after standing for the retirement time") {
+                    CHECK(app.FindPlayer(active) == nullptr);
+                    CHECK(session->GetDogCount() == 1);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,77 @@
+#include "counting_allocator.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> allocation_count{0};
+std::atomic<uint64_t> allocated_bytes{0};
+
+void* Allocate(std::size_t size, std::size_t alignment) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    // Размер для aligned_alloc должен быть кратен выравниванию
+    void* ptr = alignment > alignof(std::max_align_t)
+        ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+        : std::malloc(size == 0 ? 1 : size);
+    if (!ptr) {
+        throw std::bad_alloc{};
+    }
+    return ptr;
+}
+
+} // namespace
+
+namespace test_support {
+
+uint64_t GetAllocationCount() noexcept {
+    return allocation_count.load(std::memory_order_relaxed);
+}
+
+uint64_t GetAllocatedBytes() noexcept {
+    return allocated_bytes.load(std::memory_order_relaxed);
+}
+
+} // namespace test_support
+
+// Считаем все выделения памяти в куче, сделанные через operator new.
+// std::pmr::new_delete_resource использует версии operator new с выравниванием
+void* operator new(std::size_t size) {
+    return Allocate(size, alignof(std::max_align_t));
+}
+void* operator new[](std::size_t size) {
+    return Allocate(size, alignof(std::max_align_t));
+}
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return Allocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return Allocate(size, static_cast<std::size_t>(alignment));
+}
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+
+// Подсчёт выделений памяти в куче. Файл counting_allocator.cpp заменяет глобальные
+// operator new и operator delete, поэтому входит в программу один раз - в тесты
+// или бенчмарк, которым нужно число выделений
+namespace test_support {
+
+// Число вызовов operator new с начала работы программы
+uint64_t GetAllocationCount() noexcept;
+// Сколько байт запрошено через operator new с начала работы программы
+uint64_t GetAllocatedBytes() noexcept;
+
+} // namespace test_support
@@ -0,0 +1,125 @@
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/tick.h"
+
+using namespace std::literals;
+
+namespace {
+
+namespace net = boost::asio;
+
+// Запускает тикер с периодом period. Первый вызов handler длится first_step,
+// поэтому следующее срабатывание опаздывает. Возвращает время, переданное
+// каждому из первых calls вызовов handler
+std::vector<std::chrono::milliseconds> RunLateTicker(tick::Policy policy, std::chrono::milliseconds period
+                                                     , std::chrono::milliseconds first_step, size_t calls
+                                                     , tick::Stats& stats) {
+    net::io_context ioc;
+    std::vector<std::chrono::milliseconds> deltas;
+    auto ticker = std::make_shared<tick::Ticker>(net::make_strand(ioc), period, [&](std::chrono::milliseconds delta) {
+        deltas.push_back(delta);
+        if (deltas.size() == 1) {
+            std::this_thread::sleep_for(first_step);
+        }
+        if (deltas.size() == calls) {
+            ioc.stop();
+        }
+    }, policy);
+    ticker->Start();
+    ioc.run();
+    stats = ticker->GetStats();
+    return deltas;
+}
+
+} // namespace
+
+SCENARIO("Tick steps for a late timer") {
+    using Mode = tick::Policy::Mode;
+    GIVEN("a timer that fires on time or late by less than a period") {
+        THEN("one step of one period is made") {
+            for (const auto mode : {Mode::CatchUp, Mode::Coalesce}) {
+                for (const auto lateness : {0ms, 49ms}) {
+                    const auto plan = tick::PlanSteps(lateness, 50ms, {mode, 4});
+                    CHECK(plan.periods == 1);
+                    CHECK(plan.steps == 1);
+                    CHECK(plan.dropped == 0);
+                    CHECK(plan.delta == 50ms);
+                }
+            }
+        }
+    }
+    GIVEN("a timer late by several periods") {
+        THEN("catch-up makes a step per period up to max_substeps and drops the rest") {
+            const auto plan = tick::PlanSteps(120ms, 50ms, {Mode::CatchUp, 4});
+            CHECK(plan.periods == 3);
+            CHECK(plan.steps == 3);
+            CHECK(plan.dropped == 0);
+            CHECK(plan.delta == 50ms);
+
+            const auto limited = tick::PlanSteps(500ms, 50ms, {Mode::CatchUp, 4});
+            CHECK(limited.periods == 11);
+            CHECK(limited.steps == 4);
+            CHECK(limited.dropped == 7);
+            CHECK(limited.delta == 50ms);
+        }
+        THEN("coalesce makes one step for all periods") {
+            const auto plan = tick::PlanSteps(500ms, 50ms, {Mode::Coalesce, 4});
+            CHECK(plan.periods == 11);
+            CHECK(plan.steps == 1);
+            CHECK(plan.dropped == 0);
+            CHECK(plan.delta == 550ms);
+        }
+        THEN("catch-up makes at least one step when max_substeps is zero") {
+            const auto plan = tick::PlanSteps(100ms, 50ms, {Mode::CatchUp, 0});
+            CHECK(plan.steps == 1);
+            CHECK(plan.dropped == 2);
+        }
+    }
+    GIVEN("a timer that fired before its deadline") {
+        THEN("it is treated as on time") {
+            const auto plan = tick::PlanSteps(-30ms, 50ms, {Mode::CatchUp, 4});
+            CHECK(plan.periods == 1);
+            CHECK(plan.steps == 1);
+        }
+    }
+}
+
+SCENARIO("Ticker") {
+    GIVEN("a zero or negative period") {
+        net::io_context ioc;
+        auto handler = [](std::chrono::milliseconds) {};
+
+        THEN("the ticker is not created") {
+            CHECK_THROWS_AS(tick::Ticker(net::make_strand(ioc), 0ms, handler), std::invalid_argument);
+            CHECK_THROWS_AS(tick::Ticker(net::make_strand(ioc), -5ms, handler), std::invalid_argument);
+        }
+    }
+    GIVEN("a step that takes several periods") {
+        // Второе срабатывание опаздывает не меньше чем на 180 мс, то есть на 3 периода
+        THEN("catch-up makes up to max_substeps steps and counts dropped periods") {
+            tick::Stats stats;
+            const auto deltas = RunLateTicker({tick::Policy::Mode::CatchUp, 2}, 50ms, 230ms, 3, stats);
+            REQUIRE(deltas.size() == 3);
+            CHECK(deltas == std::vector{50ms, 50ms, 50ms});
+            CHECK(stats.steps == 3);
+            CHECK(stats.overruns >= 1);
+            CHECK(stats.missed_periods >= 3);
+            CHECK(stats.dropped_periods >= 2);
+            CHECK(stats.long_steps >= 1);
+        }
+        THEN("coalesce passes all elapsed periods to one step") {
+            tick::Stats stats;
+            const auto deltas = RunLateTicker({tick::Policy::Mode::Coalesce, 2}, 50ms, 230ms, 2, stats);
+            REQUIRE(deltas.size() == 2);
+            CHECK(deltas[1] >= 200ms);
+            CHECK(deltas[1].count() % 50 == 0);
+            CHECK(stats.steps == 2);
+            CHECK(stats.missed_periods >= 3);
+            CHECK(stats.dropped_periods == 0);
+        }
+    }
+}
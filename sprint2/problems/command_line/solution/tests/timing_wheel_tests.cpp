@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/timing_wheel.h"
+
+using Key = util::TimingWheel::Key;
+using Time = util::TimingWheel::Time;
+
+SCENARIO("Timing wheel") {
+    GIVEN("a wheel with timers on different levels") {
+        util::TimingWheel wheel{1000};
+        wheel.Schedule(0, 1000);      // уже истёк
+        wheel.Schedule(1, 1010);
+        wheel.Schedule(2, 1000 + 70'000);
+        wheel.Schedule(3, 1000 + 5'000'000);
+        std::vector<Key> expired;
+
+        THEN("timers fire when their deadline is reached") {
+            wheel.Advance(1000, expired);
+            CHECK(expired == std::vector<Key>{0});
+            wheel.Advance(1009, expired);
+            CHECK(expired.size() == 1);
+            wheel.Advance(1010, expired);
+            CHECK(expired == std::vector<Key>{0, 1});
+            wheel.Advance(70'999, expired);
+            CHECK(expired.size() == 2);
+            wheel.Advance(71'000, expired);
+            CHECK(expired.back() == 2);
+            wheel.Advance(10'000'000, expired);
+            CHECK(expired.back() == 3);
+            CHECK_FALSE(wheel.IsScheduled(3));
+        }
+        THEN("rescheduled and cancelled timers do not fire at the old deadline") {
+            wheel.Schedule(1, 2000);
+            wheel.Cancel(2);
+            wheel.Advance(1'000'000, expired);
+            CHECK(expired == std::vector<Key>{0, 1});
+        }
+    }
+    GIVEN("a wheel whose time has all the bits of its range set") {
+        constexpr Time RANGE = Time{1} << 36;
+        util::TimingWheel wheel{RANGE - 1};
+        wheel.Schedule(0, RANGE);
+        wheel.Schedule(1, RANGE + 100);
+        wheel.Schedule(2, 3 * RANGE + 5);
+        std::vector<Key> expired;
+
+        THEN("timers fire at their deadlines across the range boundary") {
+            wheel.Advance(RANGE, expired);
+            CHECK(expired == std::vector<Key>{0});
+            wheel.Advance(RANGE + 99, expired);
+            CHECK(expired.size() == 1);
+            wheel.Advance(RANGE + 100, expired);
+            CHECK(expired == std::vector<Key>{0, 1});
+        }
+        THEN("a timer beyond the range is kept until its deadline") {
+            for (Time now = RANGE; now < 3 * RANGE + 5; now += RANGE / 3) {
+                wheel.Advance(now, expired);
+            }
+            wheel.Advance(3 * RANGE + 4, expired);
+            CHECK(expired == std::vector<Key>{0, 1});
+            CHECK(wheel.IsScheduled(2));
+            wheel.Advance(3 * RANGE + 5, expired);
+            CHECK(expired == std::vector<Key>{0, 1, 2});
+        }
+    }
+    GIVEN("random timers and time steps") {
+        std::mt19937_64 random{42};
+        util::TimingWheel wheel;
+        std::map<Key, Time> deadlines; // ожидаемые сроки установленных таймеров
+        Time now = 0;
+
+        THEN("the wheel fires exactly the timers whose deadline has passed") {
+            for (int step = 0; step < 20'000; ++step) {
+                for (int i = 0; i < 3; ++i) {
+                    const Key key = random() % 500;
+                    if (random() % 4 == 0) {
+                        wheel.Cancel(key);
+                        deadlines.erase(key);
+                    } else {
+                        // сроки от текущего момента до нескольких часов
+                        const Time deadline = now + (random() % 2 ? random() % 200 : random() % 20'000'000);
+                        wheel.Schedule(key, deadline);
+                        deadlines[key] = deadline;
+                    }
+                }
+                now += random() % 8 == 0 ? random() % 100'000 : random() % 60;
+                std::vector<Key> expired;
+                wheel.Advance(now, expired);
+                std::vector<Key> expected;
+                for (auto it = deadlines.begin(); it != deadlines.end(); ) {
+                    if (it->second <= now) {
+                        expected.push_back(it->first);
+                        it = deadlines.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+                std::sort(expired.begin(), expired.end());
+                REQUIRE(expired == expected);
+            }
+        }
+    }
+}
@@ -0,0 +1,131 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/work_stealing_pool.h"
+
+using namespace std::literals;
+
+namespace {
+
+// Сколько раз выполнилась задача с каждым номером
+class RunCounter {
+public:
+    explicit RunCounter(size_t count)
+        : runs_(std::make_unique<std::atomic<int>[]>(count))
+        , count_(count) {
+    }
+
+    void Run(size_t index) {
+        runs_[index].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool AllRanOnce() const {
+        for (size_t i = 0; i < count_; ++i) {
+            if (runs_[i].load() != 1) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::unique_ptr<std::atomic<int>[]> runs_;
+    size_t count_;
+};
+
+} // namespace
+
+SCENARIO("Work stealing pool") {
+    GIVEN("a pool of 4 threads") {
+        util::WorkStealingPool pool{4};
+
+        THEN("every index runs exactly once for any number of tasks") {
+            CHECK(pool.GetThreadCount() == 4);
+            for (const size_t count : {size_t{0}, size_t{1}, size_t{3}, size_t{4}, size_t{5}, size_t{100'000}}) {
+                RunCounter counter{count};
+                pool.ParallelFor(count, [&counter](size_t index) {
+                    counter.Run(index);
+                });
+                CHECK(counter.AllRanOnce());
+            }
+        }
+        THEN("repeated calls do not mix tasks of different calls") {
+            for (size_t generation = 0; generation < 500; ++generation) {
+                const size_t count = generation % 37;
+                RunCounter counter{count};
+                std::atomic<size_t> sum{0};
+                pool.ParallelFor(count, [&](size_t index) {
+                    counter.Run(index);
+                    sum.fetch_add(index + generation, std::memory_order_relaxed);
+                });
+                REQUIRE(counter.AllRanOnce());
+                REQUIRE(sum.load() == count * (count - 1) / 2 + count * generation);
+            }
+        }
+        THEN("tasks run in several threads at once") {
+            std::atomic<int> running{0};
+            std::atomic<int> max_running{0};
+            pool.ParallelFor(4, [&](size_t) {
+                const int now = running.fetch_add(1) + 1;
+                int prev = max_running.load();
+                while (prev < now && !max_running.compare_exchange_weak(prev, now)) {
+                }
+                // Ждём, пока хотя бы ещё один поток возьмёт задачу
+                const auto deadline = std::chrono::steady_clock::now() + 5s;
+                while (max_running.load() < 2 && std::chrono::steady_clock::now() < deadline) {
+                    std::this_thread::yield();
+                }
+                running.fetch_sub(1);
+            });
+            CHECK(max_running.load() >= 2);
+        }
+        THEN("an exception of a task is rethrown after all tasks finish and the pool stays usable") {
+            RunCounter counter{1000};
+            CHECK_THROWS_AS(pool.ParallelFor(1000, [&counter](size_t index) {
+                counter.Run(index);
+                if (index % 100 == 7) {
+                    throw std::runtime_error("task "s + std::to_string(index));
+                }
+            }), std::runtime_error);
+            CHECK(counter.AllRanOnce());
+
+            try {
+                pool.ParallelFor(10, [](size_t index) {
+                    if (index == 3) {
+                        throw std::invalid_argument("task 3"s);
+                    }
+                });
+                FAIL("no exception");
+            } catch (const std::invalid_argument& ex) {
+                CHECK(ex.what() == "task 3"s);
+            }
+
+            RunCounter after{1000};
+            pool.ParallelFor(1000, [&after](size_t index) {
+                after.Run(index);
+            });
+            CHECK(after.AllRanOnce());
+        }
+    }
+    GIVEN("a pool of one thread") {
+        util::WorkStealingPool pool{0};
+
+        THEN("the calling thread runs all tasks") {
+            CHECK(pool.GetThreadCount() == 1);
+            const auto caller = std::this_thread::get_id();
+            RunCounter counter{100};
+            bool same_thread = true;
+            pool.ParallelFor(100, [&](size_t index) {
+                counter.Run(index);
+                same_thread = same_thread && std::this_thread::get_id() == caller;
+            });
+            CHECK(counter.AllRanOnce());
+            CHECK(same_thread);
+        }
+    }
+}